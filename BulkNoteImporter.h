@@ -0,0 +1,94 @@
+//
+//  BulkNoteImporter.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreData/CoreData.h>
+
+@class NoteDocumentStore;
+@class SearchDatabaseUpdater;
+
+@protocol BulkNoteImporterDelegate;
+
+
+/*
+ * Imports the documents in a NoteDocumentStore as Notes in three stages:
+ *  - a single reader operation that maps each document from the store;
+ *  - a pool of worker operations that extract the text to be indexed straight
+ *    from the mapped markup;
+ *  - a committer, running on the main thread (which owns the managed object
+ *    context), that creates Notes in batches of batchSize, saves them with a
+ *    single Core Data save and indexes them with a single addOrReplaceRecords:.
+ *
+ * The number of documents read but not yet committed is bounded, so memory use
+ * does not grow with the size of the corpus.  Notes keep the extracted text as
+ * their content; the markup stays in the store and is never copied.
+ */
+@interface BulkNoteImporter : NSObject {
+	NSUInteger						batchSize;
+	NSUInteger						workerCount;
+	id<BulkNoteImporterDelegate>	delegate;
+	NSManagedObjectContext			*managedObjectContext;
+	SearchDatabaseUpdater			*searchDatabaseUpdater;
+	
+@private
+	NSOperationQueue				*readerOperationQueue;
+	NSOperationQueue				*workerOperationQueue;
+	dispatch_semaphore_t			inFlightSemaphore;
+	NSMutableArray					*pendingDocuments;
+	NSUInteger						readCount;
+	NSUInteger						receivedCount;
+	NSUInteger						importedCount;
+	unsigned long long				importedByteCount;
+	NSTimeInterval					startTime;
+	NSTimeInterval					elapsedTime;
+	BOOL							readerFinished;
+	BOOL							importInProgress;
+	volatile BOOL					cancelled;
+}
+
+@property (nonatomic, assign)	NSUInteger						batchSize;
+@property (nonatomic, assign)	NSUInteger						workerCount;
+@property (nonatomic, assign)	id<BulkNoteImporterDelegate>	delegate;
+@property (nonatomic, retain)	NSManagedObjectContext			*managedObjectContext;
+@property (nonatomic, retain)	SearchDatabaseUpdater			*searchDatabaseUpdater;
+
+@property (nonatomic, readonly)	NSUInteger						importedCount;
+@property (nonatomic, readonly)	unsigned long long				importedByteCount;
+@property (nonatomic, readonly)	NSTimeInterval					elapsedTime;
+@property (nonatomic, readonly)	BOOL							importInProgress;
+
+- (id)initWithManagedObjectContext:(NSManagedObjectContext *)aManagedObjectContext searchDatabaseUpdater:(SearchDatabaseUpdater *)aSearchDatabaseUpdater;
+- (void)importDocumentsFromStore:(NoteDocumentStore *)store;
+- (void)cancel;
+- (double)documentsPerSecond;
+- (double)megabytesPerSecond;
+
+@end
+
+
+@protocol BulkNoteImporterDelegate <NSObject>
+- (void)bulkNoteImporter:(BulkNoteImporter *)bulkNoteImporter didImportNotes:(NSArray *)notes;
+- (void)bulkNoteImporterDidFinish:(BulkNoteImporter *)bulkNoteImporter;
+@end
@@ -0,0 +1,294 @@
+//
+//  BulkNoteImporter.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import "BulkNoteImporter.h"
+
+#import "Note.h"
+#import "NoteDocumentStore.h"
+#import "SearchDatabaseUpdater.h"
+#import "XHTMLExtractedText.h"
+
+#define kDefaultBatchSize				50
+#define kMaxDocumentsInFlightPerWorker	4
+
+#define kDocumentTitleKey				@"title"
+#define kDocumentExtractedTextKey		@"extractedText"
+#define kDocumentByteCountKey			@"byteCount"
+
+
+@interface BulkNoteImporter ()
+- (void)commitPendingDocuments;
+- (void)didParseDocument:(NSDictionary *)document;
+- (void)readerDidFinishWithFileCount:(NSUInteger)fileCount;
+@end
+
+
+@implementation BulkNoteImporter
+
+@synthesize batchSize;
+@synthesize workerCount;
+@synthesize delegate;
+@synthesize managedObjectContext;
+@synthesize searchDatabaseUpdater;
+@synthesize importedCount;
+@synthesize importedByteCount;
+@synthesize elapsedTime;
+@synthesize importInProgress;
+
+
+#pragma mark -
+#pragma mark Worker stage
+
++ (NSDictionary *)parsedDocumentWithData:(NSData *)data title:(NSString *)title documentStore:(NoteDocumentStore *)store {
+	// Extract straight from the mapped file: the markup is never decoded into an
+	// NSString, so the only copy made is the (much smaller) extracted text
+	XHTMLExtractedText *extractedText = [XHTMLExtractedText extractedTextWithOffsetMapFromData:data];
+	if (nil == extractedText) {
+		DLog(@"Skipping \"%@\": not valid UTF-8", title);
+		return nil;
+	}
+	
+	// Keep the offset map and text so the viewer can place search hits, and results show snippets, without extracting
+	// the document again
+	NSUInteger textLength = [extractedText.text lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+	[store storeOffsetMap:extractedText.offsetMap textLength:textLength forDocumentNamed:title];
+	[store storeExtractedText:extractedText.text forDocumentNamed:title];
+	
+	NSDictionary *document = [NSDictionary dictionaryWithObjectsAndKeys:
+							  title, kDocumentTitleKey,
+							  extractedText, kDocumentExtractedTextKey,
+							  [NSNumber numberWithUnsignedInteger:[data length]], kDocumentByteCountKey,
+							  nil];
+	
+	return document;
+}
+
+
+#pragma mark -
+#pragma mark Reader stage
+
+- (void)readDocumentsFromStore:(NoteDocumentStore *)store {
+	NSUInteger fileCount = 0;
+	for (NSString *documentName in [store documentNames]) {
+		if (cancelled) {
+			break;
+		}
+		
+		// Block while too many documents are waiting to be parsed or committed
+		dispatch_semaphore_wait(inFlightSemaphore, DISPATCH_TIME_FOREVER);
+		
+		@autoreleasepool {
+			NSData *data = [store dataForDocumentNamed:documentName];
+			if (nil == data) {
+				DLog(@"Failed to map \"%@\"", documentName);
+				dispatch_semaphore_signal(inFlightSemaphore);
+				continue;
+			}
+			
+			fileCount++;
+			[workerOperationQueue addOperationWithBlock:^{
+				NSDictionary *document = cancelled ? nil : [BulkNoteImporter parsedDocumentWithData:data title:documentName documentStore:store];
+				dispatch_async(dispatch_get_main_queue(), ^{
+					[self didParseDocument:document];
+				});
+			}];
+		}
+	}
+	
+	dispatch_async(dispatch_get_main_queue(), ^{
+		[self readerDidFinishWithFileCount:fileCount];
+	});
+}
+
+- (void)importDocumentsFromStore:(NoteDocumentStore *)store {
+	ZAssert(!importInProgress, @"An import is already in progress");
+	
+	importInProgress = YES;
+	cancelled = NO;
+	readerFinished = NO;
+	readCount = 0;
+	receivedCount = 0;
+	importedCount = 0;
+	importedByteCount = 0;
+	elapsedTime = 0.0;
+	startTime = [NSDate timeIntervalSinceReferenceDate];
+	
+	workerOperationQueue.maxConcurrentOperationCount = MAX(workerCount, 1);
+	if (inFlightSemaphore) {
+		dispatch_release(inFlightSemaphore);
+	}
+	// Must allow at least one full batch in flight, or the committer would never flush
+	inFlightSemaphore = dispatch_semaphore_create(MAX(MAX(workerCount, 1) * kMaxDocumentsInFlightPerWorker, batchSize));
+	
+	[readerOperationQueue addOperationWithBlock:^{
+		[self readDocumentsFromStore:store];
+	}];
+}
+
+- (void)cancel {
+	// Workers check the flag and skip parsing, so every read document is still
+	// accounted for by the committer and the import finishes promptly.
+	cancelled = YES;
+}
+
+
+#pragma mark -
+#pragma mark Committer stage (main thread)
+
+- (void)commitPendingDocuments {
+	if ([pendingDocuments count] == 0) {
+		return;
+	}
+	
+	@autoreleasepool {
+		NSMutableArray *notes = [[NSMutableArray alloc] initWithCapacity:[pendingDocuments count]];
+		NSMutableArray *extractedTexts = [[NSMutableArray alloc] initWithCapacity:[pendingDocuments count]];
+		NSEntityDescription *noteEntity = [NSEntityDescription entityForName:@"Note" inManagedObjectContext:self.managedObjectContext];
+		NSDate *now = [NSDate date];
+		unsigned long long byteCount = 0;
+		
+		for (NSDictionary *document in pendingDocuments) {
+			Note *note = [[Note alloc] initWithEntity:noteEntity insertIntoManagedObjectContext:self.managedObjectContext];
+			note.title = [document objectForKey:kDocumentTitleKey];
+			note.content = [[document objectForKey:kDocumentExtractedTextKey] text];
+			note.lastUpdated = now;
+			[notes addObject:note];
+			[note release];
+			[extractedTexts addObject:[document objectForKey:kDocumentExtractedTextKey]];
+			
+			byteCount += [[document objectForKey:kDocumentByteCountKey] unsignedLongLongValue];
+		}
+		
+		// One save, and one indexing operation, per batch
+		NSError *error = nil;
+		if (![self.managedObjectContext save:&error]) {
+			ALog(@"Error %@", [error localizedDescription]);
+		}
+		else {
+			[self.searchDatabaseUpdater updateSearchDatabaseForNotes:notes extractedTexts:extractedTexts];
+			
+			importedCount += [notes count];
+			importedByteCount += byteCount;
+			
+			[delegate bulkNoteImporter:self didImportNotes:notes];
+		}
+		
+		for (NSUInteger i=0; i<[pendingDocuments count]; i++) {
+			dispatch_semaphore_signal(inFlightSemaphore);
+		}
+		[pendingDocuments removeAllObjects];
+		[notes release];
+		[extractedTexts release];
+	}
+}
+
+- (void)finishIfComplete {
+	if (!readerFinished || receivedCount < readCount) {
+		return;
+	}
+	
+	if (!cancelled) {
+		[self commitPendingDocuments];
+	}
+	else {
+		[pendingDocuments removeAllObjects];
+	}
+	
+	elapsedTime = [NSDate timeIntervalSinceReferenceDate] - startTime;
+	importInProgress = NO;
+	DLog(@"Imported %u notes (%.2f MB) in %.3fs: %.1f docs/sec, %.2f MB/sec", importedCount, importedByteCount / (1024.0 * 1024.0),
+		 elapsedTime, [self documentsPerSecond], [self megabytesPerSecond]);
+	
+	[delegate bulkNoteImporterDidFinish:self];
+}
+
+- (void)didParseDocument:(NSDictionary *)document {
+	receivedCount++;
+	
+	if (document && !cancelled) {
+		[pendingDocuments addObject:document];
+		if ([pendingDocuments count] >= batchSize) {
+			[self commitPendingDocuments];
+		}
+	}
+	else {
+		dispatch_semaphore_signal(inFlightSemaphore);
+	}
+	
+	[self finishIfComplete];
+}
+
+- (void)readerDidFinishWithFileCount:(NSUInteger)fileCount {
+	readCount = fileCount;
+	readerFinished = YES;
+	
+	[self finishIfComplete];
+}
+
+
+#pragma mark -
+#pragma mark Statistics
+
+- (double)documentsPerSecond {
+	return (elapsedTime > 0.0 ? importedCount / elapsedTime : 0.0);
+}
+
+- (double)megabytesPerSecond {
+	return (elapsedTime > 0.0 ? (importedByteCount / (1024.0 * 1024.0)) / elapsedTime : 0.0);
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithManagedObjectContext:(NSManagedObjectContext *)aManagedObjectContext searchDatabaseUpdater:(SearchDatabaseUpdater *)aSearchDatabaseUpdater {
+	if ((self = [super init])) {
+		self.managedObjectContext = aManagedObjectContext;
+		self.searchDatabaseUpdater = aSearchDatabaseUpdater;
+		self.batchSize = kDefaultBatchSize;
+		self.workerCount = MAX([[NSProcessInfo processInfo] activeProcessorCount], 1);
+		
+		readerOperationQueue = [[NSOperationQueue alloc] init];
+		readerOperationQueue.maxConcurrentOperationCount = 1;
+		workerOperationQueue = [[NSOperationQueue alloc] init];
+		pendingDocuments = [[NSMutableArray alloc] initWithCapacity:kDefaultBatchSize];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[readerOperationQueue release];
+	[workerOperationQueue release];
+	[pendingDocuments release];
+	if (inFlightSemaphore) {
+		dispatch_release(inFlightSemaphore);
+	}
+	[managedObjectContext release];
+	[searchDatabaseUpdater release];
+	
+	[super dealloc];
+}
+
+@end
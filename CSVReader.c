@@ -0,0 +1,264 @@
+//
+//  CSVReader.c
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#include "CSVReader.h"
+
+#include <stdlib.h>
+
+typedef enum {
+	CSVStateFieldStart = 0,
+	CSVStateUnquoted,
+	CSVStateQuoted,
+	CSVStateQuoteInQuoted,		// a quote in a quoted field: either "" or the end of the field
+	CSVStateSkippingRow
+} CSVState;
+
+struct CSVReader {
+	CSVState	state;
+	char		*row;				// the bytes of the current row's fields, back to back
+	size_t		rowLength;
+	size_t		maxRowLength;
+	size_t		*fieldStarts;
+	size_t		*fieldLengths;
+	const char	**fields;
+	size_t		fieldCount;
+	size_t		maxFieldCount;
+	int			rowHasContent;		// to tell a blank line from a row of one empty field
+	int			fieldBegun;			// whether the current field has been begun, as it has after a comma
+	int			skipQuoted;			// whether a skipped row is in a quoted field
+	size_t		rowCount;
+	size_t		skippedRowCount;
+};
+
+
+CSVReader *CSVReaderCreate(size_t maxRowLength, size_t maxFieldCount) {
+	if (maxRowLength == 0 || maxFieldCount == 0) {
+		return NULL;
+	}
+	CSVReader *reader = calloc(1, sizeof(CSVReader));
+	if (reader == NULL) {
+		return NULL;
+	}
+	reader->maxRowLength = maxRowLength;
+	reader->maxFieldCount = maxFieldCount;
+	reader->row = malloc(maxRowLength);
+	reader->fieldStarts = malloc(maxFieldCount * sizeof(size_t));
+	reader->fieldLengths = malloc(maxFieldCount * sizeof(size_t));
+	reader->fields = malloc(maxFieldCount * sizeof(const char *));
+	if (reader->row == NULL || reader->fieldStarts == NULL || reader->fieldLengths == NULL || reader->fields == NULL) {
+		CSVReaderFree(reader);
+		return NULL;
+	}
+	return reader;
+}
+
+void CSVReaderFree(CSVReader *reader) {
+	if (reader) {
+		free(reader->row);
+		free(reader->fieldStarts);
+		free(reader->fieldLengths);
+		free(reader->fields);
+		free(reader);
+	}
+}
+
+size_t CSVReaderRowCount(const CSVReader *reader) {
+	return reader->rowCount;
+}
+
+size_t CSVReaderSkippedRowCount(const CSVReader *reader) {
+	return reader->skippedRowCount;
+}
+
+
+#pragma mark -
+#pragma mark Rows
+
+static void CSVResetRow(CSVReader *reader) {
+	reader->rowLength = 0;
+	reader->fieldCount = 0;
+	reader->rowHasContent = 0;
+	reader->fieldBegun = 0;
+	reader->state = CSVStateFieldStart;
+}
+
+static void CSVSkipRow(CSVReader *reader, int inQuotedField) {
+	reader->state = CSVStateSkippingRow;
+	reader->skipQuoted = inQuotedField;
+}
+
+static int CSVBeginField(CSVReader *reader) {
+	if (reader->fieldCount == reader->maxFieldCount) {
+		return 0;
+	}
+	reader->fieldStarts[reader->fieldCount] = reader->rowLength;
+	reader->fieldLengths[reader->fieldCount] = 0;
+	reader->fieldCount++;
+	reader->fieldBegun = 1;
+	return 1;
+}
+
+static int CSVAppend(CSVReader *reader, char c) {
+	if (reader->rowLength == reader->maxRowLength) {
+		return 0;
+	}
+	reader->row[reader->rowLength++] = c;
+	reader->fieldLengths[reader->fieldCount - 1]++;
+	return 1;
+}
+
+/*
+ * Hands a finished row to the handler, unless it is a blank line.
+ */
+static int CSVEndRow(CSVReader *reader, CSVRowHandler handler, void *context) {
+	int keepReading = 1;
+	if (reader->rowHasContent) {
+		for (size_t i = 0; i < reader->fieldCount; i++) {
+			reader->fields[i] = reader->row + reader->fieldStarts[i];
+		}
+		reader->rowCount++;
+		keepReading = handler(reader->fields, reader->fieldLengths, reader->fieldCount, context);
+	}
+	CSVResetRow(reader);
+	return keepReading;
+}
+
+
+#pragma mark -
+#pragma mark Parsing
+
+int CSVReaderFeed(CSVReader *reader, const char *bytes, size_t length, CSVRowHandler handler, void *context) {
+	for (size_t i = 0; i < length; i++) {
+		char c = bytes[i];
+		
+		switch (reader->state) {
+			case CSVStateSkippingRow:
+				if (c == '"') {
+					reader->skipQuoted = !reader->skipQuoted;
+				}
+				else if (c == '\n' && !reader->skipQuoted) {
+					reader->skippedRowCount++;
+					CSVResetRow(reader);
+				}
+				break;
+				
+			case CSVStateFieldStart:
+				if (c == '\r') {
+					break;		// of CRLF, or stray
+				}
+				if (c == '\n') {
+					if (!CSVEndRow(reader, handler, context)) {
+						return 0;
+					}
+					break;
+				}
+				if (!reader->fieldBegun && !CSVBeginField(reader)) {
+					CSVSkipRow(reader, c == '"');
+					break;
+				}
+				reader->rowHasContent = 1;
+				if (c == '"') {
+					reader->state = CSVStateQuoted;
+				}
+				else if (c == ',') {
+					// An empty field - begin the next
+					if (!CSVBeginField(reader)) {
+						CSVSkipRow(reader, 0);
+					}
+				}
+				else {
+					reader->state = CSVStateUnquoted;
+					if (!CSVAppend(reader, c)) {
+						CSVSkipRow(reader, 0);
+					}
+				}
+				break;
+				
+			case CSVStateUnquoted:
+				if (c == ',') {
+					reader->state = CSVStateFieldStart;
+					if (!CSVBeginField(reader)) {
+						CSVSkipRow(reader, 0);
+					}
+				}
+				else if (c == '\n') {
+					if (!CSVEndRow(reader, handler, context)) {
+						return 0;
+					}
+				}
+				else if (c != '\r' && !CSVAppend(reader, c)) {
+					CSVSkipRow(reader, 0);
+				}
+				break;
+				
+			case CSVStateQuoted:
+				if (c == '"') {
+					reader->state = CSVStateQuoteInQuoted;
+				}
+				else if (!CSVAppend(reader, c)) {
+					CSVSkipRow(reader, 1);
+				}
+				break;
+				
+			case CSVStateQuoteInQuoted:
+				if (c == '"') {
+					reader->state = CSVStateQuoted;
+					if (!CSVAppend(reader, c)) {
+						CSVSkipRow(reader, 1);
+					}
+				}
+				else if (c == ',') {
+					reader->state = CSVStateFieldStart;
+					if (!CSVBeginField(reader)) {
+						CSVSkipRow(reader, 0);
+					}
+				}
+				else if (c == '\n') {
+					if (!CSVEndRow(reader, handler, context)) {
+						return 0;
+					}
+				}
+				else if (c != '\r') {
+					// Text after a closing quote is kept, as most spreadsheets do
+					reader->state = CSVStateUnquoted;
+					if (!CSVAppend(reader, c)) {
+						CSVSkipRow(reader, 0);
+					}
+				}
+				break;
+		}
+	}
+	return 1;
+}
+
+int CSVReaderFinish(CSVReader *reader, CSVRowHandler handler, void *context) {
+	if (reader->state == CSVStateSkippingRow) {
+		reader->skippedRowCount++;
+		CSVResetRow(reader);
+		return 1;
+	}
+	return CSVEndRow(reader, handler, context);
+}
@@ -0,0 +1,77 @@
+//
+//  CSVReader.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#ifndef CSVREADER_H
+#define CSVREADER_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Called with each row read: fieldCount fields, each of fieldLengths[i] bytes
+ * (not nul terminated, and only valid during the call).  Return 0 to stop
+ * reading.
+ */
+typedef int (*CSVRowHandler)(const char *const *fields, const size_t *fieldLengths, size_t fieldCount, void *context);
+
+/*
+ * A streaming reader of RFC 4180 style comma separated values: fields may be
+ * quoted, with "" for a quote, and quoted fields may hold commas and line
+ * breaks.  Lines end in LF or CRLF, and blank lines are skipped.
+ *
+ * Input is fed in chunks of any size, and rows may span chunks.  Only the row
+ * being read is held, so memory use is bounded by maxRowLength whatever the
+ * size of the input; longer rows, or rows of more than maxFieldCount fields,
+ * are skipped and counted.
+ */
+typedef struct CSVReader CSVReader;
+
+CSVReader *CSVReaderCreate(size_t maxRowLength, size_t maxFieldCount);
+void CSVReaderFree(CSVReader *reader);
+
+/*
+ * Parses the next chunk of input, calling handler for each row it completes.
+ * Returns 0 if the handler stopped reading.
+ */
+int CSVReaderFeed(CSVReader *reader, const char *bytes, size_t length, CSVRowHandler handler, void *context);
+
+/*
+ * Ends the input, calling handler for a last row without a line break.
+ * Returns 0 if the handler stopped reading.
+ */
+int CSVReaderFinish(CSVReader *reader, CSVRowHandler handler, void *context);
+
+size_t CSVReaderRowCount(const CSVReader *reader);
+size_t CSVReaderSkippedRowCount(const CSVReader *reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,582 @@
+//
+//  CompletionDictionary.c
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#include "CompletionDictionary.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define kDictionaryMagic		0x44434E4C		// "LNCD"
+#define kDictionaryVersion		1
+#define kBlockSize				16				// terms per front coded block
+#define kNoTerm					UINT32_MAX		// padding leaves of the weight tree
+#define kMaxCompletions			32
+#define kInitialTableCapacity	4096			// power of two
+
+
+#pragma mark -
+#pragma mark Vocabulary
+
+typedef struct {
+	uint32_t	hash;
+	uint32_t	termOffset;				// into the arena
+	uint32_t	termLength;				// 0 for an empty slot
+	uint32_t	documentFrequency;
+	uint32_t	lastDocument;			// the last document the term was counted for
+} VocabularyEntry;
+
+struct CompletionVocabulary {
+	VocabularyEntry	*entries;
+	size_t			capacity;
+	size_t			count;
+	char			*arena;
+	size_t			arenaLength;
+	size_t			arenaCapacity;
+	uint32_t		documentCount;
+};
+
+static int IsWordByte(unsigned char c) {
+	return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80);
+}
+
+static unsigned char LowerASCII(unsigned char c) {
+	return ((c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c);
+}
+
+static uint32_t HashTerm(const char *term, size_t length) {
+	uint32_t hash = 2166136261u;		// FNV-1a
+	for (size_t i = 0; i < length; i++) {
+		hash = (hash ^ (unsigned char)term[i]) * 16777619u;
+	}
+	return hash;
+}
+
+CompletionVocabulary *CompletionVocabularyCreate(void) {
+	CompletionVocabulary *vocabulary = calloc(1, sizeof(CompletionVocabulary));
+	if (vocabulary == NULL) {
+		return NULL;
+	}
+	vocabulary->capacity = kInitialTableCapacity;
+	vocabulary->entries = calloc(vocabulary->capacity, sizeof(VocabularyEntry));
+	vocabulary->arenaCapacity = kInitialTableCapacity * 8;
+	vocabulary->arena = malloc(vocabulary->arenaCapacity);
+	if (vocabulary->entries == NULL || vocabulary->arena == NULL) {
+		CompletionVocabularyFree(vocabulary);
+		return NULL;
+	}
+	return vocabulary;
+}
+
+void CompletionVocabularyFree(CompletionVocabulary *vocabulary) {
+	if (vocabulary) {
+		free(vocabulary->entries);
+		free(vocabulary->arena);
+		free(vocabulary);
+	}
+}
+
+size_t CompletionVocabularyTermCount(const CompletionVocabulary *vocabulary) {
+	return vocabulary->count;
+}
+
+static int VocabularyGrowTable(CompletionVocabulary *vocabulary) {
+	size_t capacity = vocabulary->capacity * 2;
+	VocabularyEntry *entries = calloc(capacity, sizeof(VocabularyEntry));
+	if (entries == NULL) {
+		return 0;
+	}
+	for (size_t i = 0; i < vocabulary->capacity; i++) {
+		VocabularyEntry *entry = &vocabulary->entries[i];
+		if (entry->termLength) {
+			size_t slot = entry->hash & (capacity - 1);
+			while (entries[slot].termLength) {
+				slot = (slot + 1) & (capacity - 1);
+			}
+			entries[slot] = *entry;
+		}
+	}
+	free(vocabulary->entries);
+	vocabulary->entries = entries;
+	vocabulary->capacity = capacity;
+	return 1;
+}
+
+static int VocabularyCountTerm(CompletionVocabulary *vocabulary, const char *term, size_t length, uint32_t documentFrequency) {
+	uint32_t hash = HashTerm(term, length);
+	size_t slot = hash & (vocabulary->capacity - 1);
+	while (vocabulary->entries[slot].termLength) {
+		VocabularyEntry *entry = &vocabulary->entries[slot];
+		if (entry->hash == hash && entry->termLength == length && memcmp(vocabulary->arena + entry->termOffset, term, length) == 0) {
+			if (entry->lastDocument != vocabulary->documentCount) {
+				entry->lastDocument = vocabulary->documentCount;
+				entry->documentFrequency += documentFrequency;
+			}
+			return 1;
+		}
+		slot = (slot + 1) & (vocabulary->capacity - 1);
+	}
+	
+	if (vocabulary->arenaLength + length > vocabulary->arenaCapacity) {
+		size_t arenaCapacity = vocabulary->arenaCapacity * 2 + length;
+		char *arena = realloc(vocabulary->arena, arenaCapacity);
+		if (arena == NULL) {
+			return 0;
+		}
+		vocabulary->arena = arena;
+		vocabulary->arenaCapacity = arenaCapacity;
+	}
+	VocabularyEntry *entry = &vocabulary->entries[slot];
+	entry->hash = hash;
+	entry->termOffset = (uint32_t)vocabulary->arenaLength;
+	entry->termLength = (uint32_t)length;
+	entry->documentFrequency = documentFrequency;
+	entry->lastDocument = vocabulary->documentCount;
+	memcpy(vocabulary->arena + vocabulary->arenaLength, term, length);
+	vocabulary->arenaLength += length;
+	vocabulary->count++;
+	
+	// Keep the table at most half full
+	if (vocabulary->count * 2 > vocabulary->capacity) {
+		return VocabularyGrowTable(vocabulary);
+	}
+	return 1;
+}
+
+size_t CompletionVocabularyCopyTerms(const CompletionVocabulary *vocabulary, uint32_t minDocumentFrequency,
+									 CompletionVocabularyTerm *terms) {
+	size_t count = 0;
+	for (size_t i = 0; i < vocabulary->capacity; i++) {
+		const VocabularyEntry *entry = &vocabulary->entries[i];
+		if (entry->termLength && entry->documentFrequency >= minDocumentFrequency) {
+			terms[count].term = vocabulary->arena + entry->termOffset;
+			terms[count].length = entry->termLength;
+			terms[count].documentFrequency = entry->documentFrequency;
+			count++;
+		}
+	}
+	return count;
+}
+
+uint64_t CompletionVocabularyTermSetHash(const CompletionVocabulary *vocabulary, uint32_t minDocumentFrequency) {
+	uint64_t hash = 0;
+	for (size_t i = 0; i < vocabulary->capacity; i++) {
+		const VocabularyEntry *entry = &vocabulary->entries[i];
+		if (entry->termLength == 0 || entry->documentFrequency < minDocumentFrequency) {
+			continue;
+		}
+		uint64_t termHash = 14695981039346656037ull;		// FNV-1a, 64 bit
+		for (uint32_t j = 0; j < entry->termLength; j++) {
+			termHash = (termHash ^ (unsigned char)vocabulary->arena[entry->termOffset + j]) * 1099511628211ull;
+		}
+		
+		// Mixed, then summed, so the table's order doesn't matter
+		termHash ^= termHash >> 33;
+		termHash *= 0xff51afd7ed558ccdull;
+		termHash ^= termHash >> 33;
+		hash += termHash;
+	}
+	return hash;
+}
+
+int CompletionVocabularyAddDocument(CompletionVocabulary *vocabulary, const char *text, size_t textLength) {
+	const unsigned char *bytes = (const unsigned char *)text;
+	char term[kCompletionMaxTermLength];
+	size_t i = 0;
+	
+	vocabulary->documentCount++;
+	while (i < textLength) {
+		while (i < textLength && !IsWordByte(bytes[i])) {
+			i++;
+		}
+		size_t length = 0;
+		while (i < textLength && IsWordByte(bytes[i])) {
+			if (length < kCompletionMaxTermLength) {
+				term[length] = (char)LowerASCII(bytes[i]);
+			}
+			length++;
+			i++;
+		}
+		if (length >= 2 && length <= kCompletionMaxTermLength) {
+			if (!VocabularyCountTerm(vocabulary, term, length, 1)) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+int CompletionVocabularyAddTerm(CompletionVocabulary *vocabulary, const char *term, size_t length, uint32_t documentFrequency) {
+	if (length < 2 || length > kCompletionMaxTermLength || documentFrequency == 0) {
+		return 1;
+	}
+	
+	// Each term counted this way is a document of its own, so it adds to the term's count as given
+	vocabulary->documentCount++;
+	return VocabularyCountTerm(vocabulary, term, length, documentFrequency);
+}
+
+
+#pragma mark -
+#pragma mark Dictionary layout
+
+/*
+ * The header is followed by:
+ *	uint32_t	blockOffsets[blockCount]		start of each block in strings
+ *	uint32_t	weights[termCount]
+ *	uint32_t	tree[2 * treeSize]				index of the heaviest term under each node; leaves from treeSize
+ *	char		strings[stringsLength]			per block: length, bytes of the first term, then for
+ *												each other term the bytes shared with the one before,
+ *												suffix length and suffix bytes
+ */
+typedef struct {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	termCount;
+	uint32_t	blockCount;
+	uint32_t	treeSize;			// leaves in the tree: a power of two >= termCount
+	uint32_t	stringsLength;
+} DictionaryHeader;
+
+typedef struct {
+	const DictionaryHeader	*header;
+	const uint32_t			*blockOffsets;
+	const uint32_t			*weights;
+	const uint32_t			*tree;
+	const unsigned char		*strings;
+} Dictionary;
+
+static size_t DictionaryLength(uint32_t termCount, uint32_t blockCount, uint32_t treeSize, uint32_t stringsLength) {
+	return sizeof(DictionaryHeader) + sizeof(uint32_t) * ((size_t)blockCount + termCount + 2 * (size_t)treeSize) + stringsLength;
+}
+
+static void DictionaryOpen(Dictionary *dictionary, const void *bytes) {
+	dictionary->header = bytes;
+	dictionary->blockOffsets = (const uint32_t *)(dictionary->header + 1);
+	dictionary->weights = dictionary->blockOffsets + dictionary->header->blockCount;
+	dictionary->tree = dictionary->weights + dictionary->header->termCount;
+	dictionary->strings = (const unsigned char *)(dictionary->tree + 2 * (size_t)dictionary->header->treeSize);
+}
+
+int CompletionDictionaryIsValid(const void *bytes, size_t length) {
+	if (bytes == NULL || length < sizeof(DictionaryHeader)) {
+		return 0;
+	}
+	const DictionaryHeader *header = bytes;
+	return (header->magic == kDictionaryMagic && header->version == kDictionaryVersion
+			&& header->blockCount == (header->termCount + kBlockSize - 1) / kBlockSize
+			&& header->treeSize >= header->termCount && header->treeSize <= 2 * (size_t)header->termCount + 1
+			&& length == DictionaryLength(header->termCount, header->blockCount, header->treeSize, header->stringsLength));
+}
+
+// Whether a is the heavier term, ties going to the first in sorted order
+static int Heavier(const uint32_t *weights, uint32_t a, uint32_t b) {
+	if (b == kNoTerm) {
+		return a != kNoTerm;
+	}
+	if (a == kNoTerm) {
+		return 0;
+	}
+	return (weights[a] > weights[b] || (weights[a] == weights[b] && a < b));
+}
+
+
+#pragma mark -
+#pragma mark Building
+
+static int CompareSortedTerms(const void *a, const void *b) {
+	const CompletionVocabularyTerm *termA = a, *termB = b;
+	uint32_t length = (termA->length < termB->length ? termA->length : termB->length);
+	int order = memcmp(termA->term, termB->term, length);
+	if (order != 0) {
+		return order;
+	}
+	return (termA->length > termB->length) - (termA->length < termB->length);
+}
+
+int CompletionDictionaryCreate(const CompletionVocabulary *vocabulary, uint32_t minDocumentFrequency,
+							   void **dictionary, size_t *dictionaryLength) {
+	CompletionVocabularyTerm *terms = malloc((vocabulary->count + 1) * sizeof(CompletionVocabularyTerm));
+	if (terms == NULL) {
+		return 0;
+	}
+	uint32_t termCount = (uint32_t)CompletionVocabularyCopyTerms(vocabulary, minDocumentFrequency, terms);
+	qsort(terms, termCount, sizeof(CompletionVocabularyTerm), CompareSortedTerms);
+	
+	uint32_t blockCount = (termCount + kBlockSize - 1) / kBlockSize;
+	uint32_t treeSize = 1;
+	while (treeSize < termCount) {
+		treeSize *= 2;
+	}
+	
+	// Front coding never takes more than two length bytes per term
+	uint32_t stringsLength = 0;
+	for (uint32_t i = 0; i < termCount; i++) {
+		if (i % kBlockSize == 0) {
+			stringsLength += 1 + terms[i].length;
+		}
+		else {
+			uint32_t shared = 0;
+			while (shared < terms[i].length && shared < terms[i - 1].length && terms[i].term[shared] == terms[i - 1].term[shared]) {
+				shared++;
+			}
+			stringsLength += 2 + terms[i].length - shared;
+		}
+	}
+	
+	size_t length = DictionaryLength(termCount, blockCount, treeSize, stringsLength);
+	unsigned char *bytes = calloc(1, length);
+	if (bytes == NULL) {
+		free(terms);
+		return 0;
+	}
+	DictionaryHeader *header = (DictionaryHeader *)bytes;
+	header->magic = kDictionaryMagic;
+	header->version = kDictionaryVersion;
+	header->termCount = termCount;
+	header->blockCount = blockCount;
+	header->treeSize = treeSize;
+	header->stringsLength = stringsLength;
+	
+	Dictionary layout;
+	DictionaryOpen(&layout, bytes);
+	uint32_t *blockOffsets = (uint32_t *)layout.blockOffsets;
+	uint32_t *weights = (uint32_t *)layout.weights;
+	uint32_t *tree = (uint32_t *)layout.tree;
+	unsigned char *strings = (unsigned char *)layout.strings;
+	
+	uint32_t stringsOffset = 0;
+	for (uint32_t i = 0; i < termCount; i++) {
+		weights[i] = terms[i].documentFrequency;
+		if (i % kBlockSize == 0) {
+			blockOffsets[i / kBlockSize] = stringsOffset;
+			strings[stringsOffset++] = (unsigned char)terms[i].length;
+			memcpy(strings + stringsOffset, terms[i].term, terms[i].length);
+			stringsOffset += terms[i].length;
+		}
+		else {
+			uint32_t shared = 0;
+			while (shared < terms[i].length && shared < terms[i - 1].length && terms[i].term[shared] == terms[i - 1].term[shared]) {
+				shared++;
+			}
+			strings[stringsOffset++] = (unsigned char)shared;
+			strings[stringsOffset++] = (unsigned char)(terms[i].length - shared);
+			memcpy(strings + stringsOffset, terms[i].term + shared, terms[i].length - shared);
+			stringsOffset += terms[i].length - shared;
+		}
+	}
+	
+	for (uint32_t i = 0; i < treeSize; i++) {
+		tree[treeSize + i] = (i < termCount ? i : kNoTerm);
+	}
+	for (uint32_t node = treeSize - 1; node >= 1; node--) {
+		uint32_t left = tree[2 * node], right = tree[2 * node + 1];
+		tree[node] = (Heavier(weights, right, left) ? right : left);
+	}
+	tree[0] = kNoTerm;
+	
+	free(terms);
+	*dictionary = bytes;
+	*dictionaryLength = length;
+	return 1;
+}
+
+
+#pragma mark -
+#pragma mark Lookup
+
+// Decodes the term at index into term, returning its length
+static size_t DictionaryTermAtIndex(const Dictionary *dictionary, uint32_t index, char *term) {
+	const unsigned char *p = dictionary->strings + dictionary->blockOffsets[index / kBlockSize];
+	size_t length = *p++;
+	memcpy(term, p, length);
+	p += length;
+	for (uint32_t i = 0; i < index % kBlockSize; i++) {
+		size_t shared = *p++;
+		size_t suffixLength = *p++;
+		memcpy(term + shared, p, suffixLength);
+		p += suffixLength;
+		length = shared + suffixLength;
+	}
+	return length;
+}
+
+// < 0 if the term sorts before every term starting with prefix, 0 if it starts with it, > 0 if after them all
+static int ComparePrefix(const char *term, size_t termLength, const char *prefix, size_t prefixLength) {
+	size_t length = (termLength < prefixLength ? termLength : prefixLength);
+	int order = memcmp(term, prefix, length);
+	if (order != 0) {
+		return order;
+	}
+	return (termLength < prefixLength ? -1 : 0);
+}
+
+// The first term whose comparison with the prefix is at least threshold, or termCount
+static uint32_t DictionaryFindFirst(const Dictionary *dictionary, const char *prefix, size_t prefixLength, int threshold) {
+	uint32_t termCount = dictionary->header->termCount;
+	char term[kCompletionMaxTermLength];
+	
+	// The first block that starts at or past the position
+	uint32_t low = 0, high = dictionary->header->blockCount;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		const unsigned char *first = dictionary->strings + dictionary->blockOffsets[middle];
+		int order = ComparePrefix((const char *)first + 1, first[0], prefix, prefixLength);
+		if ((order < 0 ? -1 : (order > 0)) >= threshold) {
+			high = middle;
+		}
+		else {
+			low = middle + 1;
+		}
+	}
+	if (low == 0) {
+		return 0;
+	}
+	
+	// Otherwise it's in the block before, or is that block's successor's first term
+	uint32_t index = (low - 1) * kBlockSize + 1;
+	uint32_t end = low * kBlockSize;
+	if (end > termCount) {
+		end = termCount;
+	}
+	for (; index < end; index++) {
+		size_t length = DictionaryTermAtIndex(dictionary, index, term);
+		int order = ComparePrefix(term, length, prefix, prefixLength);
+		if ((order < 0 ? -1 : (order > 0)) >= threshold) {
+			return index;
+		}
+	}
+	return end;
+}
+
+// The heaviest term in [start, end)
+static uint32_t DictionaryHeaviestInRange(const Dictionary *dictionary, uint32_t start, uint32_t end) {
+	uint32_t best = kNoTerm;
+	uint32_t left = start + dictionary->header->treeSize;
+	uint32_t right = end + dictionary->header->treeSize;
+	while (left < right) {
+		if (left & 1) {
+			uint32_t candidate = dictionary->tree[left++];
+			if (Heavier(dictionary->weights, candidate, best)) {
+				best = candidate;
+			}
+		}
+		if (right & 1) {
+			uint32_t candidate = dictionary->tree[--right];
+			if (Heavier(dictionary->weights, candidate, best)) {
+				best = candidate;
+			}
+		}
+		left /= 2;
+		right /= 2;
+	}
+	return best;
+}
+
+typedef struct {
+	uint32_t	start;
+	uint32_t	end;
+	uint32_t	heaviest;
+} CompletionRange;
+
+static void HeapPush(CompletionRange *heap, size_t *count, CompletionRange range, const uint32_t *weights) {
+	size_t i = (*count)++;
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (!Heavier(weights, range.heaviest, heap[parent].heaviest)) {
+			break;
+		}
+		heap[i] = heap[parent];
+		i = parent;
+	}
+	heap[i] = range;
+}
+
+static CompletionRange HeapPop(CompletionRange *heap, size_t *count, const uint32_t *weights) {
+	CompletionRange top = heap[0];
+	CompletionRange last = heap[--(*count)];
+	size_t i = 0;
+	for (;;) {
+		size_t child = 2 * i + 1;
+		if (child >= *count) {
+			break;
+		}
+		if (child + 1 < *count && Heavier(weights, heap[child + 1].heaviest, heap[child].heaviest)) {
+			child++;
+		}
+		if (!Heavier(weights, heap[child].heaviest, last.heaviest)) {
+			break;
+		}
+		heap[i] = heap[child];
+		i = child;
+	}
+	heap[i] = last;
+	return top;
+}
+
+size_t CompletionDictionaryComplete(const void *bytes, size_t length,
+									const char *prefix, size_t prefixLength,
+									CompletionCandidate *completions, size_t maxCompletions) {
+	if (!CompletionDictionaryIsValid(bytes, length) || prefixLength > kCompletionMaxTermLength) {
+		return 0;
+	}
+	if (maxCompletions > kMaxCompletions) {
+		maxCompletions = kMaxCompletions;
+	}
+	Dictionary dictionary;
+	DictionaryOpen(&dictionary, bytes);
+	
+	uint32_t start = DictionaryFindFirst(&dictionary, prefix, prefixLength, 0);
+	uint32_t end = DictionaryFindFirst(&dictionary, prefix, prefixLength, 1);
+	if (start >= end) {
+		return 0;
+	}
+	
+	// Best first: take the heaviest term of the heaviest range, then split the range around it
+	CompletionRange heap[2 * kMaxCompletions + 1];
+	size_t heapCount = 0;
+	CompletionRange all = { start, end, DictionaryHeaviestInRange(&dictionary, start, end) };
+	HeapPush(heap, &heapCount, all, dictionary.weights);
+	
+	size_t count = 0;
+	while (count < maxCompletions && heapCount > 0) {
+		CompletionRange range = HeapPop(heap, &heapCount, dictionary.weights);
+		uint32_t index = range.heaviest;
+		size_t termLength = DictionaryTermAtIndex(&dictionary, index, completions[count].term);
+		completions[count].term[termLength] = '\0';
+		completions[count].weight = dictionary.weights[index];
+		count++;
+		
+		if (range.start < index) {
+			CompletionRange before = { range.start, index, DictionaryHeaviestInRange(&dictionary, range.start, index) };
+			HeapPush(heap, &heapCount, before, dictionary.weights);
+		}
+		if (index + 1 < range.end) {
+			CompletionRange after = { index + 1, range.end, DictionaryHeaviestInRange(&dictionary, index + 1, range.end) };
+			HeapPush(heap, &heapCount, after, dictionary.weights);
+		}
+	}
+	return count;
+}
@@ -0,0 +1,116 @@
+//
+//  CompletionDictionary.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#ifndef COMPLETIONDICTIONARY_H
+#define COMPLETIONDICTIONARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define kCompletionMaxTermLength	32		// longer words aren't offered as completions
+
+/*
+ * Counts the document frequency of every word in a set of documents, for
+ * building a completion dictionary.
+ *
+ * Words are split as in SnippetSelect() and lower cased (ASCII only), and
+ * words shorter than two bytes are ignored.
+ */
+typedef struct CompletionVocabulary CompletionVocabulary;
+
+CompletionVocabulary *CompletionVocabularyCreate(void);
+void CompletionVocabularyFree(CompletionVocabulary *vocabulary);
+int CompletionVocabularyAddDocument(CompletionVocabulary *vocabulary, const char *text, size_t textLength);
+size_t CompletionVocabularyTermCount(const CompletionVocabulary *vocabulary);
+
+/*
+ * Counts a term as being in documentFrequency more documents, for building a
+ * vocabulary from an index that already knows each word's notes rather than
+ * from the text.  The term must already be lower case.
+ */
+int CompletionVocabularyAddTerm(CompletionVocabulary *vocabulary, const char *term, size_t length, uint32_t documentFrequency);
+
+typedef struct {
+	const char	*term;					// not nul terminated; owned by the vocabulary
+	uint32_t	length;
+	uint32_t	documentFrequency;
+} CompletionVocabularyTerm;
+
+/*
+ * Copies out the terms with a document frequency of at least
+ * minDocumentFrequency, in no particular order.  terms must have room for
+ * CompletionVocabularyTermCount() entries.  Returns the number copied.
+ */
+size_t CompletionVocabularyCopyTerms(const CompletionVocabulary *vocabulary, uint32_t minDocumentFrequency,
+									 CompletionVocabularyTerm *terms);
+
+/*
+ * Hashes the set of terms with a document frequency of at least
+ * minDocumentFrequency, whatever their frequencies and the order they were
+ * added in, for telling whether a dictionary drawn from them needs rebuilding.
+ */
+uint64_t CompletionVocabularyTermSetHash(const CompletionVocabulary *vocabulary, uint32_t minDocumentFrequency);
+
+/*
+ * Serialises the vocabulary's terms with a document frequency of at least
+ * minDocumentFrequency into a completion dictionary, a single flat buffer that
+ * can be written out and later memory mapped.  The buffer is allocated with
+ * malloc().  Returns 0 on failure.
+ *
+ * Terms are sorted and front coded in blocks of 16, so a dictionary is much
+ * smaller than the term list.  A tree of maximum weights over the sorted terms
+ * lets the most frequent completions of a prefix be found without looking at
+ * the other terms that share it.
+ */
+int CompletionDictionaryCreate(const CompletionVocabulary *vocabulary, uint32_t minDocumentFrequency,
+							   void **dictionary, size_t *dictionaryLength);
+
+typedef struct {
+	char		term[kCompletionMaxTermLength + 1];		// nul terminated
+	uint32_t	weight;									// document frequency
+} CompletionCandidate;
+
+// Whether a buffer (e.g. read back from a file) holds a usable dictionary
+int CompletionDictionaryIsValid(const void *dictionary, size_t dictionaryLength);
+
+/*
+ * Finds the maxCompletions terms starting with prefix that have the highest
+ * weights, most frequent first.  The prefix must already be lower case.
+ * Takes O(log n) per completion plus O(log n) to find the prefix.
+ */
+size_t CompletionDictionaryComplete(const void *dictionary, size_t dictionaryLength,
+									const char *prefix, size_t prefixLength,
+									CompletionCandidate *completions, size_t maxCompletions);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
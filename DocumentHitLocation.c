@@ -0,0 +1,82 @@
+//
+//  DocumentHitLocation.c
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#include "DocumentHitLocation.h"
+
+
+static int IsWordByte(unsigned char c) {
+	return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80);
+}
+
+static unsigned char LowerASCII(unsigned char c) {
+	return ((c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c);
+}
+
+static int WordMatchesTerm(const unsigned char *word, size_t wordLength, const char *term, size_t termLength) {
+	if (termLength == 0 || termLength > wordLength) {
+		return 0;
+	}
+	for (size_t i = 0; i < termLength; i++) {
+		if (LowerASCII(word[i]) != (unsigned char)term[i]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+size_t DocumentLocateHits(const char *text, size_t textLength,
+						  const char *const *terms, const size_t *termLengths, size_t termCount,
+						  const XHTMLOffsetMapEntry *map, size_t mapCount,
+						  DocumentHit *hits, size_t maxHits) {
+	const unsigned char *bytes = (const unsigned char *)text;
+	size_t hitCount = 0;
+	size_t i = 0;
+	
+	while (i < textLength && hitCount < maxHits) {
+		while (i < textLength && !IsWordByte(bytes[i])) {
+			i++;
+		}
+		size_t wordStart = i;
+		while (i < textLength && IsWordByte(bytes[i])) {
+			i++;
+		}
+		size_t wordLength = i - wordStart;
+		if (wordLength == 0) {
+			break;
+		}
+		for (size_t t = 0; t < termCount; t++) {
+			if (WordMatchesTerm(bytes + wordStart, wordLength, terms[t], termLengths[t])) {
+				size_t start = XHTMLSourceOffsetForTextOffset(map, mapCount, wordStart);
+				size_t end = XHTMLSourceOffsetForTextOffset(map, mapCount, i);
+				hits[hitCount].location = start;
+				hits[hitCount].length = end - start;
+				hitCount++;
+				break;
+			}
+		}
+	}
+	return hitCount;
+}
@@ -0,0 +1,60 @@
+//
+//  DocumentHitLocation.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#ifndef DOCUMENTHITLOCATION_H
+#define DOCUMENTHITLOCATION_H
+
+#include <stddef.h>
+
+#include "XHTMLTextExtraction.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	size_t	location;
+	size_t	length;
+} DocumentHit;
+
+/*
+ * Finds the words of UTF-8 extracted text that start with a query term and
+ * returns where they are in the XHTML source, in document order.
+ *
+ * Words match terms as in SnippetSelect(): by prefix, ignoring ASCII case, so
+ * terms must already be lower case.  map is the offset map recorded when the
+ * text was extracted.  Returns the number of hits, at most maxHits.
+ */
+size_t DocumentLocateHits(const char *text, size_t textLength,
+						  const char *const *terms, const size_t *termLengths, size_t termCount,
+						  const XHTMLOffsetMapEntry *map, size_t mapCount,
+						  DocumentHit *hits, size_t maxHits);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -30,8 +30,9 @@
 
 @class Note;
 
-@interface EditNoteViewController : UIViewController <UISplitViewControllerDelegate, UITextViewDelegate, MFMailComposeViewControllerDelegate, UIPopoverControllerDelegate, UIActionSheetDelegate> {
+@interface EditNoteViewController : UIViewController <UISplitViewControllerDelegate, UITextViewDelegate, UIWebViewDelegate, MFMailComposeViewControllerDelegate, UIPopoverControllerDelegate, UIActionSheetDelegate> {
 	Note					*note;
+	NSSet					*queryTerms;
 	
 	UIWebView				*contentTextView;
 	UIPopoverController		*currentPopoverController;
@@ -40,9 +41,16 @@
 	
 @private
 	CGFloat					contentTextViewOriginalHeight;
+	
+	UISegmentedControl		*hitNavigationControl;
+	NSUInteger				hitCount;
+	NSUInteger				currentHitIndex;
+	NSUInteger				highlightRequestCount;		// identifies the latest background highlight
+	BOOL					showFirstHitAfterLoad;
 }
 
 @property (nonatomic, retain)	Note					*note;
+@property (nonatomic, copy)		NSSet					*queryTerms;		// terms of the search the note was opened from, if any
 
 @property (nonatomic, retain)	IBOutlet	UIWebView				*contentTextView;
 @property (nonatomic, retain)				UIPopoverController		*currentPopoverController;
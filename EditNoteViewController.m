@@ -26,13 +26,20 @@
 //
 
 #import "EditNoteViewController.h"
+#import "AppDelegate_Shared.h"
 #import "InfoViewController.h"
 #import "Note+Management.h"
+#import "NoteDocumentStore.h"
+#import "NoteHitHighlighter.h"
 #import "SettingsTableViewController.h"
 #import "ShareViewTableController.h"
 
 #define kTitleLength 50
 
+#define kPreviousHitSegment		0
+#define kHitPositionSegment		1
+#define kNextHitSegment			2
+
 
 @implementation EditNoteViewController
 
@@ -40,6 +47,7 @@
 @synthesize currentPopoverController;
 @synthesize ipadToolbar;
 @synthesize note;
+@synthesize queryTerms;
 @synthesize splitViewPopoverController;
 
 
@@ -196,7 +204,81 @@
 	}*/
 }
 
+
+#pragma mark -
+#pragma mark Search hits
+
+- (void)updateHitNavigation {
+	hitNavigationControl.hidden = (hitCount == 0);
+	if (hitCount > 0) {
+		[hitNavigationControl setTitle:[NSString stringWithFormat:@"%lu of %lu", (unsigned long)currentHitIndex + 1, (unsigned long)hitCount]
+					 forSegmentAtIndex:kHitPositionSegment];
+	}
+}
+
+- (void)showHitAtIndex:(NSUInteger)hitIndex {
+	if (hitIndex >= hitCount) {
+		return;
+	}
+	currentHitIndex = hitIndex;
+	[self.contentTextView stringByEvaluatingJavaScriptFromString:[NoteHitHighlighter scriptToShowHitAtIndex:hitIndex]];
+	[self updateHitNavigation];
+}
+
+- (void)hitNavigationAction:(UISegmentedControl *)control {
+	if (hitCount == 0) {
+		return;
+	}
+	// Wraps around at either end
+	if (control.selectedSegmentIndex == kNextHitSegment) {
+		[self showHitAtIndex:(currentHitIndex + 1) % hitCount];
+	}
+	else if (control.selectedSegmentIndex == kPreviousHitSegment) {
+		[self showHitAtIndex:(currentHitIndex + hitCount - 1) % hitCount];
+	}
+}
+
+- (void)resetHits {
+	highlightRequestCount++;	// drops any highlight still being built
+	hitCount = 0;
+	currentHitIndex = 0;
+	showFirstHitAfterLoad = NO;
+	[self updateHitNavigation];
+}
+
+/**
+ Finds and marks up the query's hits off the main thread, then loads the marked up document.  Nothing is loaded in
+ the meantime, so the document appears once, with its hits, rather than being reloaded.
+ */
+- (void)loadDocumentHighlightingQueryTerms {
+	NoteDocumentStore *documentStore = [[AppDelegate_Shared sharedAppDelegate] noteDocumentStore];
+	NSString *documentName = self.note.title;
+	NSString *noteText = self.note.content;		// managed objects stay on the main thread
+	NSSet *terms = self.queryTerms;
+	NSUInteger requestNumber = highlightRequestCount;
+	
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0), ^{
+		@autoreleasepool {
+			NoteHitHighlighter *highlighter = [NoteHitHighlighter highlighterForDocumentNamed:documentName
+																					 noteText:noteText
+																				   queryTerms:terms
+																				documentStore:documentStore];
+			dispatch_async(dispatch_get_main_queue(), ^{
+				if (requestNumber != highlightRequestCount) {
+					return;		// another note was opened in the meantime
+				}
+				NSData *documentData = (highlighter ? highlighter.highlightedData : [documentStore dataForDocumentNamed:documentName]);
+				hitCount = highlighter.hitCount;
+				showFirstHitAfterLoad = (hitCount > 0);
+				[self.contentTextView loadData:documentData MIMEType:@"application/xhtml+xml" textEncodingName:@"utf-8" baseURL:[documentStore baseURL]];
+			});
+		}
+	});
+}
+
 - (void)updateViewForNote {
+	[self resetHits];
+	
 	if (self.note) {
 		contentTextView.hidden = NO;
 				
@@ -208,9 +290,18 @@
 			// Otherwise default to keyboard hidden
 			[self.contentTextView resignFirstResponder];
 		}
-        NSURL *url = [NSURL fileURLWithPath:[[[NSBundle mainBundle] resourcePath] stringByAppendingFormat:@"/html/%@", self.note.title]];
-        NSLog(@"URL for loading: %@", url);
-        [self.contentTextView loadRequest:[NSURLRequest requestWithURL:url]];
+		// Hand the web view the document's mapped bytes instead of having it read the file again
+		NoteDocumentStore *documentStore = [[AppDelegate_Shared sharedAppDelegate] noteDocumentStore];
+		NSData *documentData = [documentStore dataForDocumentNamed:self.note.title];
+		if (documentData && [self.queryTerms count] > 0) {
+			[self loadDocumentHighlightingQueryTerms];
+		}
+		else if (documentData) {
+			[self.contentTextView loadData:documentData MIMEType:@"application/xhtml+xml" textEncodingName:@"utf-8" baseURL:[documentStore baseURL]];
+		}
+		else {
+			[self.contentTextView loadHTMLString:@"<html></html>" baseURL:[NSURL fileURLWithPath:@"/"]];
+		}
 
 	}
 	else {
@@ -229,6 +320,8 @@
 
 - (void)clear {
 	self.note = nil;
+	self.queryTerms = nil;
+	[self resetHits];
     [self.contentTextView loadHTMLString:@"<html></html>" baseURL:[NSURL fileURLWithPath:@"/"]];
 	
 	[self.contentTextView resignFirstResponder];
@@ -252,6 +345,15 @@
 - (void)viewDidLoad {
     [super viewDidLoad];
 	
+	// Steps through the hits of the search the note was opened from
+	hitNavigationControl = [[UISegmentedControl alloc] initWithItems:[NSArray arrayWithObjects:@"<", @"", @">", nil]];
+	hitNavigationControl.segmentedControlStyle = UISegmentedControlStyleBar;
+	hitNavigationControl.momentary = YES;
+	[hitNavigationControl setEnabled:NO forSegmentAtIndex:kHitPositionSegment];
+	[hitNavigationControl setWidth:80.0 forSegmentAtIndex:kHitPositionSegment];
+	[hitNavigationControl addTarget:self action:@selector(hitNavigationAction:) forControlEvents:UIControlEventValueChanged];
+	hitNavigationControl.hidden = YES;
+	
 	if (UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPad) {
 		// Size and add a navigation bar
 		CGRect frame = self.ipadToolbar.frame;
@@ -287,8 +389,11 @@
         [infoButton addTarget:self action:@selector(infoButtonAction) forControlEvents:UIControlEventTouchUpInside];
         UIBarButtonItem *infoBarButtonItem = [[UIBarButtonItem alloc] initWithCustomView:infoButton];
 		
-		ipadToolbar.items = [NSArray arrayWithObjects:flexibleSpace, settingsButton, fixedSpace1, shareButton, fixedSpace2, infoBarButtonItem, nil];
+		UIBarButtonItem *hitNavigationItem = [[UIBarButtonItem alloc] initWithCustomView:hitNavigationControl];
+		
+		ipadToolbar.items = [NSArray arrayWithObjects:hitNavigationItem, flexibleSpace, settingsButton, fixedSpace1, shareButton, fixedSpace2, infoBarButtonItem, nil];
 		
+		[hitNavigationItem release];
         [infoBarButtonItem release];
 		[settingsButton release];
 		[shareButton release];
@@ -305,6 +410,7 @@
 	else {
 		// iPhone UI
 		[self addShareButtonToNavbar];
+		self.navigationItem.titleView = hitNavigationControl;
 	}
 
 
@@ -341,6 +447,9 @@
 
 - (void)viewDidUnload {
     [super viewDidUnload];
+	
+	[hitNavigationControl release];
+	hitNavigationControl = nil;
     // Release any retained subviews of the main view.
     // e.g. self.myOutlet = nil;
 	
@@ -353,25 +462,27 @@
 
 - (BOOL)textView:(UITextView *)textView shouldChangeTextInRange:(NSRange)range replacementText:(NSString *)text {
 	
-	// Cancel any pending delayed saves.
+	// Note saves are coalesced and flushed in batches by the note save queue, so
+	// just wait for a pause in typing before picking up the changes
 	[NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(saveNote) object:nil];
-	
-	NSRange alphaNumericRange = [text rangeOfCharacterFromSet:[NSCharacterSet alphanumericCharacterSet]];
-	if (![text isEqualToString:@""] && alphaNumericRange.location == NSNotFound) {
-		// Save note (and update search index) whenever a non-alphanumeric key is typed
-		[self saveNote];
-	}
-	else {
-		// Otherwise schedule a delayed save.
-		[self performSelector:@selector(saveNote) withObject:nil afterDelay:1.0];
-	}
-
+	[self performSelector:@selector(saveNote) withObject:nil afterDelay:1.0];
 	
 	return YES;
 }
 
 
 
+#pragma mark -
+#pragma mark UIWebViewDelegate methods
+
+- (void)webViewDidFinishLoad:(UIWebView *)webView {
+	if (showFirstHitAfterLoad) {
+		showFirstHitAfterLoad = NO;
+		[self showHitAtIndex:0];
+	}
+}
+
+
 #pragma mark -
 #pragma mark UISplitViewControllerDelegate methods
 
@@ -523,7 +634,9 @@
 	[currentPopoverController release];
 	[ipadToolbar release];
 	[note release];
+	[queryTerms release];
 	[splitViewPopoverController release];
+	[hitNavigationControl release];
 
     [super dealloc];
 }
@@ -0,0 +1,75 @@
+//
+//  LocalSearchResult.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import <Foundation/Foundation.h>
+#import <LocaytaSearch/LSLocaytaSearchResult.h>
+
+#include "NoteIndex.h"
+
+@class SearchNoteIndex;
+
+
+/*
+ * The matches of a search engine result, restricted to a range of dates or
+ * put in order by the app's note index (see SearchNoteIndex) rather than by
+ * the engine.
+ *
+ * Results carry the same stored fields as the engine's, and the engine's
+ * query terms, and the match count is that of the whole match set.
+ *
+ * A paged result holds every note of its match set, as numbered in the note
+ * index, and loads the results after the first page from the index in order,
+ * so it needn't be followed by the engine's.  Otherwise the result holds
+ * every match.
+ */
+@interface LocalSearchResult : LSLocaytaSearchResult {
+@private
+	NSString	*localQueryString;
+	NSSet		*localQueryTerms;
+	NSArray		*localResults;
+	NSInteger	localMatchCount;
+	BOOL		localMatchCountExact;
+	
+	SearchNoteIndex		*pageNoteIndex;
+	NSData				*pageNotes;			// uint32_t note numbers
+	NoteIndexOrder		pageOrder;
+}
+
+@property (nonatomic, readonly)	BOOL	isPaged;
+
++ (LocalSearchResult *)resultWithQueryString:(NSString *)queryString queryTerms:(NSSet *)queryTerms results:(NSArray *)results
+								  matchCount:(NSInteger)matchCount matchCountExact:(BOOL)matchCountExact;
++ (LocalSearchResult *)resultWithQueryString:(NSString *)queryString queryTerms:(NSSet *)queryTerms results:(NSArray *)results
+								   noteIndex:(SearchNoteIndex *)noteIndex notes:(NSData *)notes order:(NoteIndexOrder)order;
+
+// Results in a range of the match set, from the note index, or nil unless the result is paged
+- (NSArray *)resultsInRange:(NSRange)range;
+
+// Facet counts of the match set, from the note index (see -[SearchNoteIndex facetCountsForNotes:]), or nil unless the
+// result is paged
+- (NSDictionary *)facetCounts;
+
+@end
@@ -0,0 +1,140 @@
+//
+//  LocalSearchResult.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import "LocalSearchResult.h"
+#import "RefinedSearchResult.h"
+#import "SearchNoteIndex.h"
+
+
+@interface LocalSearchResult ()
+- (id)initWithQueryString:(NSString *)aQueryString queryTerms:(NSSet *)someQueryTerms results:(NSArray *)someResults
+			   matchCount:(NSInteger)aMatchCount matchCountExact:(BOOL)aMatchCountExact
+				noteIndex:(SearchNoteIndex *)aNoteIndex notes:(NSData *)someNotes order:(NoteIndexOrder)anOrder;
+@end
+
+
+@implementation LocalSearchResult
+
++ (LocalSearchResult *)resultWithQueryString:(NSString *)queryString queryTerms:(NSSet *)queryTerms results:(NSArray *)results
+								  matchCount:(NSInteger)matchCount matchCountExact:(BOOL)matchCountExact {
+	return [[[LocalSearchResult alloc] initWithQueryString:queryString queryTerms:queryTerms results:results
+												matchCount:matchCount matchCountExact:matchCountExact
+												 noteIndex:nil notes:nil order:NoteIndexOrderNewestFirst] autorelease];
+}
+
++ (LocalSearchResult *)resultWithQueryString:(NSString *)queryString queryTerms:(NSSet *)queryTerms results:(NSArray *)results
+								   noteIndex:(SearchNoteIndex *)noteIndex notes:(NSData *)notes order:(NoteIndexOrder)order {
+	return [[[LocalSearchResult alloc] initWithQueryString:queryString queryTerms:queryTerms results:results
+												matchCount:([notes length] / sizeof(uint32_t)) matchCountExact:YES
+												 noteIndex:noteIndex notes:notes order:order] autorelease];
+}
+
+- (BOOL)isPaged {
+	return (pageNoteIndex != nil);
+}
+
+- (NSArray *)resultsInRange:(NSRange)range {
+	return [pageNoteIndex resultsForNotes:pageNotes order:pageOrder inRange:range];
+}
+
+- (NSDictionary *)facetCounts {
+	return [pageNoteIndex facetCountsForNotes:pageNotes];
+}
+
+
+#pragma mark -
+#pragma mark LSLocaytaSearchResult properties
+
+- (NSString *)requestedQueryString {
+	return localQueryString;
+}
+
+- (NSString *)correctedQueryString {
+	return nil;
+}
+
+- (NSString *)suggestedQueryString {
+	return nil;
+}
+
+- (NSSet *)queryTerms {
+	if (localQueryTerms) {
+		return localQueryTerms;
+	}
+	return [NSSet setWithArray:[RefinedSearchResult plainTermsInQueryString:localQueryString]];
+}
+
+- (BOOL)wasAutoSpellCorrected {
+	return NO;
+}
+
+- (NSInteger)itemCount {
+	return [localResults count];
+}
+
+- (NSInteger)matchCount {
+	return localMatchCount;
+}
+
+- (BOOL)matchCountExact {
+	return localMatchCountExact;
+}
+
+- (NSArray *)results {
+	return localResults;
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithQueryString:(NSString *)aQueryString queryTerms:(NSSet *)someQueryTerms results:(NSArray *)someResults
+			   matchCount:(NSInteger)aMatchCount matchCountExact:(BOOL)aMatchCountExact
+				noteIndex:(SearchNoteIndex *)aNoteIndex notes:(NSData *)someNotes order:(NoteIndexOrder)anOrder {
+	if ((self = [super init])) {
+		localQueryString = [aQueryString copy];
+		localQueryTerms = [someQueryTerms copy];
+		localResults = [someResults copy];
+		localMatchCount = aMatchCount;
+		localMatchCountExact = aMatchCountExact;
+		pageNoteIndex = [aNoteIndex retain];
+		pageNotes = [someNotes copy];
+		pageOrder = anOrder;
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[localQueryString release];
+	[localQueryTerms release];
+	[localResults release];
+	[pageNoteIndex release];
+	[pageNotes release];
+	
+	[super dealloc];
+}
+
+@end
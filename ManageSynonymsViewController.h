@@ -41,5 +41,3 @@
 - (IBAction)addRowAction;
 
 @end
-
-NSInteger customAlphabeticSort(id array1, id array2, void *reverse);
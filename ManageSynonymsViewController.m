@@ -26,11 +26,11 @@
 //
 
 #import "ManageSynonymsViewController.h"
-#import <LocaytaSearch/LSLocaytaSearchThesaurus.h>
 
 #import "AppDelegate_Shared.h"
 #import "EditSynonymCell.h"
 #import "ManageSynonymsTableViewController.h"
+#import "SearchThesaurus.h"
 
 
 @implementation ManageSynonymsViewController
@@ -39,12 +39,17 @@
 @synthesize synonymsTableViewController;
 
 
+/**
+ Applies only the rows that were added, changed or removed, rather than rewriting the whole thesaurus.
+ */
 - (void)saveSynonymsToSearchDatabase {
-	NSString *databasePath = [[AppDelegate_Shared sharedAppDelegate] searchDatabasePath];
-	LSLocaytaSearchThesaurus *thesaurus = [[LSLocaytaSearchThesaurus alloc] initWithDatabasePath:databasePath];
-	[thesaurus clearSynonyms];
-	[thesaurus addSynonymsFromArray:self.synonymsTableViewController.synonyms];
-	[thesaurus release];
+	SearchThesaurus *thesaurus = [[AppDelegate_Shared sharedAppDelegate] searchThesaurus];
+	NSUInteger changeCount = [thesaurus applyEditedRows:self.synonymsTableViewController.synonyms];
+	DLog(@"%u synonym rows changed", changeCount);
+	if (changeCount > 0) {
+		[thesaurus save];
+		[[NSNotificationCenter defaultCenter] postNotificationName:kSearchThesaurusDidChangeNotification object:thesaurus];
+	}
 }
 
 - (void)endCellTextEditing {
@@ -82,21 +87,10 @@
 }
 
 - (void)loadSynonyms {
-	
-	NSString *databasePath = [[AppDelegate_Shared sharedAppDelegate] searchDatabasePath];
-	LSLocaytaSearchThesaurus *thesaurus = [[LSLocaytaSearchThesaurus alloc] initWithDatabasePath:databasePath];
-	NSDictionary *synonymsDict = [thesaurus getSynonyms];
-	NSMutableArray *synonymsArray = [[NSMutableArray alloc] init];
-	for (NSString *key in synonymsDict) {
-		NSArray *row = [NSArray arrayWithObject:key];
-		[synonymsArray addObject:[row arrayByAddingObjectsFromArray:[synonymsDict valueForKey:key]]];
-	}
-	int reverseSort = NO;
-	[synonymsArray sortUsingFunction:customAlphabeticSort context:&reverseSort];
+	// The thesaurus keeps its rows sorted
+	NSMutableArray *synonymsArray = [[[[AppDelegate_Shared sharedAppDelegate] searchThesaurus] rows] mutableCopy];
 	self.synonymsTableViewController.synonyms = synonymsArray;
 	[synonymsArray release];
-	
-	[thesaurus release];
 }
 
 
@@ -180,13 +174,3 @@
 
 @end
 
-
-NSInteger customAlphabeticSort(id array1, id array2, void *reverse) {
-	NSString *string1 = [array1 objectAtIndex:0];
-	NSString *string2 = [array2 objectAtIndex:0];
-	
-	if ((NSInteger *)reverse == NO) {
-		return [string2 localizedCaseInsensitiveCompare:string1];
-	}
-	return [string1 localizedCaseInsensitiveCompare:string2];
-}
@@ -28,10 +28,21 @@
 #import <Foundation/Foundation.h>
 #import "Note.h"
 
+// Keys of the dictionaries returned by searchValuesOfAllNotesInContext:
+#define kNoteSearchValueIDKey			@"id"
+#define kNoteSearchValueTitleKey		@"title"
+#define kNoteSearchValueContentKey		@"content"
+#define kNoteSearchValueLastUpdatedKey	@"lastUpdated"
+
+
 @interface Note ( Management ) 
 
 + (id)createAndSaveNewEmptyNote;
 + (Note *)noteForObjectID:(NSString *)objectIDString;
++ (NSString *)contentForNoteWithObjectID:(NSString *)objectIDString;
++ (NSString *)contentForNoteWithObjectID:(NSString *)objectIDString inContext:(NSManagedObjectContext *)context;
++ (NSArray *)searchValuesOfAllNotesInContext:(NSManagedObjectContext *)context;
++ (NSUInteger)countOfAllNotesWithLatestUpdate:(NSDate **)latestUpdate;
 + (BOOL)deleteNote:(Note *)note error:(NSError **)anError;
 - (void)saveNote;
 
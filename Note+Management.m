@@ -27,6 +27,7 @@
 
 #import "Note+Management.h"
 #import "AppDelegate_Shared.h"
+#import "NoteSaveQueue.h"
 #import "SearchDatabaseUpdater.h"
 
 @implementation Note ( Management )
@@ -39,7 +40,9 @@
 	note.title = @"Untitled";
 	note.content = @"";
 	
+	// Save a new note straight away rather than waiting for the next flush
 	[note saveNote];
+	[appDelegate.noteSaveQueue flush];
 	
 	return note;
 }
@@ -52,10 +55,82 @@
 	return note;
 }
 
++ (NSString *)contentForNoteWithObjectID:(NSString *)objectIDString {
+	return [self contentForNoteWithObjectID:objectIDString inContext:[[AppDelegate_Shared sharedAppDelegate] managedObjectContext]];
+}
+
++ (NSString *)contentForNoteWithObjectID:(NSString *)objectIDString inContext:(NSManagedObjectContext *)context {
+	NSManagedObjectID *objectID = [[context persistentStoreCoordinator] managedObjectIDForURIRepresentation:[NSURL URLWithString:objectIDString]];
+	if (nil == objectID) {
+		return nil;
+	}
+	// Unlike noteForObjectID:, fetch the note if it isn't already in memory - search results don't carry note bodies
+	Note *note = (Note *)[context existingObjectWithID:objectID error:NULL];
+	return note.content;
+}
+
+/**
+ Returns the ID, title, content and lastUpdated of every note, as dictionaries with those keys, without faulting the
+ notes themselves in.  The context can be one of a background queue's own, as the dictionaries hold no managed objects.
+ */
++ (NSArray *)searchValuesOfAllNotesInContext:(NSManagedObjectContext *)context {
+	NSExpressionDescription *objectIDDescription = [[NSExpressionDescription alloc] init];
+	objectIDDescription.name = @"objectID";
+	objectIDDescription.expression = [NSExpression expressionForEvaluatedObject];
+	objectIDDescription.expressionResultType = NSObjectIDAttributeType;
+	
+	NSFetchRequest *request = [[NSFetchRequest alloc] initWithEntityName:@"Note"];
+	request.resultType = NSDictionaryResultType;
+	request.propertiesToFetch = [NSArray arrayWithObjects:objectIDDescription, @"title", @"content", @"lastUpdated", nil];
+	[objectIDDescription release];
+	
+	NSError *error = nil;
+	NSArray *rows = [context executeFetchRequest:request error:&error];
+	[request release];
+	if (nil == rows) {
+		DLog(@"Couldn't fetch note values: %@", error);
+		return nil;
+	}
+	
+	NSMutableArray *values = [NSMutableArray arrayWithCapacity:[rows count]];
+	for (NSDictionary *row in rows) {
+		NSString *noteID = [[[row objectForKey:@"objectID"] URIRepresentation] absoluteString];
+		if (noteID) {
+			NSMutableDictionary *noteValues = [row mutableCopy];
+			[noteValues removeObjectForKey:@"objectID"];
+			[noteValues setObject:noteID forKey:kNoteSearchValueIDKey];
+			[values addObject:noteValues];
+			[noteValues release];
+		}
+	}
+	return values;
+}
+
+/**
+ Returns the number of notes, and when the most recently updated of them was updated.
+ */
++ (NSUInteger)countOfAllNotesWithLatestUpdate:(NSDate **)latestUpdate {
+	NSManagedObjectContext *context = [[AppDelegate_Shared sharedAppDelegate] managedObjectContext];
+	NSFetchRequest *request = [[NSFetchRequest alloc] initWithEntityName:@"Note"];
+	NSError *error = nil;
+	NSUInteger count = [context countForFetchRequest:request error:&error];
+	
+	request.resultType = NSDictionaryResultType;
+	request.propertiesToFetch = [NSArray arrayWithObject:@"lastUpdated"];
+	request.sortDescriptors = [NSArray arrayWithObject:[NSSortDescriptor sortDescriptorWithKey:@"lastUpdated" ascending:NO]];
+	request.fetchLimit = 1;
+	NSArray *rows = [context executeFetchRequest:request error:&error];
+	[request release];
+	
+	*latestUpdate = [[rows lastObject] objectForKey:@"lastUpdated"];
+	return count;
+}
+
 + (BOOL)deleteNote:(Note *)note error:(NSError **)anError {
 	AppDelegate_Shared *appDelegate = [[UIApplication sharedApplication] delegate];
 	NSString *noteObjectID = [[[note objectID] URIRepresentation] absoluteString];
 	
+	[appDelegate.noteSaveQueue cancelSaveForNote:note];
 	[appDelegate.managedObjectContext deleteObject:note];
 	
 	if (![appDelegate.managedObjectContext save:anError]) {
@@ -72,20 +147,16 @@
 }
 
 - (void)saveNote {
-	// Save out to the persistent store
-	self.lastUpdated = [NSDate date];
+	// Only an edit makes a note newer, so saving one unchanged doesn't move it in date order or have it reindexed
+	NSDictionary *changedValues = [self changedValues];
+	if (nil == self.lastUpdated || [changedValues objectForKey:@"title"] || [changedValues objectForKey:@"content"]) {
+		self.lastUpdated = [NSDate date];
+	}
 	
-	// Save to core data
+	// Saving to core data and updating the search database are deferred, so
+	// that repeated saves of the same note are coalesced
 	AppDelegate_Shared *appDelegate = [[UIApplication sharedApplication] delegate];
-	NSError *error = nil;
-	if (![appDelegate.managedObjectContext save:&error]) {
-		// Save failed
-		ALog(@"Error %@", [error localizedDescription]);
-	}
-	else {
-		// Save succeeded, so update search database
-		[appDelegate.searchDatabaseUpdater updateSearchDatabaseForNote:self];
-	}
+	[appDelegate.noteSaveQueue scheduleSaveForNote:self];
 }
 
 @end
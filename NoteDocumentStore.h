@@ -0,0 +1,77 @@
+//
+//  NoteDocumentStore.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+// Facets of the bundled documents (see facetValuesForDocumentNamed:)
+#define kNoteFacetCourse			@"course"
+#define kNoteFacetDocumentType		@"type"
+
+
+/*
+ * Read-only access to the bundled note documents (the XHTML files under
+ * Resources/html).
+ *
+ * Document data is memory mapped rather than read, so callers get the file
+ * contents without a copy being made.  Mapped pages are clean and backed by
+ * the file, so the system can reclaim them under memory pressure instead of
+ * the app receiving memory warnings.  Recently used mappings are cached so the
+ * importer, the search updater and the note viewer share them.
+ *
+ * Offset maps (see XHTMLExtractTextWithOffsetMap()) built when documents are
+ * indexed can be kept alongside, in offsetMapDirectoryPath, so the viewer can
+ * place search hits without extracting the document again.  The extracted
+ * text can be kept too, for result snippets.  A stored map or text is only
+ * returned while the document it was built from is unchanged.
+ *
+ * Safe to use from any thread.
+ */
+@interface NoteDocumentStore : NSObject {
+	NSString	*directoryPath;
+	NSString	*pathExtension;
+	NSString	*offsetMapDirectoryPath;
+	
+@private
+	NSCache		*mappedDocuments;
+}
+
+@property (nonatomic, copy, readonly)	NSString	*directoryPath;
+@property (nonatomic, copy, readonly)	NSString	*pathExtension;
+@property (nonatomic, copy, readonly)	NSString	*offsetMapDirectoryPath;	// nil if offset maps aren't kept
+
+- (id)initWithDirectoryPath:(NSString *)aDirectoryPath pathExtension:(NSString *)aPathExtension;
+- (id)initWithDirectoryPath:(NSString *)aDirectoryPath pathExtension:(NSString *)aPathExtension offsetMapDirectoryPath:(NSString *)anOffsetMapDirectoryPath;
+- (NSArray *)documentNames;
+- (NSData *)dataForDocumentNamed:(NSString *)documentName;
+- (NSURL *)baseURL;
+- (NSDictionary *)facetValuesForDocumentNamed:(NSString *)documentName;
+
+- (NSData *)offsetMapForDocumentNamed:(NSString *)documentName textLength:(NSUInteger)textLength;
+- (BOOL)storeOffsetMap:(NSData *)offsetMap textLength:(NSUInteger)textLength forDocumentNamed:(NSString *)documentName;
+
+- (NSString *)extractedTextForDocumentNamed:(NSString *)documentName;
+- (BOOL)storeExtractedText:(NSString *)text forDocumentNamed:(NSString *)documentName;
+
+@end
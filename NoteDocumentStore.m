@@ -0,0 +1,330 @@
+//
+//  NoteDocumentStore.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import "NoteDocumentStore.h"
+
+#include "XHTMLTextExtraction.h"
+
+#include <sys/stat.h>
+
+#define kMappedDocumentCacheLimit	16
+#define kOffsetMapPathExtension		@"map"
+#define kOffsetMapMagic				0x4D4F4E4C	// "LNOM"
+#define kOffsetMapVersion			1
+#define kExtractedTextPathExtension	@"txt"
+#define kExtractedTextMagic			0x58544E4C	// "LNTX"
+#define kExtractedTextVersion		1
+#define kMaxFacetValueLength		32
+
+// Stored ahead of the XHTMLOffsetMapEntry array
+typedef struct {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	sourceLength;		// of the document the map was built from
+	uint32_t	textLength;			// UTF-8 bytes of extracted text
+} OffsetMapHeader;
+
+// Stored ahead of the extracted text's UTF-8 bytes
+typedef struct {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	sourceLength;		// of the document the text was extracted from
+} ExtractedTextHeader;
+
+
+@implementation NoteDocumentStore
+
+@synthesize directoryPath;
+@synthesize pathExtension;
+@synthesize offsetMapDirectoryPath;
+
+- (BOOL)isValidDocumentName:(NSString *)documentName {
+	return ([[documentName pathExtension] isEqualToString:self.pathExtension] && [documentName rangeOfString:@"/"].location == NSNotFound);
+}
+
+- (NSArray *)documentNames {
+	NSFileManager *fileManager = [[NSFileManager alloc] init];		// NSFileManager defaultManager is not thread safe
+	NSArray *fileNames = [fileManager contentsOfDirectoryAtPath:self.directoryPath error:NULL];
+	[fileManager release];
+	
+	NSMutableArray *documentNames = [NSMutableArray arrayWithCapacity:[fileNames count]];
+	for (NSString *fileName in fileNames) {
+		if ([[fileName pathExtension] isEqualToString:self.pathExtension]) {
+			[documentNames addObject:fileName];
+		}
+	}
+	return documentNames;
+}
+
+- (NSData *)dataForDocumentNamed:(NSString *)documentName {
+	if (![self isValidDocumentName:documentName]) {
+		return nil;
+	}
+	
+	NSData *data = [mappedDocuments objectForKey:documentName];
+	if (nil == data) {
+		NSString *path = [self.directoryPath stringByAppendingPathComponent:documentName];
+		data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:NULL];
+		if (data) {
+			[mappedDocuments setObject:data forKey:documentName cost:1];
+		}
+	}
+	return data;
+}
+
+- (NSURL *)baseURL {
+	return [NSURL fileURLWithPath:self.directoryPath isDirectory:YES];
+}
+
+
+#pragma mark -
+#pragma mark Facets
+
+/*
+ * Returns the characters after the first occurrence of marker (at or after
+ * start) up to the first of terminators, or nil if there's no such value.
+ */
+static NSString *DocumentValueAfterMarker(const char *bytes, size_t length, size_t start, const char *marker, const char *terminators) {
+	size_t markerLength = strlen(marker);
+	const char *found = (start < length ? memmem(bytes + start, length - start, marker, markerLength) : NULL);
+	if (found == NULL) {
+		return nil;
+	}
+	const char *value = found + markerLength;
+	size_t valueLength = 0;
+	while (value + valueLength < bytes + length && valueLength <= kMaxFacetValueLength && !strchr(terminators, value[valueLength])) {
+		valueLength++;
+	}
+	if (valueLength == 0 || valueLength > kMaxFacetValueLength) {
+		return nil;
+	}
+	return [[[NSString alloc] initWithBytes:value length:valueLength encoding:NSUTF8StringEncoding] autorelease];
+}
+
+/**
+ Returns the facet values of a document, by facet: the course whose media it uses (from its media/cert/<course>/
+ paths), and its type (the class of the first element of its body, e.g. Topic or Procedure).  Documents are only
+ scanned, not parsed.
+ */
+- (NSDictionary *)facetValuesForDocumentNamed:(NSString *)documentName {
+	NSData *data = [self dataForDocumentNamed:documentName];
+	if (nil == data) {
+		return nil;
+	}
+	const char *bytes = [data bytes];
+	size_t length = [data length];
+	NSMutableDictionary *facetValues = [NSMutableDictionary dictionaryWithCapacity:2];
+	
+	NSString *course = DocumentValueAfterMarker(bytes, length, 0, "media/cert/", "/\"'");
+	if (course) {
+		[facetValues setObject:course forKey:kNoteFacetCourse];
+	}
+	
+	// After the body tag, which may have a class of its own
+	const char *body = memmem(bytes, length, "<body", 5);
+	const char *bodyEnd = (body ? memchr(body, '>', length - (body - bytes)) : NULL);
+	NSString *documentType = (bodyEnd ? DocumentValueAfterMarker(bytes, length, bodyEnd - bytes, "class=\"", "\" ") : nil);
+	if (documentType) {
+		[facetValues setObject:documentType forKey:kNoteFacetDocumentType];
+	}
+	return facetValues;
+}
+
+
+#pragma mark -
+#pragma mark Offset maps
+
+- (NSString *)pathForDocumentNamed:(NSString *)documentName inOffsetMapDirectoryWithExtension:(NSString *)extension {
+	if (nil == self.offsetMapDirectoryPath || ![self isValidDocumentName:documentName]) {
+		return nil;
+	}
+	NSString *fileName = [[documentName stringByDeletingPathExtension] stringByAppendingPathExtension:extension];
+	return [self.offsetMapDirectoryPath stringByAppendingPathComponent:fileName];
+}
+
+- (NSString *)offsetMapPathForDocumentNamed:(NSString *)documentName {
+	return [self pathForDocumentNamed:documentName inOffsetMapDirectoryWithExtension:kOffsetMapPathExtension];
+}
+
+/**
+ Returns the document's stored offset map entries, or nil if there are none for the current version of the
+ document or they were built from text of a different length.
+ */
+- (NSData *)offsetMapForDocumentNamed:(NSString *)documentName textLength:(NSUInteger)textLength {
+	NSString *path = [self offsetMapPathForDocumentNamed:documentName];
+	NSData *documentData = [self dataForDocumentNamed:documentName];
+	if (nil == path || nil == documentData) {
+		return nil;
+	}
+	
+	NSData *fileData = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:NULL];
+	if ([fileData length] < sizeof(OffsetMapHeader)) {
+		return nil;
+	}
+	const OffsetMapHeader *header = [fileData bytes];
+	NSUInteger entriesLength = [fileData length] - sizeof(OffsetMapHeader);
+	if (header->magic != kOffsetMapMagic || header->version != kOffsetMapVersion
+		|| header->sourceLength != [documentData length] || header->textLength != textLength
+		|| entriesLength % sizeof(XHTMLOffsetMapEntry) != 0) {
+		DLog(@"Discarding stale offset map for %@", documentName);
+		return nil;
+	}
+	return [fileData subdataWithRange:NSMakeRange(sizeof(OffsetMapHeader), entriesLength)];
+}
+
+- (BOOL)storeOffsetMap:(NSData *)offsetMap textLength:(NSUInteger)textLength forDocumentNamed:(NSString *)documentName {
+	NSString *path = [self offsetMapPathForDocumentNamed:documentName];
+	NSData *documentData = [self dataForDocumentNamed:documentName];
+	if (nil == path || nil == documentData || nil == offsetMap) {
+		return NO;
+	}
+	
+	OffsetMapHeader header;
+	header.magic = kOffsetMapMagic;
+	header.version = kOffsetMapVersion;
+	header.sourceLength = (uint32_t)[documentData length];
+	header.textLength = (uint32_t)textLength;
+	
+	NSMutableData *fileData = [[NSMutableData alloc] initWithCapacity:sizeof(header) + [offsetMap length]];
+	[fileData appendBytes:&header length:sizeof(header)];
+	[fileData appendData:offsetMap];
+	NSError *error = nil;
+	BOOL stored = [fileData writeToFile:path options:NSDataWritingAtomic error:&error];
+	if (!stored) {
+		DLog(@"Couldn't store offset map for %@: %@", documentName, error);
+	}
+	[fileData release];
+	return stored;
+}
+
+
+#pragma mark -
+#pragma mark Extracted text
+
+- (NSString *)extractedTextPathForDocumentNamed:(NSString *)documentName {
+	return [self pathForDocumentNamed:documentName inOffsetMapDirectoryWithExtension:kExtractedTextPathExtension];
+}
+
+// From the file's attributes, so a document whose text is stored needn't be mapped; 0 if there is no such document
+- (NSUInteger)lengthOfDocumentNamed:(NSString *)documentName {
+	struct stat fileStat;
+	NSString *path = [self.directoryPath stringByAppendingPathComponent:documentName];
+	if (![self isValidDocumentName:documentName] || stat([path fileSystemRepresentation], &fileStat) != 0) {
+		return 0;
+	}
+	return (NSUInteger)fileStat.st_size;
+}
+
+/**
+ Returns the document's stored extracted text, or nil if there is none for the current version of the document.
+ */
+- (NSString *)extractedTextForDocumentNamed:(NSString *)documentName {
+	NSString *path = [self extractedTextPathForDocumentNamed:documentName];
+	NSUInteger documentLength = [self lengthOfDocumentNamed:documentName];
+	if (nil == path || documentLength == 0) {
+		return nil;
+	}
+	
+	NSData *fileData = [[NSData alloc] initWithContentsOfFile:path];
+	if ([fileData length] < sizeof(ExtractedTextHeader)) {
+		[fileData release];
+		return nil;
+	}
+	const ExtractedTextHeader *header = [fileData bytes];
+	NSString *text = nil;
+	if (header->magic == kExtractedTextMagic && header->version == kExtractedTextVersion && header->sourceLength == documentLength) {
+		text = [[[NSString alloc] initWithBytes:(const char *)[fileData bytes] + sizeof(ExtractedTextHeader)
+										 length:[fileData length] - sizeof(ExtractedTextHeader)
+									   encoding:NSUTF8StringEncoding] autorelease];
+	}
+	else {
+		DLog(@"Discarding stale extracted text for %@", documentName);
+	}
+	[fileData release];
+	return text;
+}
+
+- (BOOL)storeExtractedText:(NSString *)text forDocumentNamed:(NSString *)documentName {
+	NSString *path = [self extractedTextPathForDocumentNamed:documentName];
+	NSUInteger documentLength = [self lengthOfDocumentNamed:documentName];
+	const char *textBytes = [text UTF8String];
+	if (nil == path || documentLength == 0 || NULL == textBytes) {
+		return NO;
+	}
+	
+	ExtractedTextHeader header;
+	header.magic = kExtractedTextMagic;
+	header.version = kExtractedTextVersion;
+	header.sourceLength = (uint32_t)documentLength;
+	
+	size_t textLength = strlen(textBytes);
+	NSMutableData *fileData = [[NSMutableData alloc] initWithCapacity:sizeof(header) + textLength];
+	[fileData appendBytes:&header length:sizeof(header)];
+	[fileData appendBytes:textBytes length:textLength];
+	NSError *error = nil;
+	BOOL stored = [fileData writeToFile:path options:NSDataWritingAtomic error:&error];
+	if (!stored) {
+		DLog(@"Couldn't store extracted text for %@: %@", documentName, error);
+	}
+	[fileData release];
+	return stored;
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithDirectoryPath:(NSString *)aDirectoryPath pathExtension:(NSString *)aPathExtension {
+	return [self initWithDirectoryPath:aDirectoryPath pathExtension:aPathExtension offsetMapDirectoryPath:nil];
+}
+
+- (id)initWithDirectoryPath:(NSString *)aDirectoryPath pathExtension:(NSString *)aPathExtension offsetMapDirectoryPath:(NSString *)anOffsetMapDirectoryPath {
+	if ((self = [super init])) {
+		directoryPath = [aDirectoryPath copy];
+		pathExtension = [aPathExtension copy];
+		offsetMapDirectoryPath = [anOffsetMapDirectoryPath copy];
+		
+		if (offsetMapDirectoryPath) {
+			NSFileManager *fileManager = [[NSFileManager alloc] init];
+			[fileManager createDirectoryAtPath:offsetMapDirectoryPath withIntermediateDirectories:YES attributes:nil error:NULL];
+			[fileManager release];
+		}
+		
+		mappedDocuments = [[NSCache alloc] init];
+		mappedDocuments.countLimit = kMappedDocumentCacheLimit;
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[directoryPath release];
+	[pathExtension release];
+	[offsetMapDirectoryPath release];
+	[mappedDocuments release];
+	
+	[super dealloc];
+}
+
+@end
@@ -0,0 +1,58 @@
+//
+//  NoteHitHighlighter.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import <Foundation/Foundation.h>
+
+@class NoteDocumentStore;
+
+
+/*
+ * A note's document with the words matching a search query wrapped in
+ * numbered highlight elements, ready to hand to a web view.
+ *
+ * Hits are found in the note's extracted text and placed in the markup using
+ * the offset map stored when the document was indexed, so the document is
+ * only extracted again if its map is missing or stale.  Building one takes a
+ * few milliseconds even for the largest documents but should still be done
+ * off the main thread.
+ */
+@interface NoteHitHighlighter : NSObject {
+	NSData		*highlightedData;
+	NSUInteger	hitCount;
+}
+
+@property (nonatomic, retain, readonly)	NSData		*highlightedData;
+@property (nonatomic, assign, readonly)	NSUInteger	hitCount;
+
++ (NoteHitHighlighter *)highlighterForDocumentNamed:(NSString *)documentName
+										   noteText:(NSString *)noteText
+										 queryTerms:(NSSet *)queryTerms
+									  documentStore:(NoteDocumentStore *)store;
+
+// Marks the hit as current and scrolls it into view
++ (NSString *)scriptToShowHitAtIndex:(NSUInteger)hitIndex;
+
+@end
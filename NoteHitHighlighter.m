@@ -0,0 +1,147 @@
+//
+//  NoteHitHighlighter.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import "NoteHitHighlighter.h"
+
+#import "NoteDocumentStore.h"
+#import "SearchSnippet.h"
+#import "XHTMLExtractedText.h"
+
+#include "DocumentHitLocation.h"
+
+#define kMaxHits				500
+#define kMaxTerms				8
+#define kHitElementIDPrefix		@"locnotes-hit-"
+#define kHitColor				@"#ffef7a"
+#define kCurrentHitColor		@"#ff9632"
+
+
+@interface NoteHitHighlighter ()
+- (id)initWithHighlightedData:(NSData *)someHighlightedData hitCount:(NSUInteger)aHitCount;
+@end
+
+
+@implementation NoteHitHighlighter
+
+@synthesize highlightedData;
+@synthesize hitCount;
+
++ (NSData *)dataByWrappingHits:(const DocumentHit *)hits count:(size_t)count inSource:(NSData *)source {
+	const char *sourceBytes = [source bytes];
+	NSMutableData *data = [NSMutableData dataWithCapacity:[source length] + count * 96];
+	NSUInteger copiedLength = 0;
+	
+	for (size_t i=0; i<count; i++) {
+		NSString *openTag = [NSString stringWithFormat:@"<span id=\"%@%lu\" class=\"locnotes-hit\" style=\"background-color:%@\">",
+							 kHitElementIDPrefix, (unsigned long)i, kHitColor];
+		[data appendBytes:sourceBytes + copiedLength length:hits[i].location - copiedLength];
+		[data appendData:[openTag dataUsingEncoding:NSUTF8StringEncoding]];
+		[data appendBytes:sourceBytes + hits[i].location length:hits[i].length];
+		[data appendBytes:"</span>" length:7];
+		copiedLength = hits[i].location + hits[i].length;
+	}
+	[data appendBytes:sourceBytes + copiedLength length:[source length] - copiedLength];
+	
+	return data;
+}
+
++ (NoteHitHighlighter *)highlighterForDocumentNamed:(NSString *)documentName
+										   noteText:(NSString *)noteText
+										 queryTerms:(NSSet *)queryTerms
+									  documentStore:(NoteDocumentStore *)store {
+	NSData *source = [store dataForDocumentNamed:documentName];
+	if (nil == source) {
+		return nil;
+	}
+	
+	NSArray *terms = [SearchSnippet normalizedTermsFromQueryTerms:queryTerms];
+	NSUInteger termCount = MIN([terms count], kMaxTerms);
+	if (termCount == 0) {
+		return [[[NoteHitHighlighter alloc] initWithHighlightedData:source hitCount:0] autorelease];
+	}
+	const char *termBytes[kMaxTerms];
+	size_t termLengths[kMaxTerms];
+	for (NSUInteger i=0; i<termCount; i++) {
+		termBytes[i] = [[terms objectAtIndex:i] UTF8String];
+		termLengths[i] = strlen(termBytes[i]);
+	}
+	
+	// The note's text is what the document was extracted to, so only the map is needed
+	const char *text = [noteText UTF8String];
+	size_t textLength = (text ? strlen(text) : 0);
+	NSData *offsetMap = [store offsetMapForDocumentNamed:documentName textLength:textLength];
+	if (nil == offsetMap) {
+		XHTMLExtractedText *extractedText = [XHTMLExtractedText extractedTextWithOffsetMapFromData:source];
+		if (nil == extractedText) {
+			return nil;
+		}
+		text = [extractedText.text UTF8String];
+		textLength = strlen(text);
+		offsetMap = extractedText.offsetMap;
+		[store storeOffsetMap:offsetMap textLength:textLength forDocumentNamed:documentName];
+	}
+	
+	DocumentHit *hits = malloc(kMaxHits * sizeof(DocumentHit));
+	size_t count = DocumentLocateHits(text, textLength, termBytes, termLengths, termCount,
+									  [offsetMap bytes], [offsetMap length] / sizeof(XHTMLOffsetMapEntry),
+									  hits, kMaxHits);
+	NSData *data = (count > 0 ? [self dataByWrappingHits:hits count:count inSource:source] : source);
+	free(hits);
+	
+	return [[[NoteHitHighlighter alloc] initWithHighlightedData:data hitCount:count] autorelease];
+}
+
++ (NSString *)scriptToShowHitAtIndex:(NSUInteger)hitIndex {
+	return [NSString stringWithFormat:
+			@"(function() {"
+			@"var hit = document.getElementById('%@%lu'); if (!hit) return;"
+			@"var current = document.querySelector('.locnotes-hit-current');"
+			@"if (current) { current.className = 'locnotes-hit'; current.style.backgroundColor = '%@'; }"
+			@"hit.className = 'locnotes-hit locnotes-hit-current'; hit.style.backgroundColor = '%@';"
+			@"window.scrollTo(0, hit.getBoundingClientRect().top + window.pageYOffset - window.innerHeight / 3);"
+			@"})()",
+			kHitElementIDPrefix, (unsigned long)hitIndex, kHitColor, kCurrentHitColor];
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithHighlightedData:(NSData *)someHighlightedData hitCount:(NSUInteger)aHitCount {
+	if ((self = [super init])) {
+		highlightedData = [someHighlightedData retain];
+		hitCount = aHitCount;
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[highlightedData release];
+	
+	[super dealloc];
+}
+
+@end
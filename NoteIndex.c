@@ -0,0 +1,1399 @@
+//
+//  NoteIndex.c
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#include "NoteIndex.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define kIndexMagic				0x494E4E4C		// "LNNI"
+#define kIndexVersion			8
+#define kInitialTableCapacity	4096			// power of two
+#define kInitialCapacity		256
+#define kBlockNotes				4096			// notes matched at a time
+#define kProbeCost				8				// postings scanned in the time of one galloping probe
+
+
+#pragma mark -
+#pragma mark Builder
+
+typedef struct {
+	uint32_t	termOffset;				// into the term arena
+	uint32_t	termLength;
+	uint32_t	lastNote;				// the last note (plus one) the term was posted for
+	uint32_t	lastPosting;			// and its posting for that note
+	uint32_t	postingCount;
+} BuilderTerm;
+
+typedef struct {
+	uint32_t	term;
+	uint32_t	note;
+} BuilderPosting;
+
+typedef struct {
+	uint32_t	facetOffset;			// into the string arena
+	uint32_t	valueOffset;
+} BuilderFacetValue;
+
+struct NoteIndexBuilder {
+	// Stored fields, one entry per note
+	double			*lastUpdated;
+	uint32_t		*noteIDOffsets;		// into the string arena
+	uint32_t		*titleOffsets;
+	uint32_t		noteCount;
+	size_t			noteCapacity;
+	double			latestUpdate;
+	char			*strings;
+	size_t			stringsLength;
+	size_t			stringsCapacity;
+	
+	// Terms, found through an open addressed table of term numbers plus one
+	uint32_t		*slots;
+	uint32_t		*slotHashes;
+	size_t			slotCapacity;
+	BuilderTerm		*terms;
+	uint32_t		termCount;
+	size_t			termCapacity;
+	char			*termArena;
+	size_t			termArenaLength;
+	size_t			termArenaCapacity;
+	
+	// In the order they were added, so each term's notes are already sorted
+	BuilderPosting	*postings;
+	size_t			postingCount;
+	size_t			postingCapacity;
+	
+	// Facet values, and the notes that have them (as postings of the values)
+	BuilderFacetValue	*facetValues;
+	uint32_t			facetValueCount;
+	size_t				facetValueCapacity;
+	BuilderPosting		*facetPostings;
+	size_t				facetPostingCount;
+	size_t				facetPostingCapacity;
+};
+
+static int IsWordByte(unsigned char c) {
+	return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80);
+}
+
+static unsigned char LowerASCII(unsigned char c) {
+	return ((c >= 'A' && c <= 'Z') ? (unsigned char)(c + ('a' - 'A')) : c);
+}
+
+void NoteIndexFoldTerm(char *term, size_t length) {
+	unsigned char *bytes = (unsigned char *)term;
+	for (size_t i = 0; i < length; i++) {
+		if (bytes[i] < 0x80) {
+			bytes[i] = LowerASCII(bytes[i]);
+			continue;
+		}
+		if (i + 1 >= length) {
+			break;		// a sequence cut short by the term length limit
+		}
+		unsigned char lead = bytes[i];
+		unsigned char next = bytes[i + 1];
+		if (lead == 0xC3 && next >= 0x80 && next <= 0x9E && next != 0x97) {
+			bytes[i + 1] = next + 0x20;						// Latin-1 capitals, but not the multiplication sign
+		}
+		else if (lead == 0xCE && next >= 0x91 && next <= 0x9F) {
+			bytes[i + 1] = next + 0x20;						// Greek Alpha to Omicron
+		}
+		else if (lead == 0xCE && next >= 0xA0 && next <= 0xA9) {
+			bytes[i] = 0xCF;								// Greek Pi to Omega
+			bytes[i + 1] = next - 0x20;
+		}
+		else if (lead == 0xD0 && next >= 0x90 && next <= 0x9F) {
+			bytes[i + 1] = next + 0x20;						// Cyrillic A to Pe
+		}
+		else if (lead == 0xD0 && next >= 0xA0 && next <= 0xAF) {
+			bytes[i] = 0xD1;								// Cyrillic Er to Ya
+			bytes[i + 1] = next - 0x20;
+		}
+		else if (lead == 0xD0 && next >= 0x80 && next <= 0x8F) {
+			bytes[i] = 0xD1;								// Cyrillic Ie grave to Dzhe
+			bytes[i + 1] = next + 0x10;
+		}
+		i++;
+	}
+}
+
+static uint32_t HashTerm(const char *term, size_t length) {
+	uint32_t hash = 2166136261u;		// FNV-1a
+	for (size_t i = 0; i < length; i++) {
+		hash = (hash ^ (unsigned char)term[i]) * 16777619u;
+	}
+	return hash;
+}
+
+// Grows a malloc()ed array to hold at least count elements
+static int EnsureCapacity(void **array, size_t *capacity, size_t count, size_t elementSize) {
+	if (count <= *capacity) {
+		return 1;
+	}
+	size_t newCapacity = (*capacity ? *capacity * 2 : kInitialCapacity);
+	while (newCapacity < count) {
+		newCapacity *= 2;
+	}
+	void *newArray = realloc(*array, newCapacity * elementSize);
+	if (newArray == NULL) {
+		return 0;
+	}
+	*array = newArray;
+	*capacity = newCapacity;
+	return 1;
+}
+
+NoteIndexBuilder *NoteIndexBuilderCreate(void) {
+	NoteIndexBuilder *builder = calloc(1, sizeof(NoteIndexBuilder));
+	if (builder == NULL) {
+		return NULL;
+	}
+	builder->slotCapacity = kInitialTableCapacity;
+	builder->slots = calloc(builder->slotCapacity, sizeof(uint32_t));
+	builder->slotHashes = calloc(builder->slotCapacity, sizeof(uint32_t));
+	if (builder->slots == NULL || builder->slotHashes == NULL) {
+		NoteIndexBuilderFree(builder);
+		return NULL;
+	}
+	return builder;
+}
+
+void NoteIndexBuilderFree(NoteIndexBuilder *builder) {
+	if (builder) {
+		free(builder->lastUpdated);
+		free(builder->noteIDOffsets);
+		free(builder->titleOffsets);
+		free(builder->strings);
+		free(builder->slots);
+		free(builder->slotHashes);
+		free(builder->terms);
+		free(builder->termArena);
+		free(builder->postings);
+		free(builder->facetValues);
+		free(builder->facetPostings);
+		free(builder);
+	}
+}
+
+uint32_t NoteIndexBuilderNoteCount(const NoteIndexBuilder *builder) {
+	return builder->noteCount;
+}
+
+static int BuilderGrowTable(NoteIndexBuilder *builder) {
+	size_t capacity = builder->slotCapacity * 2;
+	uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+	uint32_t *slotHashes = calloc(capacity, sizeof(uint32_t));
+	if (slots == NULL || slotHashes == NULL) {
+		free(slots);
+		free(slotHashes);
+		return 0;
+	}
+	for (size_t i = 0; i < builder->slotCapacity; i++) {
+		if (builder->slots[i]) {
+			size_t slot = builder->slotHashes[i] & (capacity - 1);
+			while (slots[slot]) {
+				slot = (slot + 1) & (capacity - 1);
+			}
+			slots[slot] = builder->slots[i];
+			slotHashes[slot] = builder->slotHashes[i];
+		}
+	}
+	free(builder->slots);
+	free(builder->slotHashes);
+	builder->slots = slots;
+	builder->slotHashes = slotHashes;
+	builder->slotCapacity = capacity;
+	return 1;
+}
+
+// Finds a term's number, adding the term if it's new
+static int BuilderFindTerm(NoteIndexBuilder *builder, const char *term, size_t length, uint32_t *termNumber) {
+	uint32_t hash = HashTerm(term, length);
+	size_t slot = hash & (builder->slotCapacity - 1);
+	while (builder->slots[slot]) {
+		BuilderTerm *entry = &builder->terms[builder->slots[slot] - 1];
+		if (builder->slotHashes[slot] == hash && entry->termLength == length &&
+			memcmp(builder->termArena + entry->termOffset, term, length) == 0) {
+			*termNumber = builder->slots[slot] - 1;
+			return 1;
+		}
+		slot = (slot + 1) & (builder->slotCapacity - 1);
+	}
+	
+	if (!EnsureCapacity((void **)&builder->terms, &builder->termCapacity, builder->termCount + 1, sizeof(BuilderTerm)) ||
+		!EnsureCapacity((void **)&builder->termArena, &builder->termArenaCapacity, builder->termArenaLength + length, 1)) {
+		return 0;
+	}
+	
+	BuilderTerm *entry = &builder->terms[builder->termCount];
+	entry->termOffset = (uint32_t)builder->termArenaLength;
+	entry->termLength = (uint32_t)length;
+	entry->lastNote = 0;
+	entry->postingCount = 0;
+	memcpy(builder->termArena + builder->termArenaLength, term, length);
+	builder->termArenaLength += length;
+	*termNumber = builder->termCount;
+	builder->slots[slot] = ++builder->termCount;
+	builder->slotHashes[slot] = hash;
+	
+	// Keep the table at most half full
+	return (builder->termCount * 2 <= builder->slotCapacity || BuilderGrowTable(builder));
+}
+
+static int BuilderPostTerm(NoteIndexBuilder *builder, const char *term, size_t length) {
+	uint32_t note = builder->noteCount;
+	uint32_t termNumber = 0;
+	if (!BuilderFindTerm(builder, term, length, &termNumber)) {
+		return 0;
+	}
+	
+	BuilderTerm *entry = &builder->terms[termNumber];
+	if (entry->lastNote == note + 1) {
+		return 1;
+	}
+	if (builder->postingCount >= UINT32_MAX ||
+		!EnsureCapacity((void **)&builder->postings, &builder->postingCapacity, builder->postingCount + 1, sizeof(BuilderPosting))) {
+		return 0;
+	}
+	entry->lastNote = note + 1;
+	entry->lastPosting = (uint32_t)builder->postingCount;
+	entry->postingCount++;
+	builder->postings[builder->postingCount].term = termNumber;
+	builder->postings[builder->postingCount].note = note;
+	builder->postingCount++;
+	return 1;
+}
+
+static int BuilderPostWords(NoteIndexBuilder *builder, const char *text, size_t textLength) {
+	const unsigned char *bytes = (const unsigned char *)text;
+	char term[kNoteIndexMaxTermLength];
+	size_t i = 0;
+	
+	while (i < textLength) {
+		while (i < textLength && !IsWordByte(bytes[i])) {
+			i++;
+		}
+		size_t length = 0;
+		while (i < textLength && IsWordByte(bytes[i])) {
+			if (length < kNoteIndexMaxTermLength) {
+				term[length++] = (char)bytes[i];
+			}
+			i++;
+		}
+		NoteIndexFoldTerm(term, length);
+		if (length > 0 && !BuilderPostTerm(builder, term, length)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// The per note columns grow together
+static int BuilderReserveNote(NoteIndexBuilder *builder) {
+	if (builder->noteCount < builder->noteCapacity) {
+		return 1;
+	}
+	size_t capacity = (builder->noteCapacity ? builder->noteCapacity * 2 : kInitialCapacity);
+	double *lastUpdated = realloc(builder->lastUpdated, capacity * sizeof(double));
+	if (lastUpdated) {
+		builder->lastUpdated = lastUpdated;
+	}
+	uint32_t *noteIDOffsets = realloc(builder->noteIDOffsets, capacity * sizeof(uint32_t));
+	if (noteIDOffsets) {
+		builder->noteIDOffsets = noteIDOffsets;
+	}
+	uint32_t *titleOffsets = realloc(builder->titleOffsets, capacity * sizeof(uint32_t));
+	if (titleOffsets) {
+		builder->titleOffsets = titleOffsets;
+	}
+	if (lastUpdated == NULL || noteIDOffsets == NULL || titleOffsets == NULL) {
+		return 0;
+	}
+	builder->noteCapacity = capacity;
+	return 1;
+}
+
+static int BuilderAppendString(NoteIndexBuilder *builder, const char *string, uint32_t *offset) {
+	size_t length = (string ? strlen(string) : 0) + 1;
+	if (!EnsureCapacity((void **)&builder->strings, &builder->stringsCapacity, builder->stringsLength + length, 1)) {
+		return 0;
+	}
+	*offset = (uint32_t)builder->stringsLength;
+	memcpy(builder->strings + builder->stringsLength, (string ? string : ""), length);
+	builder->stringsLength += length;
+	return 1;
+}
+
+// Finds a facet value's number, adding the value if it's new
+static int BuilderFindFacetValue(NoteIndexBuilder *builder, const char *facet, const char *value, uint32_t *facetValue) {
+	// There are only ever a few values, so they are found by comparing each
+	*facetValue = 0;
+	while (*facetValue < builder->facetValueCount &&
+		   (strcmp(builder->strings + builder->facetValues[*facetValue].facetOffset, facet) != 0 ||
+			strcmp(builder->strings + builder->facetValues[*facetValue].valueOffset, value) != 0)) {
+		(*facetValue)++;
+	}
+	if (*facetValue == builder->facetValueCount) {
+		if (!EnsureCapacity((void **)&builder->facetValues, &builder->facetValueCapacity, builder->facetValueCount + 1, sizeof(BuilderFacetValue)) ||
+			!BuilderAppendString(builder, facet, &builder->facetValues[*facetValue].facetOffset) ||
+			!BuilderAppendString(builder, value, &builder->facetValues[*facetValue].valueOffset)) {
+			return 0;
+		}
+		builder->facetValueCount++;
+	}
+	return 1;
+}
+
+int NoteIndexBuilderAddFacetValue(NoteIndexBuilder *builder, const char *facet, const char *value) {
+	uint32_t facetValue = 0;
+	if (builder->noteCount == 0 || !BuilderFindFacetValue(builder, facet, value, &facetValue)) {
+		return 0;
+	}
+	
+	uint32_t note = builder->noteCount - 1;
+	if (builder->facetPostingCount > 0) {
+		BuilderPosting *last = &builder->facetPostings[builder->facetPostingCount - 1];
+		if (last->term == facetValue && last->note == note) {
+			return 1;
+		}
+	}
+	if (!EnsureCapacity((void **)&builder->facetPostings, &builder->facetPostingCapacity, builder->facetPostingCount + 1, sizeof(BuilderPosting))) {
+		return 0;
+	}
+	builder->facetPostings[builder->facetPostingCount].term = facetValue;
+	builder->facetPostings[builder->facetPostingCount].note = note;
+	builder->facetPostingCount++;
+	return 1;
+}
+
+int NoteIndexBuilderAddNote(NoteIndexBuilder *builder, const char *noteID, const char *title, double lastUpdated,
+							const char *text, size_t textLength) {
+	if (builder->noteCount == UINT32_MAX || !BuilderReserveNote(builder)) {
+		return 0;
+	}
+	
+	uint32_t note = builder->noteCount;
+	if (!BuilderAppendString(builder, noteID, &builder->noteIDOffsets[note]) ||
+		!BuilderAppendString(builder, title, &builder->titleOffsets[note]) ||
+		(title && !BuilderPostWords(builder, title, strlen(title))) ||
+		(text && !BuilderPostWords(builder, text, textLength))) {
+		return 0;
+	}
+	builder->lastUpdated[note] = lastUpdated;
+	if (note == 0 || lastUpdated > builder->latestUpdate) {
+		builder->latestUpdate = lastUpdated;
+	}
+	builder->noteCount++;
+	return 1;
+}
+
+
+#pragma mark -
+#pragma mark Index layout
+
+/*
+ * The header is followed by:
+ *	double		lastUpdated[noteCount]			numericslot 2 doc values, descending as notes are numbered newest first
+ *	uint64_t	facetBits[facetValueCount][facetWords]	a bitset per facet value of the notes that have it
+ *	uint32_t	titleKeys[noteCount]			textslot 1 doc values: rank in case insensitive order
+ *	uint32_t	noteIDOffsets[noteCount]		into strings, nul terminated
+ *	uint32_t	titleOffsets[noteCount]
+ *	uint32_t	noteIDOrder[noteCount]			notes in byte order of their IDs, for finding a note by ID
+ *	uint32_t	termOffsets[termCount]			sorted terms, into strings
+ *	uint32_t	postingStarts[termCount + 1]	each term's notes are postings[start, next start)
+ *	uint32_t	postings[postingCount]
+ *	uint32_t	facetOffsets[facetValueCount]	names of the facets, into strings
+ *	uint32_t	facetValueOffsets[facetValueCount]
+ *	char		strings[stringsLength]
+ */
+typedef struct {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	noteCount;
+	uint32_t	termCount;
+	uint32_t	postingCount;
+	uint32_t	stringsLength;
+	uint32_t	facetValueCount;
+	uint32_t	padding;
+	double		latestUpdate;
+} IndexHeader;
+
+typedef struct {
+	const IndexHeader	*header;
+	const double		*lastUpdated;
+	const uint64_t		*facetBits;
+	const uint32_t		*titleKeys;
+	const uint32_t		*noteIDOffsets;
+	const uint32_t		*titleOffsets;
+	const uint32_t		*noteIDOrder;
+	const uint32_t		*termOffsets;
+	const uint32_t		*postingStarts;
+	const uint32_t		*postings;
+	const uint32_t		*facetOffsets;
+	const uint32_t		*facetValueOffsets;
+	const char			*strings;
+} Index;
+
+static size_t FacetWords(uint32_t noteCount) {
+	return ((size_t)noteCount + 63) / 64;
+}
+
+static size_t IndexLength(uint32_t noteCount, uint32_t termCount, uint32_t postingCount, uint32_t facetValueCount,
+						  uint32_t stringsLength) {
+	return (sizeof(IndexHeader) + (size_t)noteCount * (sizeof(double) + 4 * sizeof(uint32_t)) +
+			(size_t)facetValueCount * FacetWords(noteCount) * sizeof(uint64_t) +
+			((size_t)termCount * 2 + 1 + postingCount + (size_t)facetValueCount * 2) * sizeof(uint32_t) + stringsLength);
+}
+
+static void IndexOpen(Index *index, const void *bytes) {
+	index->header = bytes;
+	index->lastUpdated = (const double *)(index->header + 1);
+	index->facetBits = (const uint64_t *)(index->lastUpdated + index->header->noteCount);
+	index->titleKeys = (const uint32_t *)(index->facetBits + index->header->facetValueCount * FacetWords(index->header->noteCount));
+	index->noteIDOffsets = index->titleKeys + index->header->noteCount;
+	index->titleOffsets = index->noteIDOffsets + index->header->noteCount;
+	index->noteIDOrder = index->titleOffsets + index->header->noteCount;
+	index->termOffsets = index->noteIDOrder + index->header->noteCount;
+	index->postingStarts = index->termOffsets + index->header->termCount;
+	index->postings = index->postingStarts + index->header->termCount + 1;
+	index->facetOffsets = index->postings + index->header->postingCount;
+	index->facetValueOffsets = index->facetOffsets + index->header->facetValueCount;
+	index->strings = (const char *)(index->facetValueOffsets + index->header->facetValueCount);
+}
+
+int NoteIndexIsValid(const void *bytes, size_t length) {
+	if (bytes == NULL || length < sizeof(IndexHeader)) {
+		return 0;
+	}
+	const IndexHeader *header = bytes;
+	if (header->magic != kIndexMagic || header->version != kIndexVersion ||
+		length != IndexLength(header->noteCount, header->termCount, header->postingCount, header->facetValueCount,
+							  header->stringsLength)) {
+		return 0;
+	}
+	Index index;
+	IndexOpen(&index, bytes);
+	return (index.postingStarts[header->termCount] == header->postingCount &&
+			(header->stringsLength == 0 || index.strings[header->stringsLength - 1] == '\0'));
+}
+
+uint32_t NoteIndexNoteCount(const void *bytes) {
+	return ((const IndexHeader *)bytes)->noteCount;
+}
+
+double NoteIndexLatestUpdate(const void *bytes) {
+	return ((const IndexHeader *)bytes)->latestUpdate;
+}
+
+const char *NoteIndexNoteID(const void *bytes, uint32_t note) {
+	Index index;
+	IndexOpen(&index, bytes);
+	return index.strings + index.noteIDOffsets[note];
+}
+
+const char *NoteIndexTitle(const void *bytes, uint32_t note) {
+	Index index;
+	IndexOpen(&index, bytes);
+	return index.strings + index.titleOffsets[note];
+}
+
+double NoteIndexLastUpdated(const void *bytes, uint32_t note) {
+	Index index;
+	IndexOpen(&index, bytes);
+	return index.lastUpdated[note];
+}
+
+int NoteIndexFindNote(const void *bytes, const char *noteID, uint32_t *note) {
+	Index index;
+	IndexOpen(&index, bytes);
+	uint32_t low = 0;
+	uint32_t high = index.header->noteCount;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (strcmp(index.strings + index.noteIDOffsets[index.noteIDOrder[middle]], noteID) < 0) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	if (low == index.header->noteCount || strcmp(index.strings + index.noteIDOffsets[index.noteIDOrder[low]], noteID) != 0) {
+		return 0;
+	}
+	*note = index.noteIDOrder[low];
+	return 1;
+}
+
+
+#pragma mark -
+#pragma mark Index creation
+
+typedef struct {
+	const unsigned char	*bytes;
+	uint32_t			length;
+	uint32_t			number;
+} SortedString;
+
+static int CompareTerms(const void *a, const void *b) {
+	const SortedString *termA = a;
+	const SortedString *termB = b;
+	uint32_t length = (termA->length < termB->length ? termA->length : termB->length);
+	int order = memcmp(termA->bytes, termB->bytes, length);
+	if (order == 0) {
+		order = (termA->length < termB->length ? -1 : (termA->length > termB->length ? 1 : 0));
+	}
+	return order;
+}
+
+// Case insensitive (ASCII only) byte order, as titles are collated
+static int CompareTitleBytes(const unsigned char *a, const unsigned char *b) {
+	while (*a && LowerASCII(*a) == LowerASCII(*b)) {
+		a++;
+		b++;
+	}
+	return (int)LowerASCII(*a) - (int)LowerASCII(*b);
+}
+
+typedef struct {
+	double		lastUpdated;
+	uint32_t	number;
+} SortedDate;
+
+static int CompareNewestFirst(const void *a, const void *b) {
+	const SortedDate *dateA = a;
+	const SortedDate *dateB = b;
+	if (dateA->lastUpdated != dateB->lastUpdated) {
+		return (dateA->lastUpdated > dateB->lastUpdated ? -1 : 1);
+	}
+	return (dateA->number < dateB->number ? -1 : (dateA->number > dateB->number ? 1 : 0));
+}
+
+static int CompareNoteIDs(const void *a, const void *b) {
+	return strcmp((const char *)((const SortedString *)a)->bytes, (const char *)((const SortedString *)b)->bytes);
+}
+
+static int CompareTitles(const void *a, const void *b) {
+	const SortedString *titleA = a;
+	const SortedString *titleB = b;
+	int order = CompareTitleBytes(titleA->bytes, titleB->bytes);
+	if (order == 0) {
+		order = (titleA->number < titleB->number ? -1 : (titleA->number > titleB->number ? 1 : 0));
+	}
+	return order;
+}
+
+int NoteIndexCreate(const NoteIndexBuilder *builder, void **bytes, size_t *length) {
+	uint32_t noteCount = builder->noteCount;
+	uint32_t termCount = builder->termCount;
+	if (builder->postingCount > UINT32_MAX ||
+		builder->stringsLength + builder->termArenaLength + termCount > UINT32_MAX) {
+		return 0;
+	}
+	uint32_t postingCount = (uint32_t)builder->postingCount;
+	uint32_t stringsLength = (uint32_t)(builder->stringsLength + builder->termArenaLength + termCount);
+	
+	size_t indexLength = IndexLength(noteCount, termCount, postingCount, builder->facetValueCount, stringsLength);
+	void *indexBytes = calloc(1, indexLength);
+	SortedString *sorted = malloc(((noteCount > termCount ? noteCount : termCount) + 1) * sizeof(SortedString));
+	SortedDate *dates = malloc(((size_t)noteCount + 1) * sizeof(SortedDate));
+	uint32_t *noteNumbers = malloc(((size_t)noteCount + 1) * sizeof(uint32_t));
+	uint32_t *notePostingStarts = calloc((size_t)noteCount + 1, sizeof(uint32_t));
+	uint32_t *termRanks = malloc(((size_t)termCount + 1) * sizeof(uint32_t));
+	uint32_t *nextPostings = malloc(((size_t)termCount + 1) * sizeof(uint32_t));
+	if (indexBytes == NULL || sorted == NULL || dates == NULL || noteNumbers == NULL || notePostingStarts == NULL ||
+		termRanks == NULL || nextPostings == NULL) {
+		free(indexBytes);
+		free(sorted);
+		free(dates);
+		free(noteNumbers);
+		free(notePostingStarts);
+		free(termRanks);
+		free(nextPostings);
+		return 0;
+	}
+	
+	IndexHeader *header = indexBytes;
+	header->magic = kIndexMagic;
+	header->version = kIndexVersion;
+	header->noteCount = noteCount;
+	header->termCount = termCount;
+	header->postingCount = postingCount;
+	header->stringsLength = stringsLength;
+	header->facetValueCount = builder->facetValueCount;
+	header->latestUpdate = builder->latestUpdate;
+	
+	Index index;
+	IndexOpen(&index, indexBytes);
+	double *lastUpdated = (double *)index.lastUpdated;
+	uint32_t *titleKeys = (uint32_t *)index.titleKeys;
+	uint32_t *termOffsets = (uint32_t *)index.termOffsets;
+	uint32_t *postingStarts = (uint32_t *)index.postingStarts;
+	uint32_t *postings = (uint32_t *)index.postings;
+	char *strings = (char *)index.strings;
+	
+	// Notes are numbered newest first, so every postings list is in date order too
+	for (uint32_t i = 0; i < noteCount; i++) {
+		dates[i].lastUpdated = builder->lastUpdated[i];
+		dates[i].number = i;
+	}
+	qsort(dates, noteCount, sizeof(SortedDate), CompareNewestFirst);
+	for (uint32_t note = 0; note < noteCount; note++) {
+		uint32_t added = dates[note].number;
+		noteNumbers[added] = note;
+		lastUpdated[note] = builder->lastUpdated[added];
+		((uint32_t *)index.noteIDOffsets)[note] = builder->noteIDOffsets[added];
+		((uint32_t *)index.titleOffsets)[note] = builder->titleOffsets[added];
+	}
+	memcpy(strings, builder->strings, builder->stringsLength);
+	
+	// Facet values' names were kept with the notes' strings
+	size_t facetWords = FacetWords(noteCount);
+	for (uint32_t i = 0; i < builder->facetValueCount; i++) {
+		((uint32_t *)index.facetOffsets)[i] = builder->facetValues[i].facetOffset;
+		((uint32_t *)index.facetValueOffsets)[i] = builder->facetValues[i].valueOffset;
+	}
+	for (size_t i = 0; i < builder->facetPostingCount; i++) {
+		uint32_t note = noteNumbers[builder->facetPostings[i].note];
+		uint64_t *bits = (uint64_t *)index.facetBits + builder->facetPostings[i].term * facetWords;
+		bits[note / 64] |= (1ULL << (note % 64));
+	}
+	
+	// Titles that only differ in case share a key
+	for (uint32_t i = 0; i < noteCount; i++) {
+		sorted[i].bytes = (const unsigned char *)builder->strings + builder->titleOffsets[i];
+		sorted[i].number = i;
+	}
+	qsort(sorted, noteCount, sizeof(SortedString), CompareTitles);
+	uint32_t titleKey = 0;
+	for (uint32_t i = 0; i < noteCount; i++) {
+		if (i > 0 && CompareTitleBytes(sorted[i - 1].bytes, sorted[i].bytes) != 0) {
+			titleKey = i;
+		}
+		titleKeys[noteNumbers[sorted[i].number]] = titleKey;
+	}
+	
+	for (uint32_t i = 0; i < noteCount; i++) {
+		sorted[i].bytes = (const unsigned char *)builder->strings + builder->noteIDOffsets[i];
+		sorted[i].number = i;
+	}
+	qsort(sorted, noteCount, sizeof(SortedString), CompareNoteIDs);
+	for (uint32_t i = 0; i < noteCount; i++) {
+		((uint32_t *)index.noteIDOrder)[i] = noteNumbers[sorted[i].number];
+	}
+	
+	// Sorted terms, nul terminated after the notes' strings
+	for (uint32_t i = 0; i < termCount; i++) {
+		sorted[i].bytes = (const unsigned char *)builder->termArena + builder->terms[i].termOffset;
+		sorted[i].length = builder->terms[i].termLength;
+		sorted[i].number = i;
+	}
+	qsort(sorted, termCount, sizeof(SortedString), CompareTerms);
+	size_t stringOffset = builder->stringsLength;
+	uint32_t postingStart = 0;
+	for (uint32_t i = 0; i < termCount; i++) {
+		termRanks[sorted[i].number] = i;
+		termOffsets[i] = (uint32_t)stringOffset;
+		memcpy(strings + stringOffset, sorted[i].bytes, sorted[i].length);
+		stringOffset += sorted[i].length + 1;
+		postingStarts[i] = postingStart;
+		nextPostings[i] = postingStart;
+		postingStart += builder->terms[sorted[i].number].postingCount;
+	}
+	postingStarts[termCount] = postingStart;
+	
+	// Postings were added note by note, so each note's are together; placing them note by note in the new order
+	// keeps each list sorted
+	for (size_t i = 0; i < builder->postingCount; i++) {
+		notePostingStarts[builder->postings[i].note + 1]++;
+	}
+	for (uint32_t i = 0; i < noteCount; i++) {
+		notePostingStarts[i + 1] += notePostingStarts[i];
+	}
+	for (uint32_t note = 0; note < noteCount; note++) {
+		uint32_t added = dates[note].number;
+		for (uint32_t i = notePostingStarts[added]; i < notePostingStarts[added + 1]; i++) {
+			postings[nextPostings[termRanks[builder->postings[i].term]]++] = note;
+		}
+	}
+	
+	free(sorted);
+	free(dates);
+	free(noteNumbers);
+	free(notePostingStarts);
+	free(termRanks);
+	free(nextPostings);
+	
+	*bytes = indexBytes;
+	*length = indexLength;
+	return 1;
+}
+
+
+#pragma mark -
+#pragma mark Updating
+
+int NoteIndexBuilderAddIndexedNotes(NoteIndexBuilder *builder, const void *bytes, const uint8_t *removedNotes) {
+	Index index;
+	IndexOpen(&index, bytes);
+	uint32_t indexNoteCount = index.header->noteCount;
+	uint32_t firstNote = builder->noteCount;
+	uint32_t *builderNotes = malloc(((size_t)indexNoteCount + 1) * sizeof(uint32_t));		// UINT32_MAX if removed
+	if (builderNotes == NULL) {
+		return 0;
+	}
+	
+	// The stored fields of the notes kept, which are added in the index's order
+	int added = 1;
+	for (uint32_t note = 0; added && note < indexNoteCount; note++) {
+		builderNotes[note] = UINT32_MAX;
+		if (removedNotes && removedNotes[note]) {
+			continue;
+		}
+		uint32_t builderNote = builder->noteCount;
+		if (builderNote == UINT32_MAX || !BuilderReserveNote(builder) ||
+			!BuilderAppendString(builder, index.strings + index.noteIDOffsets[note], &builder->noteIDOffsets[builderNote]) ||
+			!BuilderAppendString(builder, index.strings + index.titleOffsets[note], &builder->titleOffsets[builderNote])) {
+			added = 0;
+			break;
+		}
+		builder->lastUpdated[builderNote] = index.lastUpdated[note];
+		if (builderNote == 0 || index.lastUpdated[note] > builder->latestUpdate) {
+			builder->latestUpdate = index.lastUpdated[note];
+		}
+		builderNotes[note] = builderNote;
+		builder->noteCount++;
+	}
+	
+	// Each note's postings go together, in note order, as though its words had been added; the index lists them term
+	// by term, so they are counted per note first
+	uint32_t addedCount = builder->noteCount - firstNote;
+	size_t *noteStarts = (added ? calloc((size_t)addedCount + 1, sizeof(size_t)) : NULL);
+	added = (noteStarts != NULL);
+	for (uint32_t p = 0; added && p < index.header->postingCount; p++) {
+		uint32_t builderNote = builderNotes[index.postings[p]];
+		if (builderNote != UINT32_MAX) {
+			noteStarts[builderNote - firstNote + 1]++;
+		}
+	}
+	for (uint32_t i = 0; added && i < addedCount; i++) {
+		noteStarts[i + 1] += noteStarts[i];
+	}
+	size_t postingStart = builder->postingCount;
+	size_t addedPostings = (added ? noteStarts[addedCount] : 0);
+	if (added && (postingStart + addedPostings > UINT32_MAX ||
+				  !EnsureCapacity((void **)&builder->postings, &builder->postingCapacity, postingStart + addedPostings,
+								  sizeof(BuilderPosting)))) {
+		added = 0;
+	}
+	
+	for (uint32_t term = 0; added && term < index.header->termCount; term++) {
+		const char *termBytes = index.strings + index.termOffsets[term];
+		uint32_t termNumber = UINT32_MAX;
+		for (uint32_t p = index.postingStarts[term]; p < index.postingStarts[term + 1]; p++) {
+			uint32_t builderNote = builderNotes[index.postings[p]];
+			if (builderNote == UINT32_MAX) {
+				continue;
+			}
+			if (termNumber == UINT32_MAX && !BuilderFindTerm(builder, termBytes, strlen(termBytes), &termNumber)) {
+				added = 0;
+				break;
+			}
+			size_t position = postingStart + noteStarts[builderNote - firstNote]++;
+			builder->postings[position].term = termNumber;
+			builder->postings[position].note = builderNote;
+			
+			// Postings are visited in note order, so this ends on the term's last note
+			BuilderTerm *entry = &builder->terms[termNumber];
+			entry->lastNote = builderNote + 1;
+			entry->lastPosting = (uint32_t)position;
+			entry->postingCount++;
+		}
+	}
+	if (added) {
+		builder->postingCount = postingStart + addedPostings;
+	}
+	
+	size_t facetWords = FacetWords(indexNoteCount);
+	for (uint32_t i = 0; added && i < index.header->facetValueCount; i++) {
+		uint32_t facetValue = 0;
+		if (!BuilderFindFacetValue(builder, index.strings + index.facetOffsets[i], index.strings + index.facetValueOffsets[i], &facetValue)) {
+			added = 0;
+			break;
+		}
+		const uint64_t *bits = index.facetBits + i * facetWords;
+		for (size_t word = 0; added && word < facetWords; word++) {
+			for (uint64_t remaining = bits[word]; remaining; remaining &= remaining - 1) {
+				uint32_t builderNote = builderNotes[word * 64 + (uint32_t)__builtin_ctzll(remaining)];
+				if (builderNote == UINT32_MAX) {
+					continue;
+				}
+				if (!EnsureCapacity((void **)&builder->facetPostings, &builder->facetPostingCapacity, builder->facetPostingCount + 1,
+									sizeof(BuilderPosting))) {
+					added = 0;
+					break;
+				}
+				builder->facetPostings[builder->facetPostingCount].term = facetValue;
+				builder->facetPostings[builder->facetPostingCount].note = builderNote;
+				builder->facetPostingCount++;
+			}
+		}
+	}
+	
+	free(builderNotes);
+	free(noteStarts);
+	return added;
+}
+
+int NoteIndexAddTermsToVocabulary(const void *bytes, CompletionVocabulary *vocabulary) {
+	Index index;
+	IndexOpen(&index, bytes);
+	for (uint32_t term = 0; term < index.header->termCount; term++) {
+		const char *termBytes = index.strings + index.termOffsets[term];
+		size_t length = strlen(termBytes);
+		
+		// A word of the longest length may have been cut short, so it can't be offered whole
+		if (length >= kNoteIndexMaxTermLength) {
+			continue;
+		}
+		uint32_t noteFrequency = index.postingStarts[term + 1] - index.postingStarts[term];
+		if (!CompletionVocabularyAddTerm(vocabulary, termBytes, length, noteFrequency)) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+
+#pragma mark -
+#pragma mark Matching
+
+static int ComparePrefix(const char *term, const char *prefix, size_t prefixLength) {
+	for (size_t i = 0; i < prefixLength; i++) {
+		if (term[i] != prefix[i]) {
+			return ((unsigned char)term[i] < (unsigned char)prefix[i] ? -1 : 1);
+		}
+	}
+	return 0;
+}
+
+// The range of sorted terms [*first, *last) that start with prefix
+static void IndexFindPrefix(const Index *index, const char *prefix, size_t prefixLength, uint32_t *first, uint32_t *last) {
+	uint32_t low = 0;
+	uint32_t high = index->header->termCount;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (ComparePrefix(index->strings + index->termOffsets[middle], prefix, prefixLength) < 0) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	*first = low;
+	
+	high = index->header->termCount;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (ComparePrefix(index->strings + index->termOffsets[middle], prefix, prefixLength) <= 0) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	*last = low;
+}
+
+void NoteIndexNotesUpdatedBetween(const void *bytes, double earliest, double latest, uint32_t *firstNote, uint32_t *endNote) {
+	Index index;
+	IndexOpen(&index, bytes);
+	
+	// The column is in descending order
+	uint32_t low = 0;
+	uint32_t high = index.header->noteCount;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (index.lastUpdated[middle] > latest) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	*firstNote = low;
+	
+	high = index.header->noteCount;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (index.lastUpdated[middle] >= earliest) {
+			low = middle + 1;
+		}
+		else {
+			high = middle;
+		}
+	}
+	*endNote = low;
+}
+
+// The first of postings[start, end) that is at least note
+static uint32_t PostingsLowerBound(const uint32_t *postings, uint32_t start, uint32_t end, uint32_t note) {
+	while (start < end) {
+		uint32_t middle = start + (end - start) / 2;
+		if (postings[middle] < note) {
+			start = middle + 1;
+		}
+		else {
+			end = middle;
+		}
+	}
+	return start;
+}
+
+/*
+ * The first of postings[start, end) that is at least note, found by galloping
+ * from start: the steps double until they pass note, so the cost grows with
+ * the distance moved rather than with the length of the list.
+ */
+static uint32_t PostingsGallop(const uint32_t *postings, uint32_t start, uint32_t end, uint32_t note) {
+	uint32_t step = 1;
+	while (end - start > step && postings[start + step] < note) {
+		start += step;
+		step *= 2;
+	}
+	return PostingsLowerBound(postings, start, (end - start > step ? start + step : end), note);
+}
+
+static size_t CountBits(const uint64_t *bits, size_t wordCount) {
+	size_t count = 0;
+	for (size_t i = 0; i < wordCount; i++) {
+		count += (size_t)__builtin_popcountll(bits[i]);
+	}
+	return count;
+}
+
+typedef struct {
+	uint32_t	next;
+	uint32_t	end;
+	uint32_t	blockFirst;			// its postings in the block being matched are [blockFirst, blockEnd)
+	uint32_t	blockEnd;
+} PostingCursor;
+
+/*
+ * A query's terms, each of which matches the postings lists of every word it
+ * is a prefix of: term t has cursors[termCursors[t], termCursors[t + 1]).
+ */
+typedef struct {
+	Index			index;
+	size_t			termCount;
+	size_t			*termCursors;
+	PostingCursor	*cursors;
+	size_t			*termOrder;			// rarest first
+	size_t			*termPostings;		// in the range searched, or in the current block
+	int				matchesNothing;		// a term is the prefix of no word
+} Query;
+
+static void QueryClose(Query *query) {
+	free(query->termCursors);
+	free(query->cursors);
+	free(query->termOrder);
+	free(query->termPostings);
+}
+
+// Finds the terms' words, with their cursors at firstNote; returns 0 on failure
+static int QueryOpen(Query *query, const void *bytes, const char *const *terms, const size_t *termLengths, size_t termCount,
+					 uint32_t firstNote) {
+	memset(query, 0, sizeof(Query));
+	IndexOpen(&query->index, bytes);
+	query->termCount = termCount;
+	query->termCursors = malloc((termCount + 1) * sizeof(size_t));
+	query->termOrder = malloc((termCount + 1) * sizeof(size_t));
+	query->termPostings = malloc((termCount + 1) * sizeof(size_t));
+	uint32_t *firstTerms = malloc((termCount + 1) * sizeof(uint32_t));
+	if (query->termCursors == NULL || query->termOrder == NULL || query->termPostings == NULL || firstTerms == NULL) {
+		free(firstTerms);
+		QueryClose(query);
+		return 0;
+	}
+	
+	query->termCursors[0] = 0;
+	for (size_t t = 0; t < termCount; t++) {
+		size_t prefixLength = (termLengths[t] < kNoteIndexMaxTermLength ? termLengths[t] : kNoteIndexMaxTermLength);
+		uint32_t last;
+		IndexFindPrefix(&query->index, terms[t], prefixLength, &firstTerms[t], &last);
+		query->termCursors[t + 1] = query->termCursors[t] + (last - firstTerms[t]);
+		if (last == firstTerms[t]) {
+			query->matchesNothing = 1;
+		}
+	}
+	query->cursors = malloc((query->termCursors[termCount] + 1) * sizeof(PostingCursor));
+	if (query->cursors == NULL) {
+		free(firstTerms);
+		QueryClose(query);
+		return 0;
+	}
+	
+	for (size_t t = 0; t < termCount; t++) {
+		query->termPostings[t] = 0;
+		for (size_t c = query->termCursors[t]; c < query->termCursors[t + 1]; c++) {
+			PostingCursor *cursor = &query->cursors[c];
+			uint32_t term = firstTerms[t] + (uint32_t)(c - query->termCursors[t]);
+			cursor->end = query->index.postingStarts[term + 1];
+			cursor->next = PostingsLowerBound(query->index.postings, query->index.postingStarts[term], cursor->end, firstNote);
+			cursor->blockFirst = cursor->next;
+			cursor->blockEnd = cursor->next;
+			query->termPostings[t] += cursor->end - cursor->next;
+		}
+		
+		size_t i = t;
+		for (; i > 0 && query->termPostings[query->termOrder[i - 1]] > query->termPostings[t]; i--) {
+			query->termOrder[i] = query->termOrder[i - 1];
+		}
+		query->termOrder[i] = t;
+	}
+	free(firstTerms);
+	return 1;
+}
+
+/*
+ * The first block at or after blockStart, in steps of blockNotes, that holds
+ * the rarest term's next note, as no note before that can match; endNote if
+ * there is none.
+ */
+static uint32_t QueryNextBlock(Query *query, uint32_t blockStart, uint32_t endNote, uint32_t blockNotes) {
+	size_t rarest = query->termOrder[0];
+	uint32_t nextNote = endNote;
+	for (size_t c = query->termCursors[rarest]; c < query->termCursors[rarest + 1]; c++) {
+		PostingCursor *cursor = &query->cursors[c];
+		cursor->next = PostingsGallop(query->index.postings, cursor->next, cursor->end, blockStart);
+		if (cursor->next < cursor->end && query->index.postings[cursor->next] < nextNote) {
+			nextNote = query->index.postings[cursor->next];
+		}
+	}
+	if (query->matchesNothing || nextNote >= endNote) {
+		return endNote;
+	}
+	return blockStart + (nextNote - blockStart) / blockNotes * blockNotes;
+}
+
+// Moves a term's cursors to the block [blockStart, blockEnd), counting its postings there in termPostings
+static void QueryEnterBlock(Query *query, size_t t, uint32_t blockStart, uint32_t blockEnd) {
+	query->termPostings[t] = 0;
+	for (size_t c = query->termCursors[t]; c < query->termCursors[t + 1]; c++) {
+		PostingCursor *cursor = &query->cursors[c];
+		cursor->next = PostingsGallop(query->index.postings, cursor->next, cursor->end, blockStart);
+		cursor->blockFirst = cursor->next;
+		cursor->blockEnd = PostingsGallop(query->index.postings, cursor->next, cursor->end, blockEnd);
+		query->termPostings[t] += cursor->blockEnd - cursor->blockFirst;
+	}
+}
+
+/*
+ * Sets the notes of the block [blockStart, blockEnd) that match every term in
+ * matched, a bitmap of the block, and returns how many there are.
+ *
+ * The rarest term's notes are set in the bitmap, and each other term's are
+ * ANDed in, until none are left.  A common term is looked up by galloping for
+ * just the notes still matching, once that's cheaper than scanning its
+ * postings in the block, so a rare term with a common one costs little more
+ * than the rare term alone.
+ */
+static size_t QueryMatchBlock(Query *query, uint32_t blockStart, uint32_t blockEnd, uint64_t *matched, uint64_t *termMatched) {
+	const uint32_t *postings = query->index.postings;
+	size_t wordCount = (blockEnd - blockStart + 63) / 64;
+	size_t matchedCount = 0;
+	
+	for (size_t k = 0; k < query->termCount && (k == 0 || matchedCount > 0); k++) {
+		size_t t = query->termOrder[k];
+		size_t cursorCount = query->termCursors[t + 1] - query->termCursors[t];
+		QueryEnterBlock(query, t, blockStart, blockEnd);
+		
+		uint64_t *bits = (k == 0 ? matched : termMatched);
+		memset(bits, 0, wordCount * sizeof(uint64_t));
+		if (k > 0 && matchedCount * cursorCount * kProbeCost < query->termPostings[t]) {
+			for (size_t c = query->termCursors[t]; c < query->termCursors[t + 1]; c++) {
+				PostingCursor *cursor = &query->cursors[c];
+				for (size_t i = 0; i < wordCount; i++) {
+					uint64_t word = matched[i] & ~bits[i];
+					while (word) {
+						uint64_t bit = word & -word;
+						uint32_t note = blockStart + (uint32_t)(i * 64 + __builtin_ctzll(word));
+						cursor->next = PostingsGallop(postings, cursor->next, cursor->blockEnd, note);
+						if (cursor->next < cursor->blockEnd && postings[cursor->next] == note) {
+							bits[i] |= bit;
+						}
+						word ^= bit;
+					}
+				}
+			}
+		}
+		else {
+			for (size_t c = query->termCursors[t]; c < query->termCursors[t + 1]; c++) {
+				PostingCursor *cursor = &query->cursors[c];
+				for (uint32_t p = cursor->blockFirst; p < cursor->blockEnd; p++) {
+					uint32_t note = postings[p] - blockStart;
+					bits[note / 64] |= (1ULL << (note % 64));
+				}
+			}
+		}
+		for (size_t c = query->termCursors[t]; c < query->termCursors[t + 1]; c++) {
+			query->cursors[c].next = query->cursors[c].blockEnd;
+		}
+		
+		if (k > 0) {
+			for (size_t i = 0; i < wordCount; i++) {
+				matched[i] &= termMatched[i];
+			}
+		}
+		matchedCount = CountBits(matched, wordCount);
+	}
+	return matchedCount;
+}
+
+int NoteIndexMatch(const void *bytes, const char *const *terms, const size_t *termLengths, size_t termCount,
+				   uint32_t firstNote, uint32_t endNote, size_t maxNotes,
+				   uint32_t *notes, size_t *noteCount, uint32_t *notesScanned) {
+	Index index;
+	IndexOpen(&index, bytes);
+	if (endNote > index.header->noteCount) {
+		endNote = index.header->noteCount;
+	}
+	*noteCount = 0;
+	*notesScanned = (firstNote < endNote ? endNote - firstNote : 0);
+	if (firstNote >= endNote || maxNotes == 0) {
+		return 1;
+	}
+	
+	// Without terms, every note in the range matches
+	if (termCount == 0) {
+		size_t count = (endNote - firstNote < maxNotes ? endNote - firstNote : maxNotes);
+		for (size_t i = 0; i < count; i++) {
+			notes[i] = firstNote + (uint32_t)i;
+		}
+		*noteCount = count;
+		*notesScanned = (uint32_t)count;
+		return 1;
+	}
+	
+	Query query;
+	if (!QueryOpen(&query, bytes, terms, termLengths, termCount, firstNote)) {
+		return 0;
+	}
+	
+	// Notes are matched a block at a time, in note (newest first) order, so the search can stop as soon as it has enough
+	uint64_t matched[kBlockNotes / 64];
+	uint64_t termMatched[kBlockNotes / 64];
+	size_t count = 0;
+	uint32_t blockStart = firstNote;
+	while (count < maxNotes && (blockStart = QueryNextBlock(&query, blockStart, endNote, kBlockNotes)) < endNote) {
+		uint32_t blockEnd = (endNote - blockStart < kBlockNotes ? endNote : blockStart + kBlockNotes);
+		size_t wordCount = (blockEnd - blockStart + 63) / 64;
+		size_t matchedCount = QueryMatchBlock(&query, blockStart, blockEnd, matched, termMatched);
+		
+		for (size_t i = 0; i < wordCount && count < maxNotes && matchedCount > 0; i++) {
+			uint64_t word = matched[i];
+			while (word && count < maxNotes) {
+				uint32_t note = blockStart + (uint32_t)(i * 64 + __builtin_ctzll(word));
+				notes[count++] = note;
+				word &= word - 1;
+				if (count == maxNotes) {
+					*notesScanned = note + 1 - firstNote;
+				}
+			}
+		}
+		blockStart = blockEnd;
+	}
+	QueryClose(&query);
+	
+	*noteCount = count;
+	return 1;
+}
+
+
+#pragma mark -
+#pragma mark Top selection
+
+typedef struct {
+	uint64_t	key;
+	uint32_t	note;
+} HeapEntry;
+
+// Maps a double onto an unsigned integer with the same order
+static uint64_t OrderedBits(double value) {
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return ((bits & 0x8000000000000000ULL) ? ~bits : (bits | 0x8000000000000000ULL));
+}
+
+static uint64_t SortKey(const Index *index, uint32_t note, NoteIndexOrder order) {
+	switch (order) {
+		case NoteIndexOrderTitleDescending:
+			return UINT32_MAX - index->titleKeys[note];
+		case NoteIndexOrderNewestFirst:
+			return ~OrderedBits(index->lastUpdated[note]);
+		case NoteIndexOrderOldestFirst:
+			return OrderedBits(index->lastUpdated[note]);
+		default:
+			return index->titleKeys[note];
+	}
+}
+
+static int Before(HeapEntry a, HeapEntry b) {
+	return (a.key < b.key || (a.key == b.key && a.note < b.note));
+}
+
+// The heap holds the first notes found so far, with the last of them at the root
+static void HeapSiftDown(HeapEntry *heap, size_t count, size_t i) {
+	for (;;) {
+		size_t latest = i;
+		size_t left = 2 * i + 1;
+		size_t right = left + 1;
+		if (left < count && Before(heap[latest], heap[left])) {
+			latest = left;
+		}
+		if (right < count && Before(heap[latest], heap[right])) {
+			latest = right;
+		}
+		if (latest == i) {
+			return;
+		}
+		HeapEntry entry = heap[i];
+		heap[i] = heap[latest];
+		heap[latest] = entry;
+		i = latest;
+	}
+}
+
+static void HeapSiftUp(HeapEntry *heap, size_t i) {
+	while (i > 0) {
+		size_t parent = (i - 1) / 2;
+		if (!Before(heap[parent], heap[i])) {
+			return;
+		}
+		HeapEntry entry = heap[i];
+		heap[i] = heap[parent];
+		heap[parent] = entry;
+		i = parent;
+	}
+}
+
+// Empties the heap into top, first to last
+static void HeapTake(HeapEntry *heap, size_t count, uint32_t *top) {
+	// Taking the root each time gives the selection last to first
+	for (size_t remaining = count; remaining > 0; remaining--) {
+		top[remaining - 1] = heap[0].note;
+		heap[0] = heap[remaining - 1];
+		HeapSiftDown(heap, remaining - 1, 0);
+	}
+}
+
+static void HeapAdd(HeapEntry *heap, size_t *count, size_t maxCount, HeapEntry entry) {
+	if (*count < maxCount) {
+		heap[*count] = entry;
+		HeapSiftUp(heap, (*count)++);
+	}
+	else if (maxCount > 0 && Before(entry, heap[0])) {
+		heap[0] = entry;
+		HeapSiftDown(heap, *count, 0);
+	}
+}
+
+size_t NoteIndexSelectTop(const void *bytes, const uint32_t *notes, size_t noteCount, NoteIndexOrder order,
+						  uint32_t *top, size_t maxTop) {
+	Index index;
+	IndexOpen(&index, bytes);
+	if (maxTop == 0) {
+		return 0;
+	}
+	HeapEntry *heap = calloc(maxTop, sizeof(HeapEntry));
+	if (heap == NULL) {
+		return 0;
+	}
+	
+	size_t count = 0;
+	for (size_t i = 0; i < noteCount; i++) {
+		HeapEntry entry;
+		entry.key = SortKey(&index, notes[i], order);
+		entry.note = notes[i];
+		HeapAdd(heap, &count, maxTop, entry);
+	}
+	HeapTake(heap, count, top);
+	free(heap);
+	return count;
+}
+
+
+#pragma mark -
+#pragma mark Facets
+
+uint32_t NoteIndexFacetValueCount(const void *bytes) {
+	return ((const IndexHeader *)bytes)->facetValueCount;
+}
+
+const char *NoteIndexFacetName(const void *bytes, uint32_t facetValue) {
+	Index index;
+	IndexOpen(&index, bytes);
+	return index.strings + index.facetOffsets[facetValue];
+}
+
+const char *NoteIndexFacetValue(const void *bytes, uint32_t facetValue) {
+	Index index;
+	IndexOpen(&index, bytes);
+	return index.strings + index.facetValueOffsets[facetValue];
+}
+
+int NoteIndexCountFacetValues(const void *bytes, const uint32_t *notes, size_t noteCount, uint32_t *counts) {
+	Index index;
+	IndexOpen(&index, bytes);
+	uint32_t facetValueCount = index.header->facetValueCount;
+	memset(counts, 0, facetValueCount * sizeof(uint32_t));
+	if (noteCount == 0 || facetValueCount == 0) {
+		return 1;
+	}
+	
+	size_t facetWords = FacetWords(index.header->noteCount);
+	uint64_t *matched = calloc(facetWords, sizeof(uint64_t));
+	if (matched == NULL) {
+		return 0;
+	}
+	for (size_t i = 0; i < noteCount; i++) {
+		matched[notes[i] / 64] |= (1ULL << (notes[i] % 64));
+	}
+	
+	// One pass over the match set, counting every value's notes in it at once
+	for (size_t word = 0; word < facetWords; word++) {
+		uint64_t matchedWord = matched[word];
+		if (matchedWord == 0) {
+			continue;
+		}
+		const uint64_t *bits = index.facetBits + word;
+		for (uint32_t value = 0; value < facetValueCount; value++, bits += facetWords) {
+			counts[value] += (uint32_t)__builtin_popcountll(matchedWord & *bits);
+		}
+	}
+	free(matched);
+	return 1;
+}
@@ -0,0 +1,176 @@
+//
+//  NoteIndex.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#ifndef NOTEINDEX_H
+#define NOTEINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "CompletionDictionary.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define kNoteIndexMaxTermLength		32		// longer words are indexed by their first 32 bytes
+
+/*
+ * Collects the notes for a note index: the values of the search schema's
+ * stored fields, and which notes each word of their title and text is in.
+ *
+ * Words are split as for a CompletionVocabulary, but every word is kept,
+ * whatever its length, and lower cased with NoteIndexFoldTerm().
+ */
+typedef struct NoteIndexBuilder NoteIndexBuilder;
+
+/*
+ * Lower cases a word in place as the index does: ASCII letters, and the two
+ * byte UTF-8 capitals of Latin-1, Greek and Cyrillic, which keep their
+ * length.  Query terms must be folded with it too, so that the two sides
+ * agree on what a non-ASCII letter matches.
+ */
+void NoteIndexFoldTerm(char *term, size_t length);
+
+NoteIndexBuilder *NoteIndexBuilderCreate(void);
+void NoteIndexBuilderFree(NoteIndexBuilder *builder);
+int NoteIndexBuilderAddNote(NoteIndexBuilder *builder, const char *noteID, const char *title, double lastUpdated,
+							const char *text, size_t textLength);
+uint32_t NoteIndexBuilderNoteCount(const NoteIndexBuilder *builder);
+
+// Gives the note added last a value of a facet (e.g. "course" and "ICND1"); a note can have any number
+int NoteIndexBuilderAddFacetValue(NoteIndexBuilder *builder, const char *facet, const char *value);
+
+/*
+ * Adds the notes of an existing index, other than those set in removedNotes
+ * (one flag per note of the index, or NULL to keep them all), without their
+ * text: their words and counts, and facet values, are copied from the index.
+ * Notes that have changed are removed here and added again from their text,
+ * so an index is brought up to date without splitting every note's words
+ * again.  Returns 0 on failure, after which the builder can only be freed.
+ */
+int NoteIndexBuilderAddIndexedNotes(NoteIndexBuilder *builder, const void *index, const uint8_t *removedNotes);
+
+/*
+ * Counts the index's words into a vocabulary, each in as many documents as
+ * the notes it's in (title or text), so the completion and spelling
+ * dictionaries follow a patched index without the notes' text being split
+ * again.  Words of kNoteIndexMaxTermLength bytes are left out, as they may
+ * have been cut short.  Returns 0 on failure.
+ */
+int NoteIndexAddTermsToVocabulary(const void *index, CompletionVocabulary *vocabulary);
+
+/*
+ * Serialises the notes into a note index, a single flat buffer allocated with
+ * malloc(), to be written out and memory mapped.  Returns 0 on failure.
+ *
+ * Notes are renumbered in lastUpdated order, newest first, so the index is
+ * laid out in the order the notes list and date sorted searches show them.
+ *
+ * The sort slots are stored as columns of fixed width doc values, one entry
+ * per note: lastUpdated (numericslot 2) as a double, and title (textslot 1)
+ * as its rank in case insensitive order, so neither needs the notes' strings
+ * to compare.  Each word has a sorted postings list of the notes it is in,
+ * and each facet value a bitset of the notes that have it.
+ */
+int NoteIndexCreate(const NoteIndexBuilder *builder, void **index, size_t *indexLength);
+
+// Whether a buffer (e.g. read back from a file) holds a usable index
+int NoteIndexIsValid(const void *index, size_t indexLength);
+
+// With the note count, tells whether an index still describes the notes it was built from
+uint32_t NoteIndexNoteCount(const void *index);
+double NoteIndexLatestUpdate(const void *index);
+
+// Stored fields of a note, numbered from 0 by lastUpdated, newest first
+const char *NoteIndexNoteID(const void *index, uint32_t note);
+const char *NoteIndexTitle(const void *index, uint32_t note);
+double NoteIndexLastUpdated(const void *index, uint32_t note);
+
+// Finds a note by its ID, by binary search; returns 0 if the index doesn't have it
+int NoteIndexFindNote(const void *index, const char *noteID, uint32_t *note);
+
+/*
+ * Finds the range of notes [*firstNote, *endNote) updated between earliest
+ * and latest inclusive.  As notes are numbered in lastUpdated order, any
+ * date range is a single range of notes, found by binary search.
+ */
+void NoteIndexNotesUpdatedBetween(const void *index, double earliest, double latest, uint32_t *firstNote, uint32_t *endNote);
+
+/*
+ * Finds the notes in [firstNote, endNote) that have a word starting with each
+ * of the terms (folded with NoteIndexFoldTerm()), in note order, stopping
+ * after maxNotes.  With no terms, every note in the range matches.  notes must have
+ * room for maxNotes entries, or as many as the range holds if that's fewer.
+ * Returns 0 on failure.
+ *
+ * Notes are numbered newest first, so the first matches are the most recently
+ * updated: a search for the newest page of a broad term stops after the page,
+ * rather than finding every match.  A date range only costs the postings
+ * inside it, as each list is entered by binary search.  notesScanned is how
+ * many notes of the range were looked at, all of them unless the search
+ * stopped early, for estimating the total from the matches found.  Terms are
+ * intersected rarest first, galloping through the postings of common ones, so
+ * adding a common term to a query costs little.
+ */
+int NoteIndexMatch(const void *index, const char *const *terms, const size_t *termLengths, size_t termCount,
+				   uint32_t firstNote, uint32_t endNote, size_t maxNotes,
+				   uint32_t *notes, size_t *noteCount, uint32_t *notesScanned);
+
+typedef enum {
+	NoteIndexOrderTitleAscending = 0,
+	NoteIndexOrderTitleDescending,
+	NoteIndexOrderNewestFirst,
+	NoteIndexOrderOldestFirst
+} NoteIndexOrder;
+
+/*
+ * Selects the first maxTop of notes in the given order into top, with a
+ * bounded heap over the doc values: O(n log maxTop) rather than sorting all n.
+ * Notes that compare equal keep their relative order.  Returns the number
+ * selected.
+ */
+size_t NoteIndexSelectTop(const void *index, const uint32_t *notes, size_t noteCount, NoteIndexOrder order,
+						  uint32_t *top, size_t maxTop);
+
+// Facet values are numbered from 0, in the order they were first added
+uint32_t NoteIndexFacetValueCount(const void *index);
+const char *NoteIndexFacetName(const void *index, uint32_t facetValue);
+const char *NoteIndexFacetValue(const void *index, uint32_t facetValue);
+
+/*
+ * Counts how many of notes have each facet value, in a single pass over the
+ * match set: each 64 notes of it are ANDed with every value's bitset and the
+ * bits counted.  counts must have room for NoteIndexFacetValueCount()
+ * entries.  Returns 0 on failure.
+ */
+int NoteIndexCountFacetValues(const void *index, const uint32_t *notes, size_t noteCount, uint32_t *counts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,71 @@
+//
+//  NoteSaveQueue.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import <CoreData/CoreData.h>
+
+@class Note;
+@class SearchDatabaseUpdater;
+
+
+/*
+ * Write-behind queue for note saves.
+ *
+ * Notes scheduled for saving are held as dirty until the queue is flushed,
+ * either flushInterval seconds after the first of them was scheduled or
+ * explicitly with -flush.  Scheduling a note that is already dirty costs
+ * nothing, and each flush saves all the dirty notes with a single Core Data
+ * save and indexes them with a single addOrReplaceRecords:.
+ *
+ * Must only be used from the main thread.
+ */
+@interface NoteSaveQueue : NSObject {
+	NSTimeInterval			flushInterval;
+	NSManagedObjectContext	*managedObjectContext;
+	SearchDatabaseUpdater	*searchDatabaseUpdater;
+	
+@private
+	NSMutableOrderedSet		*dirtyNotes;
+	NSTimer					*flushTimer;
+	NSUInteger				scheduledCount;
+	NSUInteger				savedCount;
+	NSUInteger				flushCount;
+}
+
+@property (nonatomic, assign)	NSTimeInterval			flushInterval;
+@property (nonatomic, retain)	NSManagedObjectContext	*managedObjectContext;
+@property (nonatomic, retain)	SearchDatabaseUpdater	*searchDatabaseUpdater;
+
+@property (nonatomic, readonly)	NSUInteger				scheduledCount;
+@property (nonatomic, readonly)	NSUInteger				savedCount;
+@property (nonatomic, readonly)	NSUInteger				flushCount;
+
+- (id)initWithManagedObjectContext:(NSManagedObjectContext *)aManagedObjectContext searchDatabaseUpdater:(SearchDatabaseUpdater *)aSearchDatabaseUpdater;
+- (void)scheduleSaveForNote:(Note *)note;
+- (void)cancelSaveForNote:(Note *)note;
+- (BOOL)hasPendingSaves;
+- (BOOL)flush;
+
+@end
@@ -0,0 +1,131 @@
+//
+//  NoteSaveQueue.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import "NoteSaveQueue.h"
+
+#import "Note.h"
+#import "SearchDatabaseUpdater.h"
+
+#define kDefaultFlushInterval	2.0
+
+
+@implementation NoteSaveQueue
+
+@synthesize flushInterval;
+@synthesize managedObjectContext;
+@synthesize searchDatabaseUpdater;
+@synthesize scheduledCount;
+@synthesize savedCount;
+@synthesize flushCount;
+
+- (void)flushTimerFired:(NSTimer *)timer {
+	[self flush];
+}
+
+- (void)scheduleSaveForNote:(Note *)note {
+	scheduledCount++;
+	[dirtyNotes addObject:note];
+	
+	// The interval runs from the first unsaved change, so continuous typing can't postpone a save indefinitely
+	if (nil == flushTimer) {
+		flushTimer = [[NSTimer scheduledTimerWithTimeInterval:self.flushInterval
+													   target:self
+													 selector:@selector(flushTimerFired:)
+													 userInfo:nil
+													  repeats:NO] retain];
+	}
+}
+
+- (void)cancelSaveForNote:(Note *)note {
+	[dirtyNotes removeObject:note];
+}
+
+- (BOOL)hasPendingSaves {
+	return ([dirtyNotes count] > 0);
+}
+
+- (BOOL)flush {
+	[flushTimer invalidate];
+	[flushTimer release];
+	flushTimer = nil;
+	
+	if ([dirtyNotes count] == 0) {
+		return YES;
+	}
+	
+	// Notes deleted since they were scheduled are handled by Note +deleteNote:error:
+	NSMutableArray *notes = [[NSMutableArray alloc] initWithCapacity:[dirtyNotes count]];
+	for (Note *note in dirtyNotes) {
+		if (![note isDeleted] && [note managedObjectContext]) {
+			[notes addObject:note];
+		}
+	}
+	[dirtyNotes removeAllObjects];
+	
+	// One save, and one indexing operation, per flush
+	BOOL saved = YES;
+	NSError *error = nil;
+	if (![self.managedObjectContext save:&error]) {
+		ALog(@"Error %@", [error localizedDescription]);
+		saved = NO;
+	}
+	else {
+		[self.searchDatabaseUpdater updateSearchDatabaseForNotes:notes];
+		
+		savedCount += [notes count];
+		flushCount++;
+		DLog(@"Saved %u notes (%u saves scheduled, %u flushes)", [notes count], scheduledCount, flushCount);
+	}
+	[notes release];
+	
+	return saved;
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithManagedObjectContext:(NSManagedObjectContext *)aManagedObjectContext searchDatabaseUpdater:(SearchDatabaseUpdater *)aSearchDatabaseUpdater {
+	if ((self = [super init])) {
+		self.managedObjectContext = aManagedObjectContext;
+		self.searchDatabaseUpdater = aSearchDatabaseUpdater;
+		self.flushInterval = kDefaultFlushInterval;
+		
+		dirtyNotes = [[NSMutableOrderedSet alloc] init];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[flushTimer invalidate];
+	[flushTimer release];
+	[dirtyNotes release];
+	[managedObjectContext release];
+	[searchDatabaseUpdater release];
+	
+	[super dealloc];
+}
+
+@end
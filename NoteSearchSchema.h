@@ -0,0 +1,64 @@
+//
+//  NoteSearchSchema.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+
+/*
+ * The notes search schema, compiled.
+ *
+ * notes_search_schema.plist is still what the search engine is given, but the
+ * app refers to fields through this table rather than by looking names, slots
+ * and flags up in the plist dictionary.  The table must be kept in step with
+ * the plist; NoteSearchSchemaMatchesDictionary() checks that when the search
+ * database is set up.
+ */
+typedef enum {
+	NoteSearchFieldID = 0,
+	NoteSearchFieldTitle,
+	NoteSearchFieldContent,
+	NoteSearchFieldLastUpdated,
+	NoteSearchFieldCount
+} NoteSearchField;
+
+typedef struct {
+	NSString	*name;
+	NSInteger	textSlot;		// 0 if none
+	NSInteger	numericSlot;	// 0 if none
+	NSInteger	weight;			// 0 if not weighted
+	BOOL		isStored;		// returned with search results
+	BOOL		isID;
+	BOOL		isIndexed;
+	BOOL		isSpellChecked;
+} NoteSearchFieldDescriptor;
+
+extern const NoteSearchFieldDescriptor NoteSearchFieldDescriptors[NoteSearchFieldCount];
+
+static inline NSString *NoteSearchFieldName(NoteSearchField field) {
+	return NoteSearchFieldDescriptors[field].name;
+}
+
+NSArray *NoteSearchSortOrderForField(NoteSearchField field, BOOL ascending);
+BOOL NoteSearchSchemaMatchesDictionary(NSDictionary *schema, NSString **mismatchDescription);
@@ -0,0 +1,87 @@
+//
+//  NoteSearchSchema.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import "NoteSearchSchema.h"
+
+
+// Compiled from notes_search_schema.plist
+const NoteSearchFieldDescriptor NoteSearchFieldDescriptors[NoteSearchFieldCount] = {
+	// name				textSlot	numericSlot	weight	isStored	isID	isIndexed	isSpellChecked
+	{ @"id",			0,			0,			0,		YES,		YES,	NO,			NO },
+	{ @"title",			1,			0,			5,		YES,		NO,		YES,		YES },
+	{ @"content",		0,			0,			0,		NO,			NO,		YES,		YES },		// bodies are fetched by note ID, not stored in the index
+	{ @"lastUpdated",	0,			2,			0,		YES,		NO,		NO,			NO },
+};
+
+
+/**
+ Returns a sort order for LSLocaytaSearchRequest on the field's slot, or nil (relevance) if it has none.
+ */
+NSArray *NoteSearchSortOrderForField(NoteSearchField field, BOOL ascending) {
+	const NoteSearchFieldDescriptor *descriptor = &NoteSearchFieldDescriptors[field];
+	NSInteger slot = (descriptor->textSlot ? descriptor->textSlot : descriptor->numericSlot);
+	if (slot == 0) {
+		return nil;
+	}
+	return [NSArray arrayWithObject:[NSString stringWithFormat:@"%@%d", (ascending ? @"+" : @"-"), slot]];
+}
+
+static NSInteger SchemaIntegerValue(NSDictionary *fieldSchema, NSString *key) {
+	return [[fieldSchema objectForKey:key] integerValue];
+}
+
+static BOOL SchemaBoolValue(NSDictionary *fieldSchema, NSString *key) {
+	return [[fieldSchema objectForKey:key] boolValue];
+}
+
+BOOL NoteSearchSchemaMatchesDictionary(NSDictionary *schema, NSString **mismatchDescription) {
+	NSString *mismatch = nil;
+	
+	if ([schema count] != NoteSearchFieldCount) {
+		mismatch = [NSString stringWithFormat:@"schema has %u fields, expected %d", [schema count], NoteSearchFieldCount];
+	}
+	for (NSInteger field = 0; field < NoteSearchFieldCount && nil == mismatch; field++) {
+		const NoteSearchFieldDescriptor *descriptor = &NoteSearchFieldDescriptors[field];
+		NSDictionary *fieldSchema = [schema objectForKey:descriptor->name];
+		
+		if (nil == fieldSchema) {
+			mismatch = [NSString stringWithFormat:@"field \"%@\" is missing", descriptor->name];
+		}
+		else if (SchemaIntegerValue(fieldSchema, @"textslot") != descriptor->textSlot ||
+				 SchemaIntegerValue(fieldSchema, @"numericslot") != descriptor->numericSlot ||
+				 SchemaIntegerValue(fieldSchema, @"weight") != descriptor->weight ||
+				 SchemaBoolValue(fieldSchema, @"field") != descriptor->isStored ||
+				 SchemaBoolValue(fieldSchema, @"id") != descriptor->isID ||
+				 SchemaBoolValue(fieldSchema, @"index") != descriptor->isIndexed ||
+				 SchemaBoolValue(fieldSchema, @"spell") != descriptor->isSpellChecked) {
+			mismatch = [NSString stringWithFormat:@"field \"%@\" differs from the compiled schema", descriptor->name];
+		}
+	}
+	
+	if (mismatchDescription) {
+		*mismatchDescription = mismatch;
+	}
+	return (nil == mismatch);
+}
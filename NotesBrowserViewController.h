@@ -28,22 +28,29 @@
 #import <UIKit/UIKit.h>
 #import "NotesBrowserTableViewController.h"
 #import "SearchDatabaseRequester.h"
+#import "SearchResultCursor.h"
 
 @class LSLocaytaSearchResult;
 @class NotesBrowserTableViewController;
 
-@interface NotesBrowserViewController : UIViewController <NotesBrowserTableViewControllerDelegate, UISearchDisplayDelegate, SearchDatabaseRequesterDelegate> {
+@interface NotesBrowserViewController : UIViewController <NotesBrowserTableViewControllerDelegate, UISearchDisplayDelegate, SearchDatabaseRequesterDelegate, SearchResultCursorDelegate> {
 	UIToolbar							*bottomToolbar;
-	LSLocaytaSearchResult				*currentSearchResult;
+	SearchResultCursor					*currentResultCursor;
 	UIBarButtonItem						*editNoteBarButtonItem;
 	UIBarButtonItem						*editNoteDoneBarButtonItem;
 	NotesBrowserTableViewController		*notesBrowserTableViewController;
 	UILabel								*searchSummaryLabel;
 	UIView								*searchSummaryView;
+	
+@private
+	NSMutableDictionary					*snippetsByNoteID;
+	NSMutableSet						*pendingSnippetNoteIDs;	// being made on snippetQueue
+	dispatch_queue_t					snippetQueue;
+	UIToolbar							*completionBar;		// above the keyboard while searching
 }
 
 @property (nonatomic, retain)	IBOutlet	UIToolbar							*bottomToolbar;
-@property (nonatomic, retain)				LSLocaytaSearchResult				*currentSearchResult;
+@property (nonatomic, retain)				SearchResultCursor					*currentResultCursor;
 @property (nonatomic, retain)	IBOutlet	UIBarButtonItem						*editNoteBarButtonItem;
 @property (nonatomic, retain)	IBOutlet	UIBarButtonItem						*editNoteDoneBarButtonItem;
 @property (nonatomic, retain)	IBOutlet	NotesBrowserTableViewController		*notesBrowserTableViewController;
@@ -33,19 +33,40 @@
 #import "EditNoteViewController.h"
 #import "InfoViewController.h"
 #import "Note+Management.h"
+#import "NoteDocumentStore.h"
+#import "NoteSearchSchema.h"
 #import "SearchDatabaseUpdater.h"
+#import "SearchSnippet.h"
 #import "SettingsTableViewController.h"
+#import "XHTMLExtractedText.h"
+
+#define kMaxSearchCompletions	4
 
 @implementation NotesBrowserViewController
 
 @synthesize bottomToolbar;
-@synthesize currentSearchResult;
+@synthesize currentResultCursor;
 @synthesize editNoteBarButtonItem;
 @synthesize editNoteDoneBarButtonItem;
 @synthesize notesBrowserTableViewController;
 @synthesize searchSummaryLabel;
 @synthesize searchSummaryView;
 
+- (void)setCurrentResultCursor:(SearchResultCursor *)aResultCursor {
+	if (aResultCursor != currentResultCursor) {
+		currentResultCursor.delegate = nil;
+		[currentResultCursor cancel];
+		[currentResultCursor release];
+		currentResultCursor = [aResultCursor retain];
+		currentResultCursor.delegate = self;
+		
+		[snippetsByNoteID release];
+		snippetsByNoteID = [[NSMutableDictionary alloc] init];
+		[pendingSnippetNoteIDs release];
+		pendingSnippetNoteIDs = [[NSMutableSet alloc] init];
+	}
+}
+
 - (void)settingsDoneAction {
 	[self dismissViewControllerAnimated:YES completion:nil];
 }
@@ -90,13 +111,15 @@
 		notesString = @"notes";
 	}
 
-	NSString *searchSummaryText = [NSString stringWithFormat:@"%@%d %@ found.", spellCorrectedText, searchResult.matchCount, notesString];
+	// Searches that stop once they have the first page only estimate how many there are
+	NSString *approximateText = (searchResult.matchCountExact ? @"" : @"About ");
+	NSString *searchSummaryText = [NSString stringWithFormat:@"%@%@%d %@ found.", spellCorrectedText, approximateText, searchResult.matchCount, notesString];
 	self.searchSummaryLabel.text = searchSummaryText;
 }
 
 - (void)searchWithText:(NSString *)searchText sortBy:(SearchSortBy)sortBy {
 	if ([searchText isEqualToString:@""]) {
-		self.currentSearchResult = nil;
+		self.currentResultCursor = nil;
 		[self.searchDisplayController.searchResultsTableView reloadData];
 	}
 	else {
@@ -108,16 +131,20 @@
 }
 
 - (void)searchIndexDidUpdate {
-	if (currentSearchResult) {
+	if (currentResultCursor) {
 		// Refresh search results
 		[self searchWithText:self.searchDisplayController.searchBar.text sortBy:self.searchDisplayController.searchBar.selectedScopeButtonIndex];
 	}
 }
 
-- (void)displayNoteEditorWithNote:(Note *)note {
+/**
+ Opens the note, with the hits of the query terms marked when it was picked from search results.
+ */
+- (void)displayNoteEditorWithNote:(Note *)note queryTerms:(NSSet *)queryTerms {
 	if (UI_USER_INTERFACE_IDIOM() == UIUserInterfaceIdiomPad) {
 		AppDelegate_Pad *appDelegate = [[UIApplication sharedApplication] delegate];
 		if (note) {
+			appDelegate.editNoteViewController.queryTerms = queryTerms;
 			[appDelegate.editNoteViewController changeNoteBeingEdited:note];
 		}
 		else {
@@ -131,12 +158,17 @@
 		if (note) {
 			EditNoteViewController *editNoteViewController = [[EditNoteViewController alloc] initWithNibName:@"EditNoteViewController" bundle:nil];
 			editNoteViewController.note = note;
+			editNoteViewController.queryTerms = queryTerms;
 			[self.navigationController pushViewController:editNoteViewController animated:YES];
 			[editNoteViewController release];
 		}
 	}
 }
 
+- (void)displayNoteEditorWithNote:(Note *)note {
+	[self displayNoteEditorWithNote:note queryTerms:nil];
+}
+
 - (IBAction)editNotesButtonPressed {
 	[self.notesBrowserTableViewController.tableView setEditing:(!self.notesBrowserTableViewController.tableView.editing) animated:YES];
 	
@@ -179,14 +211,118 @@
 }
 
 
+#pragma mark -
+#pragma mark Snippets
+
+/**
+ Makes a note's snippet off the main thread, then reloads its row if it's still on screen.  Bundled notes take their
+ text from the document store, so their bodies aren't faulted in: the text stored when the document was imported, or
+ failing that extracted from the mapped document (and stored for next time); others are read in a context of the
+ snippet queue's own.
+ */
+- (void)makeSnippetForNoteID:(NSString *)noteID title:(NSString *)title row:(NSInteger)row {
+	if (NULL == snippetQueue) {
+		snippetQueue = dispatch_queue_create("NotesBrowserViewController.snippets", DISPATCH_QUEUE_SERIAL);
+	}
+	NSMutableDictionary *snippets = snippetsByNoteID;
+	NSSet *queryTerms = self.currentResultCursor.searchResult.queryTerms;
+	NoteDocumentStore *documentStore = [[AppDelegate_Shared sharedAppDelegate] noteDocumentStore];
+	NSPersistentStoreCoordinator *coordinator = [[AppDelegate_Shared sharedAppDelegate] persistentStoreCoordinator];
+	[pendingSnippetNoteIDs addObject:noteID];
+	
+	dispatch_async(snippetQueue, ^{
+		SearchSnippet *snippet = nil;
+		@autoreleasepool {
+			NSString *text = (title ? [documentStore extractedTextForDocumentNamed:title] : nil);
+			NSData *data = (text || nil == title ? nil : [documentStore dataForDocumentNamed:title]);
+			if (data) {
+				text = [[XHTMLExtractedText extractedTextFromData:data] text];
+				[documentStore storeExtractedText:text forDocumentNamed:title];
+			}
+			else if (nil == text) {
+				NSManagedObjectContext *context = [[NSManagedObjectContext alloc] init];
+				[context setPersistentStoreCoordinator:coordinator];
+				text = [[[Note contentForNoteWithObjectID:noteID inContext:context] copy] autorelease];
+				[context release];
+			}
+			snippet = [[SearchSnippet snippetForText:text queryTerms:queryTerms] retain];
+		}
+		
+		dispatch_async(dispatch_get_main_queue(), ^{
+			// Snippets are dropped along with the results they were made for
+			if (snippets == snippetsByNoteID) {
+				[snippetsByNoteID setObject:(snippet ? snippet : [NSNull null]) forKey:noteID];
+				[pendingSnippetNoteIDs removeObject:noteID];
+				
+				UITableView *tableView = self.searchDisplayController.searchResultsTableView;
+				for (NSIndexPath *indexPath in [tableView indexPathsForVisibleRows]) {
+					if (indexPath.row == row) {
+						[tableView reloadRowsAtIndexPaths:[NSArray arrayWithObject:indexPath] withRowAnimation:UITableViewRowAnimationNone];
+						break;
+					}
+				}
+			}
+			[snippet release];
+		});
+	});
+}
+
+/**
+ Snippets are made when a row is first displayed, and kept for as long as the current results.  Returns nil while a
+ note's snippet is still being made.
+ */
+- (SearchSnippet *)snippetForNoteID:(NSString *)noteID title:(NSString *)title row:(NSInteger)row {
+	if (nil == noteID) {
+		return nil;
+	}
+	id snippet = [snippetsByNoteID objectForKey:noteID];
+	if (nil == snippet && ![pendingSnippetNoteIDs containsObject:noteID]) {
+		[self makeSnippetForNoteID:noteID title:title row:row];
+	}
+	return (snippet == [NSNull null] ? nil : snippet);
+}
+
+- (NSAttributedString *)attributedTextForSnippet:(SearchSnippet *)snippet font:(UIFont *)font {
+	NSMutableAttributedString *attributedText = [[NSMutableAttributedString alloc] initWithString:snippet.text
+																					   attributes:[NSDictionary dictionaryWithObject:font forKey:NSFontAttributeName]];
+	UIFont *highlightFont = [UIFont boldSystemFontOfSize:font.pointSize];
+	for (NSValue *rangeValue in snippet.highlightRanges) {
+		[attributedText addAttribute:NSFontAttributeName value:highlightFont range:[rangeValue rangeValue]];
+	}
+	return [attributedText autorelease];
+}
+
+
 #pragma mark -
 #pragma mark SearchDatabaseRequesterDelegate methods
 
-- (void)searchCompleteWithResult:(LSLocaytaSearchResult *)searchResult {
-	DLog(@"searchResult: %@", searchResult);
-	self.currentSearchResult = searchResult;
+- (void)searchCompleteWithResultCursor:(SearchResultCursor *)resultCursor {
+	DLog(@"searchResult: %@", resultCursor.searchResult);
+	self.currentResultCursor = resultCursor;
 	
-	[self updateSearchSummary:searchResult];
+	[self updateSearchSummary:resultCursor.searchResult];
+	[self.searchDisplayController.searchResultsTableView reloadData];
+}
+
+
+#pragma mark -
+#pragma mark SearchResultCursorDelegate methods
+
+- (void)searchResultCursor:(SearchResultCursor *)cursor didLoadResultsInRange:(NSRange)range {
+	// Only rows on screen need refreshing - the rest are filled in as they scroll into view
+	UITableView *tableView = self.searchDisplayController.searchResultsTableView;
+	NSMutableArray *loadedIndexPaths = [NSMutableArray array];
+	for (NSIndexPath *indexPath in [tableView indexPathsForVisibleRows]) {
+		if (NSLocationInRange(indexPath.row, range)) {
+			[loadedIndexPaths addObject:indexPath];
+		}
+	}
+	if ([loadedIndexPaths count] > 0) {
+		[tableView reloadRowsAtIndexPaths:loadedIndexPaths withRowAnimation:UITableViewRowAnimationNone];
+	}
+}
+
+- (void)searchResultCursorDidChangeCount:(SearchResultCursor *)cursor {
 	[self.searchDisplayController.searchResultsTableView reloadData];
 }
 
@@ -195,12 +331,66 @@
 }
 
 
+#pragma mark -
+#pragma mark Completions
+
+/**
+ The word being typed at the end of the search text, or NSNotFound once it has been finished with a space.
+ */
+- (NSRange)rangeOfWordFragmentInSearchText:(NSString *)searchText {
+	NSRange separator = [searchText rangeOfCharacterFromSet:[[NSCharacterSet alphanumericCharacterSet] invertedSet]
+													options:NSBackwardsSearch];
+	NSUInteger start = (separator.location == NSNotFound ? 0 : NSMaxRange(separator));
+	if (start >= [searchText length]) {
+		return NSMakeRange(NSNotFound, 0);
+	}
+	return NSMakeRange(start, [searchText length] - start);
+}
+
+- (void)updateCompletionsForSearchText:(NSString *)searchText {
+	NSRange fragmentRange = [self rangeOfWordFragmentInSearchText:searchText];
+	NSArray *completions = nil;
+	if (fragmentRange.location != NSNotFound) {
+		AppDelegate_Pad *appDelegate = [[UIApplication sharedApplication] delegate];
+		completions = [appDelegate.searchDatabaseRequester completionsForWordFragment:[searchText substringWithRange:fragmentRange]
+																	   maxCompletions:kMaxSearchCompletions];
+	}
+	
+	NSMutableArray *items = [NSMutableArray arrayWithCapacity:[completions count]];
+	for (NSString *completion in completions) {
+		UIBarButtonItem *item = [[UIBarButtonItem alloc] initWithTitle:completion
+																 style:UIBarButtonItemStyleBordered
+																target:self
+																action:@selector(completionButtonAction:)];
+		[items addObject:item];
+		[item release];
+	}
+	completionBar.items = items;
+	completionBar.hidden = ([items count] == 0);
+}
+
+- (void)completionButtonAction:(UIBarButtonItem *)item {
+	UISearchBar *searchBar = self.searchDisplayController.searchBar;
+	NSRange fragmentRange = [self rangeOfWordFragmentInSearchText:searchBar.text];
+	if (fragmentRange.location == NSNotFound) {
+		return;
+	}
+	
+	// Setting the text doesn't tell the search display controller, so search here
+	NSString *completedText = [searchBar.text stringByReplacingCharactersInRange:fragmentRange withString:[item.title stringByAppendingString:@" "]];
+	searchBar.text = completedText;
+	[self updateCompletionsForSearchText:completedText];
+	[self searchWithText:completedText sortBy:searchBar.selectedScopeButtonIndex];
+}
+
+
 #pragma mark -
 #pragma mark UISearchDisplayDelegate methods
 
 - (BOOL)searchDisplayController:(UISearchDisplayController *)controller shouldReloadTableForSearchString:(NSString *)searchString {
 	DLog(@"shouldReloadTableForSearchString: \"%@\"", searchString);
 	
+	[self updateCompletionsForSearchText:searchString];
 	[self searchWithText:searchString sortBy:controller.searchBar.selectedScopeButtonIndex];
 	
 	return NO; // search is async
@@ -220,7 +410,7 @@
 #pragma mark UITableViewDataSource methods
 
 - (NSInteger)tableView:(UITableView *)tableView numberOfRowsInSection:(NSInteger)section {
-	return [self.currentSearchResult.results count];
+	return self.currentResultCursor.count;
 }
 
 
@@ -237,26 +427,42 @@
 		cell = [[[UITableViewCell alloc] initWithStyle:UITableViewCellStyleSubtitle reuseIdentifier:CellIdentifier] autorelease];
 	}
 	
-	NSDictionary *result = [self.currentSearchResult.results objectAtIndex:indexPath.row];
-	NSDictionary *fields = [result valueForKey:@"fields"];
-	
-	cell.textLabel.text = [[fields valueForKey:@"title"] objectAtIndex:0];
-	NSDate *lastUpdated = [NSDate dateWithTimeIntervalSinceReferenceDate:[[[fields valueForKey:@"lastUpdated"] objectAtIndex:0] doubleValue]];
-	cell.detailTextLabel.text = [NSString stringWithFormat:@"%@", lastUpdated];
+	// Field values are only looked at for rows that are actually displayed
+	NSDictionary *result = [self.currentResultCursor resultAtIndex:indexPath.row];
+	if (result) {
+		NSDictionary *fields = [result valueForKey:@"fields"];
+		NSString *title = [[fields valueForKey:NoteSearchFieldName(NoteSearchFieldTitle)] objectAtIndex:0];
+		cell.textLabel.text = title;
+		NSDate *lastUpdated = [NSDate dateWithTimeIntervalSinceReferenceDate:[[[fields valueForKey:NoteSearchFieldName(NoteSearchFieldLastUpdated)] objectAtIndex:0] doubleValue]];
+		
+		// Until the snippet is ready the row shows the date, and it's reloaded with the snippet
+		SearchSnippet *snippet = [self snippetForNoteID:[[fields valueForKey:NoteSearchFieldName(NoteSearchFieldID)] objectAtIndex:0]
+												  title:title row:indexPath.row];
+		if (snippet) {
+			cell.detailTextLabel.attributedText = [self attributedTextForSnippet:snippet font:cell.detailTextLabel.font];
+		}
+		else {
+			cell.detailTextLabel.text = [NSString stringWithFormat:@"%@", lastUpdated];
+		}
+	}
+	else {
+		// Still being fetched - the cursor reloads the row when it arrives
+		cell.textLabel.text = @"Loading...";
+		cell.detailTextLabel.text = nil;
+	}
 	
 	return cell;
 }
 
 - (void)tableView:(UITableView *)tableView didSelectRowAtIndexPath:(NSIndexPath *)indexPath {
-	if (currentSearchResult) {
-		NSDictionary *result = [currentSearchResult.results objectAtIndex:indexPath.row];
-		NSDictionary *fields = [result valueForKey:@"fields"];
-		NSString *objectID = [[fields valueForKey:@"id"] objectAtIndex:0];
-		
-		ZAssert(objectID != nil, @"Result contains no 'id' field");
+	if (currentResultCursor) {
+		NSString *objectID = [currentResultCursor stringValueForField:NoteSearchFieldName(NoteSearchFieldID) atIndex:indexPath.row];
+		if (nil == objectID) {
+			return;		// not loaded yet
+		}
 		
 		Note *note = [Note noteForObjectID:objectID];
-		[self displayNoteEditorWithNote:note];
+		[self displayNoteEditorWithNote:note queryTerms:currentResultCursor.searchResult.queryTerms];
 		
 		self.notesBrowserTableViewController.selectedNoteID = objectID;
 		[self.notesBrowserTableViewController selectSelectedNote];
@@ -337,6 +543,16 @@
 	[self.view addSubview:self.notesBrowserTableViewController.view];
 	[self.view sendSubviewToBack:self.notesBrowserTableViewController.view];
 	
+	// Completions of the word being typed sit above the keyboard
+	UISearchBar *searchBar = self.searchDisplayController.searchBar;
+	if ([searchBar respondsToSelector:@selector(setInputAccessoryView:)]) {
+		completionBar = [[UIToolbar alloc] initWithFrame:CGRectMake(0.0, 0.0, self.view.frame.size.width, 44.0)];
+		completionBar.barStyle = UIBarStyleBlackTranslucent;
+		completionBar.autoresizingMask = UIViewAutoresizingFlexibleWidth;
+		completionBar.hidden = YES;
+		searchBar.inputAccessoryView = completionBar;
+	}
+	
 	[[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(searchIndexDidUpdate) name:kSearchDatabaseDidUpdateNotification object:nil];
 }
 
@@ -376,12 +592,22 @@
     [super viewDidUnload];
     // Release any retained subviews of the main view.
     // e.g. self.myOutlet = nil;
+	[completionBar release];
+	completionBar = nil;
 }
 
 
 - (void)dealloc {
 	[bottomToolbar release];
-	[currentSearchResult release];
+	currentResultCursor.delegate = nil;
+	[currentResultCursor cancel];
+	[currentResultCursor release];
+	[snippetsByNoteID release];
+	[pendingSnippetNoteIDs release];
+	if (snippetQueue) {
+		dispatch_release(snippetQueue);
+	}
+	[completionBar release];
 	[editNoteBarButtonItem release];
 	[editNoteDoneBarButtonItem release];
 	[notesBrowserTableViewController release];
@@ -0,0 +1,63 @@
+//
+//  RefinedSearchResult.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import <LocaytaSearch/LSLocaytaSearchResult.h>
+
+
+/*
+ * A search result derived, without searching the index, from the result of a
+ * query that the new query extends.
+ *
+ * With the AND operator, a query that only adds characters to its last term
+ * or adds more terms can only match a subset of the documents the shorter
+ * query matched.  So when that earlier result holds every matching document,
+ * the new result is found by filtering it: a document is kept if each new or
+ * extended term starts a word in its title or content.  Content isn't stored
+ * in the index, so the terms a title doesn't have are checked by note ID
+ * through contentMatcher.
+ *
+ * This is an approximation of the index's stemmed matching, so it is intended
+ * to be shown while the user is typing and replaced by a real search once they
+ * pause.
+ */
+typedef BOOL (^NoteContentMatcher)(NSString *noteID, NSArray *terms);
+
+
+@interface RefinedSearchResult : LSLocaytaSearchResult {
+@private
+	NSString	*refinedQueryString;
+	NSArray		*refinedResults;
+}
+
+// The query's terms, or nil if it uses any query syntax beyond plain words
++ (NSArray *)plainTermsInQueryString:(NSString *)queryString;
+
++ (RefinedSearchResult *)resultByRefiningResult:(LSLocaytaSearchResult *)searchResult
+								fromQueryString:(NSString *)previousQueryString
+								  toQueryString:(NSString *)queryString
+								 contentMatcher:(NoteContentMatcher)contentMatcher;
+
+@end
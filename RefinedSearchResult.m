@@ -0,0 +1,219 @@
+//
+//  RefinedSearchResult.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import "RefinedSearchResult.h"
+
+#import "NoteSearchSchema.h"
+
+
+@interface RefinedSearchResult ()
+- (id)initWithQueryString:(NSString *)aQueryString results:(NSArray *)someResults;
+@end
+
+
+@implementation RefinedSearchResult
+
+/**
+ Returns the query's terms, or nil if it uses any query syntax beyond plain words.
+ */
++ (NSArray *)plainTermsInQueryString:(NSString *)queryString {
+	NSCharacterSet *syntaxCharacters = [NSCharacterSet characterSetWithCharactersInString:@"\"()*:+-"];
+	if ([queryString rangeOfCharacterFromSet:syntaxCharacters].location != NSNotFound) {
+		return nil;
+	}
+	
+	NSArray *words = [queryString componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+	NSMutableArray *terms = [NSMutableArray arrayWithCapacity:[words count]];
+	for (NSString *word in words) {
+		if ([word length] == 0) {
+			continue;
+		}
+		if ([word isEqualToString:@"AND"] || [word isEqualToString:@"OR"] || [word isEqualToString:@"NOT"]) {
+			return nil;
+		}
+		[terms addObject:word];
+	}
+	return terms;
+}
+
+/**
+ Returns YES if term starts a word anywhere in text.
+ */
++ (BOOL)text:(NSString *)text containsWordWithPrefix:(NSString *)term {
+	NSCharacterSet *alphanumericCharacters = [NSCharacterSet alphanumericCharacterSet];
+	NSStringCompareOptions options = (NSCaseInsensitiveSearch | NSDiacriticInsensitiveSearch);
+	NSUInteger textLength = [text length];
+	NSRange searchRange = NSMakeRange(0, textLength);
+	
+	while (searchRange.length > 0) {
+		NSRange range = [text rangeOfString:term options:options range:searchRange];
+		if (range.location == NSNotFound) {
+			return NO;
+		}
+		if (range.location == 0 || ![alphanumericCharacters characterIsMember:[text characterAtIndex:range.location - 1]]) {
+			return YES;
+		}
+		searchRange.location = range.location + 1;
+		searchRange.length = textLength - searchRange.location;
+	}
+	return NO;
+}
+
++ (BOOL)fields:(NSDictionary *)fields matchTerms:(NSArray *)terms contentMatcher:(NoteContentMatcher)contentMatcher {
+	NSArray *titles = [fields valueForKey:NoteSearchFieldName(NoteSearchFieldTitle)];
+	NSMutableArray *contentTerms = nil;
+	
+	for (NSString *term in terms) {
+		BOOL matched = NO;
+		for (NSString *title in titles) {
+			if ([self text:title containsWordWithPrefix:term]) {
+				matched = YES;
+				break;
+			}
+		}
+		if (!matched) {
+			if (nil == contentTerms) {
+				contentTerms = [NSMutableArray arrayWithCapacity:[terms count]];
+			}
+			[contentTerms addObject:term];
+		}
+	}
+	if (nil == contentTerms) {
+		return YES;
+	}
+	
+	// The body isn't stored in the index - only look it up if the title doesn't decide
+	NSString *noteID = [[fields valueForKey:NoteSearchFieldName(NoteSearchFieldID)] lastObject];
+	return (noteID && contentMatcher && contentMatcher(noteID, contentTerms));
+}
+
++ (RefinedSearchResult *)resultByRefiningResult:(LSLocaytaSearchResult *)searchResult
+								fromQueryString:(NSString *)previousQueryString
+								  toQueryString:(NSString *)queryString
+								 contentMatcher:(NoteContentMatcher)contentMatcher {
+	// The earlier result must hold every document it matched, for the exact query that was typed
+	if (nil == searchResult || !searchResult.matchCountExact || searchResult.itemCount < searchResult.matchCount ||
+		searchResult.wasAutoSpellCorrected) {
+		return nil;
+	}
+	
+	NSArray *previousTerms = [self plainTermsInQueryString:previousQueryString];
+	NSArray *terms = [self plainTermsInQueryString:queryString];
+	NSUInteger previousTermCount = [previousTerms count];
+	if (previousTermCount == 0 || [terms count] < previousTermCount) {
+		return nil;
+	}
+	
+	// Every earlier term must be unchanged, except the last which may have been extended
+	for (NSUInteger i=0; i<previousTermCount-1; i++) {
+		if ([[previousTerms objectAtIndex:i] caseInsensitiveCompare:[terms objectAtIndex:i]] != NSOrderedSame) {
+			return nil;
+		}
+	}
+	NSString *previousLastTerm = [previousTerms lastObject];
+	NSString *extendedTerm = [terms objectAtIndex:previousTermCount-1];
+	NSRange prefixRange = [extendedTerm rangeOfString:previousLastTerm options:(NSCaseInsensitiveSearch | NSAnchoredSearch)];
+	if (prefixRange.location == NSNotFound) {
+		return nil;
+	}
+	
+	NSMutableArray *termsToMatch = [NSMutableArray arrayWithArray:[terms subarrayWithRange:NSMakeRange(previousTermCount, [terms count] - previousTermCount)]];
+	if ([extendedTerm length] > [previousLastTerm length]) {
+		[termsToMatch addObject:extendedTerm];
+	}
+	if ([termsToMatch count] == 0) {
+		return nil;
+	}
+	
+	NSMutableArray *results = [NSMutableArray arrayWithCapacity:[searchResult.results count]];
+	for (NSDictionary *result in searchResult.results) {
+		if ([self fields:[result valueForKey:@"fields"] matchTerms:termsToMatch contentMatcher:contentMatcher]) {
+			[results addObject:result];
+		}
+	}
+	
+	return [[[RefinedSearchResult alloc] initWithQueryString:queryString results:results] autorelease];
+}
+
+
+#pragma mark -
+#pragma mark LSLocaytaSearchResult properties
+
+- (NSString *)requestedQueryString {
+	return refinedQueryString;
+}
+
+- (NSString *)correctedQueryString {
+	return nil;
+}
+
+- (NSString *)suggestedQueryString {
+	return nil;
+}
+
+- (NSSet *)queryTerms {
+	return [NSSet setWithArray:[RefinedSearchResult plainTermsInQueryString:refinedQueryString]];
+}
+
+- (BOOL)wasAutoSpellCorrected {
+	return NO;
+}
+
+- (NSInteger)itemCount {
+	return [refinedResults count];
+}
+
+- (NSInteger)matchCount {
+	return [refinedResults count];
+}
+
+- (BOOL)matchCountExact {
+	return YES;
+}
+
+- (NSArray *)results {
+	return refinedResults;
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithQueryString:(NSString *)aQueryString results:(NSArray *)someResults {
+	if ((self = [super init])) {
+		refinedQueryString = [aQueryString copy];
+		refinedResults = [someResults copy];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[refinedQueryString release];
+	[refinedResults release];
+	
+	[super dealloc];
+}
+
+@end
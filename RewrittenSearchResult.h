@@ -0,0 +1,53 @@
+//
+//  RewrittenSearchResult.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import <Foundation/Foundation.h>
+#import <LocaytaSearch/LSLocaytaSearchResult.h>
+
+
+/*
+ * The result of searching for a rewritten query - spell corrected, or with
+ * synonyms expanded - reported as the result of the query that was typed.
+ *
+ * A spell corrected result is reported as the search engine's own spell
+ * correction would report it.  Later pages of results must be searched for
+ * with the rewritten query.
+ */
+@interface RewrittenSearchResult : LSLocaytaSearchResult {
+@private
+	LSLocaytaSearchResult	*rewrittenResult;
+	NSString				*typedQueryString;
+	NSString				*spellCorrectedQueryString;
+}
+
+// What the search engine was asked for
+@property (nonatomic, readonly)	NSString	*rewrittenQueryString;
+
++ (RewrittenSearchResult *)resultWithRewrittenResult:(LSLocaytaSearchResult *)searchResult
+									typedQueryString:(NSString *)queryString
+						   spellCorrectedQueryString:(NSString *)correctedQueryString;
+
+@end
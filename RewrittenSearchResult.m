@@ -0,0 +1,117 @@
+//
+//  RewrittenSearchResult.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import "RewrittenSearchResult.h"
+
+
+@interface RewrittenSearchResult ()
+- (id)initWithRewrittenResult:(LSLocaytaSearchResult *)searchResult
+			 typedQueryString:(NSString *)queryString
+	spellCorrectedQueryString:(NSString *)correctedQueryString;
+@end
+
+
+@implementation RewrittenSearchResult
+
+/**
+ correctedQueryString is nil unless the typed query was spell corrected.
+ */
++ (RewrittenSearchResult *)resultWithRewrittenResult:(LSLocaytaSearchResult *)searchResult
+									typedQueryString:(NSString *)queryString
+						   spellCorrectedQueryString:(NSString *)correctedQueryString {
+	return [[[RewrittenSearchResult alloc] initWithRewrittenResult:searchResult
+												  typedQueryString:queryString
+										 spellCorrectedQueryString:correctedQueryString] autorelease];
+}
+
+- (NSString *)rewrittenQueryString {
+	return rewrittenResult.requestedQueryString;
+}
+
+
+#pragma mark -
+#pragma mark LSLocaytaSearchResult properties
+
+- (NSString *)requestedQueryString {
+	return typedQueryString;
+}
+
+- (NSString *)correctedQueryString {
+	return spellCorrectedQueryString;
+}
+
+- (NSString *)suggestedQueryString {
+	return nil;
+}
+
+- (NSSet *)queryTerms {
+	return rewrittenResult.queryTerms;
+}
+
+- (BOOL)wasAutoSpellCorrected {
+	return (spellCorrectedQueryString != nil);
+}
+
+- (NSInteger)itemCount {
+	return rewrittenResult.itemCount;
+}
+
+- (NSInteger)matchCount {
+	return rewrittenResult.matchCount;
+}
+
+- (BOOL)matchCountExact {
+	return rewrittenResult.matchCountExact;
+}
+
+- (NSArray *)results {
+	return rewrittenResult.results;
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithRewrittenResult:(LSLocaytaSearchResult *)searchResult
+			 typedQueryString:(NSString *)queryString
+	spellCorrectedQueryString:(NSString *)correctedQueryString {
+	if ((self = [super init])) {
+		rewrittenResult = [searchResult retain];
+		typedQueryString = [queryString copy];
+		spellCorrectedQueryString = [correctedQueryString copy];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[rewrittenResult release];
+	[typedQueryString release];
+	[spellCorrectedQueryString release];
+	
+	[super dealloc];
+}
+
+@end
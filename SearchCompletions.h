@@ -0,0 +1,54 @@
+//
+//  SearchCompletions.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import <Foundation/Foundation.h>
+
+#include "CompletionDictionary.h"
+
+#define kSearchCompletionsFilename		@"completions.dict"
+
+
+/*
+ * Word completions for the search bar, ranked by the number of notes each
+ * word appears in.
+ *
+ * The completion dictionary (see CompletionDictionaryCreate()) is built from
+ * the vocabulary of the notes' text when the search database changes and kept
+ * in the search database directory, from where it is memory mapped.  Lookups don't depend on
+ * the size of the vocabulary beyond a binary search, taking a few
+ * microseconds, so they can be made on every keystroke.
+ */
+@interface SearchCompletions : NSObject {
+@private
+	NSData	*dictionaryData;
+}
+
++ (BOOL)writeCompletionsForVocabulary:(const CompletionVocabulary *)vocabulary toFile:(NSString *)path;
+
+- (id)initWithContentsOfFile:(NSString *)path;
+- (NSArray *)completionsForWordFragment:(NSString *)fragment maxCompletions:(NSUInteger)maxCompletions;
+
+@end
@@ -0,0 +1,98 @@
+//
+//  SearchCompletions.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import "SearchCompletions.h"
+
+#define kMaxCompletions		8
+
+
+@implementation SearchCompletions
+
+/**
+ Builds a completion dictionary from the vocabulary and writes it to path, replacing any dictionary already there.
+ Can be called from any thread.
+ */
++ (BOOL)writeCompletionsForVocabulary:(const CompletionVocabulary *)vocabulary toFile:(NSString *)path {
+	void *dictionary = NULL;
+	size_t dictionaryLength = 0;
+	if (!CompletionDictionaryCreate(vocabulary, 1, &dictionary, &dictionaryLength)) {
+		return NO;
+	}
+	DLog(@"Wrote %u completions (%u bytes) to %@", CompletionVocabularyTermCount(vocabulary), dictionaryLength, path);
+	
+	NSData *data = [[NSData alloc] initWithBytesNoCopy:dictionary length:dictionaryLength freeWhenDone:YES];
+	BOOL written = [data writeToFile:path atomically:YES];
+	[data release];
+	return written;
+}
+
+- (NSArray *)completionsForWordFragment:(NSString *)fragment maxCompletions:(NSUInteger)maxCompletions {
+	NSString *prefix = [fragment lowercaseString];
+	const char *prefixBytes = [prefix UTF8String];
+	if (prefixBytes == NULL || *prefixBytes == '\0') {
+		return [NSArray array];
+	}
+	
+	CompletionCandidate candidates[kMaxCompletions];
+	size_t count = CompletionDictionaryComplete([dictionaryData bytes], [dictionaryData length],
+												prefixBytes, strlen(prefixBytes),
+												candidates, MIN(maxCompletions, kMaxCompletions));
+	
+	NSMutableArray *completions = [NSMutableArray arrayWithCapacity:count];
+	for (size_t i=0; i<count; i++) {
+		NSString *completion = [[NSString alloc] initWithUTF8String:candidates[i].term];
+		if (completion) {
+			[completions addObject:completion];
+			[completion release];
+		}
+	}
+	return completions;
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithContentsOfFile:(NSString *)path {
+	NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:NULL];
+	if (!CompletionDictionaryIsValid([data bytes], [data length])) {
+		[self release];
+		return nil;
+	}
+	
+	if ((self = [super init])) {
+		dictionaryData = [data retain];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[dictionaryData release];
+	
+	[super dealloc];
+}
+
+@end
@@ -35,6 +35,15 @@ typedef enum {
 } SearchSortBy;
 
 
+@class SearchCompletions;
+@class SearchDatabaseUpdater;
+@class SearchNoteIndex;
+@class SearchResultCursor;
+@class SearchResultCache;
+@class SearchSession;
+@class SearchSpellCorrector;
+@class SearchThesaurus;
+
 @protocol SearchDatabaseRequesterDelegate;
 
 
@@ -42,6 +51,46 @@ typedef enum {
 	LSLocaytaSearchRequest				*currentSearchRequest;
 	NSString							*databasePath;
 	id<SearchDatabaseRequesterDelegate>	delegate;
+	SearchDatabaseUpdater				*searchDatabaseUpdater;
+	SearchThesaurus						*searchThesaurus;
+	
+@private
+	SearchResultCache					*resultCache;
+	SearchSession						*searchSession;
+	SearchSession						*correctionSession;		// runs the spell corrected query alongside
+	SearchSession						*pagingSession;			// loads later pages for the result cursors
+	SearchCompletions					*searchCompletions;		// loaded on first use
+	SearchSpellCorrector				*spellCorrector;		// loaded on first use
+	SearchNoteIndex						*noteIndex;				// loaded on first use
+	NSString							*currentResultCacheKey;
+	NSString							*currentTypedQueryString;
+	NSString							*currentCorrectedQueryString;
+	BOOL								currentQueryExpanded;	// with synonyms
+	NSArray								*currentSortOrder;
+	SearchSortBy						currentSortBy;
+	BOOL								currentOrderedByNoteIndex;	// the engine only matches, for the note index to order
+	NSUInteger							currentIndexGeneration;
+	
+	// Each search is numbered, so that results of superseded searches can be dropped
+	NSUInteger							searchSequence;
+	NSUInteger							exactSearchSequence;
+	NSUInteger							correctedSearchSequence;
+	
+	// Results of the two phases of the current search, until both are in
+	LSLocaytaSearchResult				*exactResult;
+	LSLocaytaSearchResult				*correctedResult;
+	NSString							*correctedResultCacheKey;
+	
+	// The last result delivered, which the next query may be able to refine
+	LSLocaytaSearchResult				*refinementBaseResult;
+	NSString							*refinementBaseQueryString;
+	NSString							*refinementBaseContext;
+	NSUInteger							refinementBaseIndexGeneration;
+	NSString							*deferredSearchText;
+	SearchSortBy						deferredSortBy;
+	
+	// The date the current search is restricted to, if any
+	NSDate								*filteredUpdatedSince;
 }
 
 @property (nonatomic, retain)	LSLocaytaSearchQuery				*currentSearchQuery;
@@ -49,14 +98,25 @@ typedef enum {
 @property (nonatomic, retain)	LSLocaytaSearchRequest				*currentSearchRequest;
 @property (nonatomic, copy)		NSString							*databasePath;
 @property (nonatomic, assign)	id<SearchDatabaseRequesterDelegate>	delegate;
+@property (nonatomic, assign)	SearchDatabaseUpdater				*searchDatabaseUpdater;		// provides the index generation for result caching
+@property (nonatomic, assign)	SearchThesaurus						*searchThesaurus;			// synonyms queries are expanded with
 
 - (id)initWithDatabasePath:(NSString *)aDatabasePath;
 - (void)searchWithText:(NSString *)searchText sortBy:(SearchSortBy)sortBy;
+
+// Only finds notes updated since the date: the engine matches, and the note index restricts the matches to the date
+- (void)searchWithText:(NSString *)searchText sortBy:(SearchSortBy)sortBy updatedSince:(NSDate *)updatedSince;
 - (void)cancel;
+// Counts of the notes a delivered search matched for each facet value, as {facet: {value: count}}, or nil if the note
+// index can't answer (as for a relevance search the engine only returned the first page of).  For a facet UI to show
+// alongside the results; nothing calls it yet
+- (NSDictionary *)facetCountsForResultCursor:(SearchResultCursor *)resultCursor;
+- (NSArray *)completionsForWordFragment:(NSString *)fragment maxCompletions:(NSUInteger)maxCompletions;
 
 @end
 
 
 @protocol SearchDatabaseRequesterDelegate
-- (void)searchCompleteWithResult:(LSLocaytaSearchResult *)searchResult;
+// Called with the exact result, then again with a spell corrected one if the exact result is weak and that finds more
+- (void)searchCompleteWithResultCursor:(SearchResultCursor *)resultCursor;
 @end
@@ -28,6 +28,42 @@
 #import "SearchDatabaseRequester.h"
 
 #import "AppDelegate_Shared.h"
+#import "LocalSearchResult.h"
+#import "NoteSearchSchema.h"
+#import "RefinedSearchResult.h"
+#import "RewrittenSearchResult.h"
+#import "SearchCompletions.h"
+#import "SearchDatabaseUpdater.h"
+#import "SearchNoteIndex.h"
+#import "SearchResultCache.h"
+#import "SearchResultCursor.h"
+#import "SearchSession.h"
+#import "SearchSpellCorrector.h"
+#import "SearchThesaurus.h"
+
+#define kDocsPerPage			20
+#define kResultCacheCapacity	32
+#define kRefinementSettleDelay	0.4		// seconds after the last refined result before searching the index
+#define kWeakResultMatchCount	3		// exact results with fewer matches give way to corrected results with more
+
+
+@interface SearchDatabaseRequester ()
+@property (nonatomic, copy)		NSString				*currentResultCacheKey;
+@property (nonatomic, copy)		NSString				*currentTypedQueryString;
+@property (nonatomic, copy)		NSString				*currentCorrectedQueryString;
+@property (nonatomic, retain)	NSArray					*currentSortOrder;
+@property (nonatomic, retain)	LSLocaytaSearchResult	*exactResult;
+@property (nonatomic, retain)	LSLocaytaSearchResult	*correctedResult;
+@property (nonatomic, copy)		NSString				*correctedResultCacheKey;
+@property (nonatomic, retain)	LSLocaytaSearchResult	*refinementBaseResult;
+@property (nonatomic, copy)		NSString				*refinementBaseQueryString;
+@property (nonatomic, copy)		NSString				*refinementBaseContext;
+@property (nonatomic, copy)		NSString				*deferredSearchText;
+@property (nonatomic, retain)	NSDate					*filteredUpdatedSince;
+- (void)searchWithText:(NSString *)searchText sortBy:(SearchSortBy)sortBy allowProvisionalResult:(BOOL)allowProvisionalResult;
+- (void)startExactSearchWithQueryString:(NSString *)queryString sortOrder:(NSArray *)sortOrder docsPerPage:(NSInteger)docsPerPage;
+@end
+
 
 @implementation SearchDatabaseRequester
 
@@ -35,9 +71,87 @@
 @synthesize currentSearchRequest;
 @synthesize databasePath;
 @synthesize delegate;
+@synthesize searchDatabaseUpdater;
+@synthesize searchThesaurus;
+@synthesize currentResultCacheKey;
+@synthesize currentTypedQueryString;
+@synthesize currentCorrectedQueryString;
+@synthesize currentSortOrder;
+@synthesize exactResult;
+@synthesize correctedResult;
+@synthesize correctedResultCacheKey;
+@synthesize refinementBaseResult;
+@synthesize refinementBaseQueryString;
+@synthesize refinementBaseContext;
+@synthesize deferredSearchText;
+@synthesize filteredUpdatedSince;
+
+- (void)setRefinementBaseResult:(LSLocaytaSearchResult *)searchResult queryString:(NSString *)queryString context:(NSString *)context indexGeneration:(NSUInteger)indexGeneration {
+	self.refinementBaseResult = searchResult;
+	self.refinementBaseQueryString = queryString;
+	self.refinementBaseContext = context;
+	refinementBaseIndexGeneration = indexGeneration;
+}
+
+/**
+ Hands the delegate a cursor over all the results, starting from the first page in searchResult.
+ */
+- (void)deliverResult:(LSLocaytaSearchResult *)searchResult sortOrder:(NSArray *)sortOrder {
+	SearchResultCursor *resultCursor = [[SearchResultCursor alloc] initWithSearchSession:pagingSession
+																		 indexGeneration:self.searchDatabaseUpdater.indexGeneration
+																			searchResult:searchResult
+																			   sortOrder:sortOrder
+																				pageSize:kDocsPerPage];
+	[delegate searchCompleteWithResultCursor:resultCursor];
+	[resultCursor release];
+}
+
+- (void)performDeferredSearch {
+	[self searchWithText:self.deferredSearchText sortBy:deferredSortBy allowProvisionalResult:NO];
+}
+
+/**
+ Provisional results approximate the index's matching, so are confirmed with a real search once typing pauses.
+ */
+- (void)scheduleDeferredSearchWithText:(NSString *)searchText sortBy:(SearchSortBy)sortBy {
+	self.deferredSearchText = searchText;
+	deferredSortBy = sortBy;
+	[self performSelector:@selector(performDeferredSearch) withObject:nil afterDelay:kRefinementSettleDelay];
+}
+
+static NoteIndexOrder NoteIndexOrderForSortBy(SearchSortBy sortBy) {
+	return (sortBy == SearchSortByTitle ? NoteIndexOrderTitleAscending : NoteIndexOrderNewestFirst);
+}
+
+- (NSArray *)sortOrderForSortBy:(SearchSortBy)sortBy {
+	NSArray *sortOrderArray = nil;		// default to sort by relevance
+	if (sortBy == SearchSortByTitle) {
+		// Sort by title field (textslot) ascending
+		sortOrderArray = NoteSearchSortOrderForField(NoteSearchFieldTitle, YES);
+	}
+	else if (sortBy == SearchSortByDate) {
+		// Sort by lastUpdated field (numericslot) descending
+		sortOrderArray = NoteSearchSortOrderForField(NoteSearchFieldLastUpdated, NO);
+	}
+	return sortOrderArray;
+}
 
 - (void)searchWithText:(NSString *)searchText sortBy:(SearchSortBy)sortBy {
-	DLog(@"searchText: \"%@\"  sortBy:%d", searchText, sortBy);
+	[self searchWithText:searchText sortBy:sortBy allowProvisionalResult:YES];
+}
+
+/**
+ The search engine can't restrict a search to a range of dates, so these searches have it find the whole match set,
+ and keep the matches updated since the date.  A current note index, where those notes are a single range, keeps them
+ by where they are in it and orders title and date searches; otherwise the engine orders the matches and each one's
+ stored date is checked.  Either way the engine decides what matches, as for any other search.
+ */
+- (void)searchWithText:(NSString *)searchText sortBy:(SearchSortBy)sortBy updatedSince:(NSDate *)updatedSince {
+	if (nil == updatedSince) {
+		[self searchWithText:searchText sortBy:sortBy];
+		return;
+	}
+	DLog(@"searchText: \"%@\"  sortBy:%d  updatedSince:%@", searchText, sortBy, updatedSince);
 	
 	[self cancel];
 	
@@ -46,60 +160,366 @@
 		return;
 	}
 	
-	LSLocaytaSearchRequest *searchRequest = [[LSLocaytaSearchRequest alloc] initWithDatabasePath:self.databasePath
-																						delegate:self];
-	self.currentSearchRequest = searchRequest;
-	[searchRequest release];
+	NSString *expandedQueryString = [self.searchThesaurus expandedQueryString:trimmed];
+	
+	self.currentTypedQueryString = trimmed;
+	self.currentSortOrder = [self sortOrderForSortBy:sortBy];
+	currentSortBy = sortBy;
+	currentQueryExpanded = (expandedQueryString != nil);
+	currentIndexGeneration = self.searchDatabaseUpdater.indexGeneration;
+	self.filteredUpdatedSince = updatedSince;
+	
+	currentOrderedByNoteIndex = (self.searchDatabaseUpdater.noteIndexIsCurrent && [self noteIndex]);
+	[self startExactSearchWithQueryString:(expandedQueryString ? expandedQueryString : trimmed)
+								sortOrder:(currentOrderedByNoteIndex ? nil : self.currentSortOrder)
+							  docsPerPage:MAX((NSInteger)[self noteIndex].noteCount, kDocsPerPage)];
+}
 
-	// Set the sort order
-	NSArray *sortOrderArray = nil;		// default to sort by relevance
-	if (sortBy == SearchSortByTitle) {
-		// Sort by title field (textslot=1) ascending
-		sortOrderArray = [NSArray arrayWithObject:@"+1"];
+- (void)searchWithText:(NSString *)searchText sortBy:(SearchSortBy)sortBy allowProvisionalResult:(BOOL)allowProvisionalResult {
+	DLog(@"searchText: \"%@\"  sortBy:%d", searchText, sortBy);
+	
+	[self cancel];
+	
+	NSString *trimmed = [searchText stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+	if ([trimmed length] == 0) {
+		return;
 	}
-	else if (sortBy == SearchSortByDate) {
-		// Sort by lastUpdated field (numericslot=2) descending
-		sortOrderArray = [NSArray arrayWithObject:@"-2"];
+	
+	NSArray *sortOrderArray = [self sortOrderForSortBy:sortBy];
+	
+	// Correctly spelt queries, the usual case, have no corrected query and so only run the exact search
+	NSString *correctedQueryString = nil;
+	if ([[AppDelegate_Shared sharedAppDelegate] enableAutoSpellCorrection]) {
+		correctedQueryString = [self spellCorrectedQueryString:trimmed searchText:searchText];
 	}
-	self.currentSearchRequest.sortOrder = sortOrderArray;
 	
-	BOOL enableAutoSpellCorrection = [[AppDelegate_Shared sharedAppDelegate] enableAutoSpellCorrection];
-	if (enableAutoSpellCorrection) {
-		[self.currentSearchRequest setSpellCorrectionMethod:LSLocaytaSearchRequestSpellCorrectionMethodAuto];
+	// Synonyms are expanded here, from the thesaurus's compiled map, rather than by the engine
+	NSString *expandedQueryString = [self.searchThesaurus expandedQueryString:trimmed];
+	
+	NSInteger topDocIndex = 0;
+	NSInteger docsPerPage = kDocsPerPage;
+	NSUInteger indexGeneration = self.searchDatabaseUpdater.indexGeneration;
+	
+	self.currentTypedQueryString = trimmed;
+	self.currentCorrectedQueryString = correctedQueryString;
+	self.currentSortOrder = sortOrderArray;
+	currentSortBy = sortBy;
+	currentQueryExpanded = (expandedQueryString != nil);
+	currentIndexGeneration = indexGeneration;
+	
+	// The corrected search runs alongside the exact one, and its result is only shown if the exact result is weak
+	if (correctedQueryString) {
+		self.correctedResultCacheKey = [SearchResultCache keyForQueryString:trimmed sortOrder:sortOrderArray
+													  spellCorrectionMethod:LSLocaytaSearchRequestSpellCorrectionMethodAuto
+																topDocIndex:topDocIndex docsPerPage:docsPerPage];
+		LSLocaytaSearchResult *cachedResult = [resultCache resultForKey:self.correctedResultCacheKey generation:indexGeneration];
+		if (cachedResult) {
+			self.correctedResult = cachedResult;
+		}
+		else {
+			NSString *expandedCorrectedQueryString = [self.searchThesaurus expandedQueryString:correctedQueryString];
+			correctedSearchSequence = searchSequence;
+			[correctionSession searchWithQueryString:(expandedCorrectedQueryString ? expandedCorrectedQueryString : correctedQueryString)
+										   sortOrder:sortOrderArray
+							   spellCorrectionMethod:LSLocaytaSearchRequestSpellCorrectionMethodNone
+										 topDocIndex:topDocIndex
+										 docsPerPage:docsPerPage
+									 indexGeneration:indexGeneration];
+		}
+	}
+	
+	// Backspacing, and switching scopes back and forth, repeat recent searches - answer those from memory
+	NSString *resultCacheKey = [SearchResultCache keyForQueryString:trimmed sortOrder:sortOrderArray
+											  spellCorrectionMethod:LSLocaytaSearchRequestSpellCorrectionMethodNone
+														topDocIndex:topDocIndex docsPerPage:docsPerPage];
+	LSLocaytaSearchResult *cachedResult = [resultCache resultForKey:resultCacheKey generation:indexGeneration];
+	NSString *context = [SearchResultCache keyForQueryString:@"" sortOrder:sortOrderArray
+									   spellCorrectionMethod:LSLocaytaSearchRequestSpellCorrectionMethodNone
+												 topDocIndex:topDocIndex docsPerPage:docsPerPage];
+	if (cachedResult) {
+		DLog(@"Cached result for \"%@\" (%u hits, %u misses)", resultCacheKey, resultCache.hitCount, resultCache.missCount);
+		[self setRefinementBaseResult:(currentQueryExpanded ? nil : cachedResult) queryString:trimmed context:context indexGeneration:indexGeneration];
+		[self deliverExactResult:cachedResult];
+		return;
+	}
+	
+	// While the query keeps growing, narrow down the last result instead of searching the whole index (refinement only
+	// matches the words typed, not their synonyms); notes' bodies are checked in the note index's postings
+	if (allowProvisionalResult && !currentQueryExpanded && refinementBaseIndexGeneration == indexGeneration &&
+		[context isEqualToString:self.refinementBaseContext] && self.searchDatabaseUpdater.noteIndexIsCurrent) {
+		SearchNoteIndex *currentNoteIndex = [self noteIndex];
+		RefinedSearchResult *refinedResult = [RefinedSearchResult resultByRefiningResult:self.refinementBaseResult
+																		 fromQueryString:self.refinementBaseQueryString
+																		   toQueryString:trimmed
+																		  contentMatcher:^(NSString *noteID, NSArray *terms) {
+																			  return [currentNoteIndex noteWithID:noteID matchesTerms:terms];
+																		  }];
+		if (refinedResult) {
+			DLog(@"Refined %d results for \"%@\" to %d for \"%@\"", self.refinementBaseResult.itemCount, self.refinementBaseQueryString,
+				 refinedResult.itemCount, trimmed);
+			[self setRefinementBaseResult:refinedResult queryString:trimmed context:context indexGeneration:indexGeneration];
+			[self deliverExactResult:refinedResult];
+			[self scheduleDeferredSearchWithText:trimmed sortBy:sortBy];
+			return;
+		}
+	}
+	
+	self.currentResultCacheKey = resultCacheKey;
+	
+	// In title and date order the engine only matches: a current note index orders the whole match set with a bounded
+	// heap over its sort values, rather than the engine sorting it for the first page
+	currentOrderedByNoteIndex = (sortBy != SearchSortByRelevancy && self.searchDatabaseUpdater.noteIndexIsCurrent && [self noteIndex]);
+	if (currentOrderedByNoteIndex) {
+		[self startExactSearchWithQueryString:(expandedQueryString ? expandedQueryString : trimmed) sortOrder:nil
+								  docsPerPage:MAX((NSInteger)[self noteIndex].noteCount, docsPerPage)];
 	}
 	else {
-		[self.currentSearchRequest setSpellCorrectionMethod:LSLocaytaSearchRequestSpellCorrectionMethodNone];
+		[self startExactSearchWithQueryString:(expandedQueryString ? expandedQueryString : trimmed) sortOrder:sortOrderArray
+								  docsPerPage:docsPerPage];
 	}
+}
 
-    LSLocaytaSearchQuery *searchQuery = [LSLocaytaSearchQuery queryWithQueryString:trimmed];
-    searchQuery.defaultOperator = LSLocaytaSearchQueryOperatorAnd;
-
-	self.currentSearchQuery = searchQuery;
+- (void)startExactSearchWithQueryString:(NSString *)queryString sortOrder:(NSArray *)sortOrder docsPerPage:(NSInteger)docsPerPage {
+	exactSearchSequence = searchSequence;
 	
-	NSInteger docsPerPage = 20;
-	[self.currentSearchRequest searchWithQuery:searchQuery topDocIndex:0 docsPerPage:docsPerPage];
+	// Searches share one warm session, reopened when the search database changes
+	[searchSession searchWithQueryString:queryString
+							   sortOrder:sortOrder
+				   spellCorrectionMethod:LSLocaytaSearchRequestSpellCorrectionMethodNone
+							 topDocIndex:0
+							 docsPerPage:docsPerPage
+						 indexGeneration:currentIndexGeneration];
+	self.currentSearchRequest = searchSession.searchRequest;
+	self.currentSearchQuery = searchSession.searchQuery;
 }
 
 - (void)cancel {
-	if (self.currentSearchRequest) {
-		[self.currentSearchRequest cancel];
-		self.currentSearchRequest = nil;
-		self.currentSearchQuery = nil;
+	[NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(performDeferredSearch) object:nil];
+	
+	// Anything still running for the superseded search is ignored when it completes
+	searchSequence++;
+	[searchSession cancel];
+	[correctionSession cancel];
+	
+	self.currentSearchRequest = nil;
+	self.currentSearchQuery = nil;
+	self.currentResultCacheKey = nil;
+	self.currentTypedQueryString = nil;
+	self.currentCorrectedQueryString = nil;
+	self.currentSortOrder = nil;
+	currentOrderedByNoteIndex = NO;
+	self.exactResult = nil;
+	self.correctedResult = nil;
+	self.correctedResultCacheKey = nil;
+	self.filteredUpdatedSince = nil;
+}
+
+
+#pragma mark -
+#pragma mark Two phase delivery
+
+/**
+ Shows the exact result straight away, then the corrected result if that has already arrived.
+ */
+- (void)deliverExactResult:(LSLocaytaSearchResult *)searchResult {
+	self.exactResult = searchResult;
+	[self deliverResult:searchResult sortOrder:self.currentSortOrder];
+	[self deliverCorrectedResultIfBetter];
+}
+
+/**
+ Once both phases are in, replaces a weak exact result with the corrected one, if that finds more.
+ */
+- (void)deliverCorrectedResultIfBetter {
+	if (nil == self.exactResult || nil == self.correctedResult) {
+		return;
+	}
+	
+	if (self.exactResult.matchCount < kWeakResultMatchCount && self.correctedResult.matchCount > self.exactResult.matchCount) {
+		DLog(@"Corrected \"%@\" to \"%@\" (%d matches, not %d)", self.correctedResult.requestedQueryString,
+			 self.correctedResult.correctedQueryString, self.correctedResult.matchCount, self.exactResult.matchCount);
+		[self deliverResult:self.correctedResult sortOrder:self.currentSortOrder];
+	}
+	self.exactResult = nil;
+	self.correctedResult = nil;
+}
+
+
+#pragma mark -
+#pragma mark Completions
+
+/**
+ Returns the most common words starting with fragment, for completing the word being typed.  Until the completion
+ dictionary has been built, the search engine's own suggestions are used instead.
+ */
+- (NSArray *)completionsForWordFragment:(NSString *)fragment maxCompletions:(NSUInteger)maxCompletions {
+	if (nil == searchCompletions) {
+		searchCompletions = [[SearchCompletions alloc] initWithContentsOfFile:[self.databasePath stringByAppendingPathComponent:kSearchCompletionsFilename]];
+	}
+	if (searchCompletions) {
+		return [searchCompletions completionsForWordFragment:fragment maxCompletions:maxCompletions];
+	}
+	return [searchSession.searchRequest suggestionsForWordFragment:fragment maxSuggestions:(int)maxCompletions];
+}
+
+- (void)searchVocabularyDidChange:(NSNotification *)notification {
+	// Mapped again on next use
+	[searchCompletions release];
+	searchCompletions = nil;
+	[spellCorrector release];
+	spellCorrector = nil;
+	[noteIndex release];
+	noteIndex = nil;
+}
+
+
+- (void)searchThesaurusDidChange:(NSNotification *)notification {
+	// Cached results were expanded with the old synonyms
+	[resultCache removeAllResults];
+	[self setRefinementBaseResult:nil queryString:nil context:nil indexGeneration:0];
+}
+
+
+#pragma mark -
+#pragma mark Note index
+
+// Mapped on first use, or nil until the note index has been built
+- (SearchNoteIndex *)noteIndex {
+	if (nil == noteIndex) {
+		noteIndex = [[SearchNoteIndex alloc] initWithContentsOfFile:[self.databasePath stringByAppendingPathComponent:kSearchNoteIndexFilename]];
+	}
+	return noteIndex;
+}
+
+/**
+ Restricts an engine search's whole match set to the notes updated since the filter's date, if any, through the note
+ index, and orders it as the sort asks: relevance in the engine's order, title and date through the index.  Returns
+ nil if the index doesn't have every match.
+ */
+- (LocalSearchResult *)noteIndexResultForSearchResult:(LSLocaytaSearchResult *)searchResult {
+	if (currentSortBy == SearchSortByRelevancy) {
+		return [[self noteIndex] resultForSearchResult:searchResult queryString:self.currentTypedQueryString
+										  updatedSince:self.filteredUpdatedSince];
+	}
+	return [[self noteIndex] pagedResultForSearchResult:searchResult queryString:self.currentTypedQueryString
+												  order:NoteIndexOrderForSortBy(currentSortBy)
+										   updatedSince:self.filteredUpdatedSince pageSize:kDocsPerPage];
+}
+
+/**
+ Keeps the matches of an engine search's whole match set whose stored lastUpdated is no earlier than the filter's date,
+ in the engine's order, for when the note index can't be relied on.
+ */
+- (LocalSearchResult *)resultByCheckingDatesOfResult:(LSLocaytaSearchResult *)searchResult {
+	NSTimeInterval earliest = [self.filteredUpdatedSince timeIntervalSinceReferenceDate];
+	NSMutableArray *results = [NSMutableArray arrayWithCapacity:searchResult.itemCount];
+	for (NSDictionary *result in searchResult.results) {
+		NSNumber *lastUpdated = [[[result valueForKey:@"fields"] valueForKey:NoteSearchFieldName(NoteSearchFieldLastUpdated)] lastObject];
+		if ([lastUpdated doubleValue] >= earliest) {
+			[results addObject:result];
+		}
+	}
+	return [LocalSearchResult resultWithQueryString:self.currentTypedQueryString queryTerms:searchResult.queryTerms results:results
+										 matchCount:[results count] matchCountExact:YES];
+}
+
+/**
+ Counts facet values over the displayed search's matches: a paged result's from the note index it was paged from,
+ otherwise the engine's (or a date restricted) match set if the result holds all of it and the index is current.
+ */
+- (NSDictionary *)facetCountsForResultCursor:(SearchResultCursor *)resultCursor {
+	LSLocaytaSearchResult *searchResult = resultCursor.searchResult;
+	if ([searchResult isKindOfClass:[LocalSearchResult class]] && ((LocalSearchResult *)searchResult).isPaged) {
+		return [(LocalSearchResult *)searchResult facetCounts];
+	}
+	if (!self.searchDatabaseUpdater.noteIndexIsCurrent) {
+		return nil;
+	}
+	return [[self noteIndex] facetCountsForSearchResult:searchResult];
+}
+
+
+#pragma mark -
+#pragma mark Spelling correction
+
+/**
+ Returns queryString with its misspelt words corrected, or nil if none were.  The last word is left alone while it's
+ still being typed (searchText doesn't end in a space) and could be the start of a known word.
+ */
+- (NSString *)spellCorrectedQueryString:(NSString *)queryString searchText:(NSString *)searchText {
+	if (nil == spellCorrector) {
+		spellCorrector = [[SearchSpellCorrector alloc] initWithContentsOfFile:[self.databasePath stringByAppendingPathComponent:kSearchSpellingFilename]];
+		if (nil == spellCorrector) {
+			return nil;
+		}
+	}
+	
+	BOOL correctLastWord = YES;
+	NSRange lastSpaceRange = [searchText rangeOfCharacterFromSet:[NSCharacterSet whitespaceCharacterSet] options:NSBackwardsSearch];
+	if (NSMaxRange(lastSpaceRange) != [searchText length]) {
+		NSString *lastWord = (lastSpaceRange.location == NSNotFound ? searchText : [searchText substringFromIndex:NSMaxRange(lastSpaceRange)]);
+		correctLastWord = ([[self completionsForWordFragment:lastWord maxCompletions:1] count] == 0);
+	}
+	
+	NSString *correctedQueryString = [spellCorrector correctedQueryString:queryString correctingLastWord:correctLastWord];
+	if (correctedQueryString) {
+		DLog(@"Spelling of \"%@\" corrects to \"%@\"", queryString, correctedQueryString);
 	}
+	return correctedQueryString;
 }
 
+
+#pragma mark -
+#pragma mark Object lifecycle
+
 - (id)initWithDatabasePath:(NSString *)aDatabasePath {
     if ((self = [super init])) {
 		self.databasePath = aDatabasePath;
 		
+		resultCache = [[SearchResultCache alloc] initWithCapacity:kResultCacheCapacity];
+		searchSession = [[SearchSession alloc] initWithDatabasePath:aDatabasePath];
+		searchSession.delegate = self;
+		correctionSession = [[SearchSession alloc] initWithDatabasePath:aDatabasePath];
+		correctionSession.delegate = self;
+		pagingSession = [[SearchSession alloc] initWithDatabasePath:aDatabasePath];
+		
+		[[NSNotificationCenter defaultCenter] addObserver:self
+												 selector:@selector(searchVocabularyDidChange:)
+													 name:kSearchVocabularyDidChangeNotification
+												   object:nil];
+		[[NSNotificationCenter defaultCenter] addObserver:self
+												 selector:@selector(searchThesaurusDidChange:)
+													 name:kSearchThesaurusDidChangeNotification
+												   object:nil];
 	}
 	return self;
 }
 
 - (void)dealloc {
+	[[NSNotificationCenter defaultCenter] removeObserver:self];
+	
 	[currentSearchQuery release];
 	[currentSearchRequest release];
 	[databasePath release];
+	[resultCache release];
+	[searchSession release];
+	[correctionSession release];
+	[pagingSession release];
+	[searchCompletions release];
+	[spellCorrector release];
+	[noteIndex release];
+	[currentResultCacheKey release];
+	[currentTypedQueryString release];
+	[currentCorrectedQueryString release];
+	[currentSortOrder release];
+	[exactResult release];
+	[correctedResult release];
+	[correctedResultCacheKey release];
+	[refinementBaseResult release];
+	[refinementBaseQueryString release];
+	[refinementBaseContext release];
+	[deferredSearchText release];
+	[filteredUpdatedSince release];
 	
 	[super dealloc];
 }
@@ -113,22 +533,88 @@
 	
 	DLog(@" * documentCount: %lld", [searchRequest documentCount]);
 	DLog(@" * requestedQueryString: \"%@\"", searchResult.requestedQueryString);
-	DLog(@" * wasAutoSpellCorrected: \"%@\"", (searchResult.wasAutoSpellCorrected ? @"YES" : @"NO"));
-	DLog(@" * correctedQueryString: \"%@\"", searchResult.correctedQueryString);
-	DLog(@" * suggestedQueryString: \"%@\"", searchResult.suggestedQueryString);
 	DLog(@" * itemCount: %d", searchResult.itemCount);
 	DLog(@" * matchCount (exact=%@): %d", (searchResult.matchCountExact ? @"YES" : @"NO"), searchResult.matchCount);
 	DLog(@" * results: %@", searchResult.results);
 	
-	DLog(@"documents searchQuery: %@", [self.currentSearchQuery queryDescription]);
-	
-	[delegate searchCompleteWithResult:searchResult];
+	if (searchRequest == correctionSession.searchRequest && correctedSearchSequence == searchSequence) {
+		// Report the corrected search as the engine's own correction would have been
+		RewrittenSearchResult *correctedSearchResult = [RewrittenSearchResult resultWithRewrittenResult:searchResult
+																					 typedQueryString:self.currentTypedQueryString
+																			spellCorrectedQueryString:self.currentCorrectedQueryString];
+		[resultCache setResult:correctedSearchResult forKey:self.correctedResultCacheKey generation:currentIndexGeneration];
+		self.correctedResult = correctedSearchResult;
+		[self deliverCorrectedResultIfBetter];
+	}
+	else if (searchRequest == searchSession.searchRequest && exactSearchSequence == searchSequence) {
+		DLog(@"documents searchQuery: %@", [self.currentSearchQuery queryDescription]);
+		
+		NSString *context = [SearchResultCache keyForQueryString:@"" sortOrder:self.currentSortOrder
+										   spellCorrectionMethod:LSLocaytaSearchRequestSpellCorrectionMethodNone
+													 topDocIndex:0 docsPerPage:kDocsPerPage];
+		
+		// Searches of the whole match set go on until they have it all
+		if ((currentOrderedByNoteIndex || self.filteredUpdatedSince) && searchResult.itemCount < searchResult.matchCount) {
+			[self startExactSearchWithQueryString:searchResult.requestedQueryString sortOrder:searchRequest.sortOrder
+									  docsPerPage:MAX(searchResult.matchCount, 2 * searchResult.itemCount)];
+			return;
+		}
+		
+		if (currentOrderedByNoteIndex) {
+			LocalSearchResult *orderedResult = [self noteIndexResultForSearchResult:searchResult];
+			if (nil == orderedResult) {
+				// The note index has fallen behind the engine, which must sort the matches itself after all
+				DLog(@"Note index can't order %d matches for \"%@\"", searchResult.matchCount, searchResult.requestedQueryString);
+				currentOrderedByNoteIndex = NO;
+				[self startExactSearchWithQueryString:searchResult.requestedQueryString sortOrder:self.currentSortOrder
+										  docsPerPage:(self.filteredUpdatedSince ? MAX(searchResult.matchCount, kDocsPerPage) : kDocsPerPage)];
+				return;
+			}
+			searchResult = orderedResult;
+		}
+		else if (self.filteredUpdatedSince) {
+			searchResult = [self resultByCheckingDatesOfResult:searchResult];
+		}
+		
+		if (self.filteredUpdatedSince) {
+			// Later searches aren't restricted to the date, so can't refine it
+			[self setRefinementBaseResult:nil queryString:nil context:nil indexGeneration:currentIndexGeneration];
+		}
+		else if (currentQueryExpanded) {
+			if (![searchResult isKindOfClass:[LocalSearchResult class]]) {
+				searchResult = [RewrittenSearchResult resultWithRewrittenResult:searchResult
+															   typedQueryString:self.currentTypedQueryString
+													  spellCorrectedQueryString:nil];
+			}
+			[self setRefinementBaseResult:nil queryString:nil context:nil indexGeneration:currentIndexGeneration];
+		}
+		else {
+			[self setRefinementBaseResult:searchResult queryString:searchResult.requestedQueryString context:context indexGeneration:currentIndexGeneration];
+		}
+		if (self.currentResultCacheKey) {
+			[resultCache setResult:searchResult forKey:self.currentResultCacheKey generation:currentIndexGeneration];
+		}
+		
+		self.currentSearchRequest = nil;
+		[self deliverExactResult:searchResult];
+	}
+	else {
+		DLog(@"Dropped result of superseded search for \"%@\"", searchResult.requestedQueryString);
+	}
 }
 
 - (void)locaytaSearchRequest:(LSLocaytaSearchRequest *)searchRequest didFailWithError:(NSError *)error {
 	DLog(@"error: %@", error);
 	
-	[delegate searchCompleteWithResult:nil];
+	if (searchRequest == correctionSession.searchRequest && correctedSearchSequence == searchSequence) {
+		// The exact result stands
+		self.correctedResultCacheKey = nil;
+		correctedSearchSequence = 0;
+	}
+	else if (searchRequest == searchSession.searchRequest && exactSearchSequence == searchSequence) {
+		[self cancel];
+		[delegate searchCompleteWithResultCursor:nil];
+	}
 }
 
 @end
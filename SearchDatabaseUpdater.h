@@ -30,24 +30,65 @@
 #import <Foundation/Foundation.h>
 
 #define kSearchDatabaseDidUpdateNotification @"kSearchDatabaseDidUpdateNotification"
+#define kSearchVocabularyDidChangeNotification @"kSearchVocabularyDidChangeNotification"
 
 
 @class LSLocaytaSearchIndexer;
 @class Note;
+@class NoteDocumentStore;
+@class XHTMLExtractedText;
 
 
 @interface SearchDatabaseUpdater : NSObject <LSLocaytaSearchIndexerDelegate> {
 	NSString				*databasePath;
 	LSLocaytaSearchIndexer	*notesSearchIndexer;
 	NSDictionary			*notesSearchSchema;
+	NoteDocumentStore		*noteDocumentStore;
+	
+@private
+	NSMutableDictionary		*noteFingerprints;
+	NSUInteger				indexGeneration;
+	NSUInteger				noteIndexGeneration;	// the index generation the note index was built at
+	NSMutableDictionary		*changedNotes;			// note ID => search values (NSNull if deleted) not yet in the note index
+	BOOL					noteIndexNeedsRebuild;	// notes have changed without being recorded, so it can't be patched
+	dispatch_queue_t		vocabularyQueue;		// writes the vocabulary and note index, one update at a time
+	uint64_t				spellingWordSetHash;	// of the words in the spelling dictionary; only used on vocabularyQueue
+	NSUInteger				reindexCount;
+	NSUInteger				skippedReindexCount;
 }
 
 @property (nonatomic, retain)	NSString				*databasePath;
 @property (nonatomic, retain)	LSLocaytaSearchIndexer	*notesSearchIndexer;
 @property (nonatomic, retain)	NSDictionary			*notesSearchSchema;
+@property (nonatomic, retain)	NoteDocumentStore		*noteDocumentStore;
 
+// Notes are only reindexed when their title or content have changed since they were last indexed, even across launches
+@property (nonatomic, readonly)	NSUInteger				reindexCount;
+@property (nonatomic, readonly)	NSUInteger				skippedReindexCount;
+
+// Incremented (on the main thread) every time the search database has been updated
+@property (nonatomic, readonly)	NSUInteger				indexGeneration;
+
+// Whether the note index was built from the notes as they are now
+@property (nonatomic, readonly)	BOOL					noteIndexIsCurrent;
+
+// The note index, which is patched with each note saved rather than rebuilt (bulk imports are indexed in full, once
+// they've finished), and the completion and spelling dictionaries, built from the words it holds
+- (NSString *)completionsPath;
+- (NSString *)spellingPath;
+- (NSString *)noteIndexPath;
+- (BOOL)checkNoteIndex;
+- (void)scheduleVocabularyRebuild;
+// Rebuilds them now, calling the completion block on the main thread once they've been written
+- (void)rebuildVocabularyWithCompletion:(void (^)(BOOL noteIndexWritten))completion;
 - (void)deleteNoteWithID:(NSString *)noteID;
 - (void)updateSearchDatabaseForNote:(Note *)note;
+- (void)updateSearchDatabaseForNotes:(NSArray *)notes;
+// For bulk imports, whose notes go into the note index when it is next rebuilt
+- (void)updateSearchDatabaseForNotes:(NSArray *)notes extractedTexts:(NSArray *)extractedTexts;
+// The fingerprints are written a few seconds after the last update; this writes them now, and waits for the write, so
+// the search database directory can be copied with them
+- (void)writeNoteFingerprintsNow;
 - (id)initWithDatabasePath:(NSString *)aDatabasePath;
 
 @end
@@ -30,15 +30,55 @@
 #import "SearchDatabaseUpdater.h"
 #import "AppDelegate_Shared.h"
 #import "Note.h"
+#import "Note+Management.h"
+#import "NoteSearchSchema.h"
+#import "NoteDocumentStore.h"
+#import "SearchCompletions.h"
+#import "SearchNoteIndex.h"
+#import "SearchSpellCorrector.h"
+#import "XHTMLExtractedText.h"
 
 #define SCHEMA_PLIST_FILENAME @"notes_search_schema.plist"
 
+#define kVocabularyRebuildDelay		3.0		// seconds without an update before the vocabulary is rebuilt
+#define kFingerprintsWriteDelay		3.0		// seconds without an update before the fingerprints are written
+#define kNoteFingerprintsFilename	@"fingerprints.plist"
+
+
+/*
+ * What was last indexed for a note: a hash of each text field.  lastUpdated only changes along with them (see
+ * -[Note saveNote]), so it isn't part of it.
+ */
+typedef struct {
+	uint64_t		titleHash;
+	uint64_t		contentHash;
+} NoteFingerprint;
+
+// 64-bit FNV-1a over the string's UTF-16 characters
+static uint64_t FingerprintHashString(NSString *string) {
+	uint64_t hash = 14695981039346656037ULL;
+	CFStringRef cfString = (CFStringRef)string;
+	CFIndex length = (string ? CFStringGetLength(cfString) : 0);
+	CFStringInlineBuffer buffer;
+	CFStringInitInlineBuffer(cfString, &buffer, CFRangeMake(0, length));
+	for (CFIndex i=0; i<length; i++) {
+		UniChar c = CFStringGetCharacterFromInlineBuffer(&buffer, i);
+		hash = (hash ^ (c & 0xff)) * 1099511628211ULL;
+		hash = (hash ^ (c >> 8)) * 1099511628211ULL;
+	}
+	return hash;
+}
+
 
 @implementation SearchDatabaseUpdater
 
 @synthesize databasePath;
 @synthesize notesSearchIndexer;
 @synthesize notesSearchSchema;
+@synthesize noteDocumentStore;
+@synthesize reindexCount;
+@synthesize skippedReindexCount;
+@synthesize indexGeneration;
 
 + (NSString *)schemaFile {
 	return [[[NSBundle mainBundle] resourcePath] stringByAppendingPathComponent:SCHEMA_PLIST_FILENAME];
@@ -48,39 +88,432 @@
 - (void)deleteNoteWithID:(NSString *)noteID {
 	LSLocaytaSearchIndexableRecord *indexableRecord = [[LSLocaytaSearchIndexableRecord alloc] initWithSchema:self.notesSearchSchema];
 	NSError *error = nil;
-	if (![indexableRecord addValue:noteID forField:@"id" error:&error]) {
+	if (![indexableRecord addValue:noteID forField:NoteSearchFieldName(NoteSearchFieldID) error:&error]) {
 		@throw(error);
 	}
 	
 	[self.notesSearchIndexer deleteRecord:indexableRecord];
+	[noteFingerprints removeObjectForKey:noteID];
+	[changedNotes setObject:[NSNull null] forKey:noteID];
 	
 	[indexableRecord release];
 }
 
-- (void)updateSearchDatabaseForNote:(Note *)note {
+/**
+ Returns YES if the note's title or content have changed since it was last indexed, and remembers its fingerprint if
+ so.
+ 
+ The index has no per-field update, so a changed note is always replaced whole; but a save that changed
+ nothing (e.g. a note flushed twice, or opened and closed after a relaunch) doesn't cost an extraction and a
+ re-tokenization of the whole body.
+ */
+- (BOOL)noteNeedsReindexing:(Note *)note {
+	NoteFingerprint fingerprint;
+	fingerprint.titleHash = FingerprintHashString(note.title);
+	fingerprint.contentHash = FingerprintHashString(note.content);
 	
-	LSLocaytaSearchIndexableRecord *indexableRecord = [[LSLocaytaSearchIndexableRecord alloc] initWithSchema:self.notesSearchSchema];
 	NSString *objectID = [[[note objectID] URIRepresentation] absoluteString];
-	NSError *error = nil;
-	if (![indexableRecord addValue:objectID forField:@"id" error:&error]) {
-		@throw(error);
+	NSData *previousFingerprint = [noteFingerprints objectForKey:objectID];
+	if (previousFingerprint && memcmp([previousFingerprint bytes], &fingerprint, sizeof(fingerprint)) == 0) {
+		skippedReindexCount++;
+		return NO;
 	}
-	if (![indexableRecord addValue:note.title forField:@"title" error:&error]) {
+	
+	[noteFingerprints setObject:[NSData dataWithBytes:&fingerprint length:sizeof(fingerprint)] forKey:objectID];
+	reindexCount++;
+	return YES;
+}
+
+/**
+ Builds a record from typed values, using the compiled schema's field names.
+ */
+- (LSLocaytaSearchIndexableRecord *)newIndexableRecordWithNoteID:(NSString *)noteID title:(NSString *)title content:(NSString *)content lastUpdated:(NSTimeInterval)lastUpdated {
+	LSLocaytaSearchIndexableRecord *indexableRecord = [[LSLocaytaSearchIndexableRecord alloc] initWithSchema:self.notesSearchSchema];
+	NSError *error = nil;
+	if (![indexableRecord addValue:noteID forField:NoteSearchFieldName(NoteSearchFieldID) error:&error] ||
+		![indexableRecord addValue:title forField:NoteSearchFieldName(NoteSearchFieldTitle) error:&error] ||
+		![indexableRecord addValue:content forField:NoteSearchFieldName(NoteSearchFieldContent) error:&error] ||
+		![indexableRecord addValue:[NSNumber numberWithDouble:lastUpdated] forField:NoteSearchFieldName(NoteSearchFieldLastUpdated) error:&error]) {
+		[indexableRecord release];
 		@throw(error);
 	}
-	if (![indexableRecord addValue:note.content forField:@"content" error:&error]) {
-		@throw(error);
+	return indexableRecord;
+}
+
+- (LSLocaytaSearchIndexableRecord *)newIndexableRecordForNote:(Note *)note extractedText:(XHTMLExtractedText *)extractedText {
+	// Index the text of markup documents, not the markup itself.  Bundled notes
+	// are extracted from their mapped document rather than from a decoded copy.
+	if (nil == extractedText && self.noteDocumentStore) {
+		NSData *documentData = [self.noteDocumentStore dataForDocumentNamed:note.title];
+		if (documentData) {
+			extractedText = [XHTMLExtractedText extractedTextFromData:documentData];
+		}
 	}
-	NSNumber *lastUpdated = [NSNumber numberWithDouble:[note.lastUpdated timeIntervalSinceReferenceDate]];
-	if (![indexableRecord addValue:lastUpdated forField:@"lastUpdated" error:&error]) {
-		@throw(error);
+	if (nil == extractedText && [XHTMLExtractedText stringLooksLikeMarkup:note.content]) {
+		extractedText = [XHTMLExtractedText extractedTextFromString:note.content];
 	}
+	NSString *title = (extractedText.title ? extractedText.title : note.title);
+	NSString *content = (extractedText ? extractedText.text : note.content);
+	
+	NSString *objectID = [[[note objectID] URIRepresentation] absoluteString];
+	return [self newIndexableRecordWithNoteID:objectID title:title content:content lastUpdated:[note.lastUpdated timeIntervalSinceReferenceDate]];
+}
 
-	[self.notesSearchIndexer addOrReplaceRecord:indexableRecord];
+/**
+ Keeps a changed note's values for patching the note index, once the search database has been updated.
+ */
+- (void)recordChangedNote:(Note *)note {
+	NSString *objectID = [[[note objectID] URIRepresentation] absoluteString];
+	NSDictionary *values = [NSDictionary dictionaryWithObjectsAndKeys:
+							(note.title ? note.title : @""), kNoteSearchValueTitleKey,
+							(note.content ? note.content : @""), kNoteSearchValueContentKey,
+							(note.lastUpdated ? note.lastUpdated : [NSDate distantPast]), kNoteSearchValueLastUpdatedKey,
+							nil];
+	[changedNotes setObject:values forKey:objectID];
+}
+
+- (void)updateSearchDatabaseForNote:(Note *)note {
+	if (![self noteNeedsReindexing:note]) {
+		return;
+	}
+	[self recordChangedNote:note];
 	
+	LSLocaytaSearchIndexableRecord *indexableRecord = [self newIndexableRecordForNote:note extractedText:nil];
+	[self.notesSearchIndexer addOrReplaceRecord:indexableRecord];
 	[indexableRecord release];
 }
 
+- (void)updateSearchDatabaseForNotes:(NSArray *)notes extractedTexts:(NSArray *)extractedTexts recordingChanges:(BOOL)recordingChanges {
+	if ([notes count] == 0) {
+		return;
+	}
+	ZAssert(extractedTexts == nil || [extractedTexts count] == [notes count], @"Expected one extracted text per note");
+	
+	// A bulk import would patch the note index once per batch, so it's rebuilt after the last instead
+	if (!recordingChanges) {
+		noteIndexNeedsRebuild = YES;
+	}
+	
+	NSMutableArray *indexableRecords = [[NSMutableArray alloc] initWithCapacity:[notes count]];
+	NSUInteger noteIndex = 0;
+	for (Note *note in notes) {
+		XHTMLExtractedText *extractedText = [extractedTexts objectAtIndex:noteIndex++];
+		if ((id)extractedText == [NSNull null]) {
+			extractedText = nil;
+		}
+		if (![self noteNeedsReindexing:note]) {
+			continue;
+		}
+		if (recordingChanges) {
+			[self recordChangedNote:note];
+		}
+		LSLocaytaSearchIndexableRecord *indexableRecord = [self newIndexableRecordForNote:note extractedText:extractedText];
+		[indexableRecords addObject:indexableRecord];
+		[indexableRecord release];
+	}
+	
+	// A single indexing operation for the whole batch
+	if ([indexableRecords count] > 0) {
+		[self.notesSearchIndexer addOrReplaceRecords:indexableRecords];
+	}
+	DLog(@"Reindexed %u of %u notes (%u reindexed, %u skipped in total)", [indexableRecords count], [notes count], reindexCount, skippedReindexCount);
+	
+	[indexableRecords release];
+}
+
+- (void)updateSearchDatabaseForNotes:(NSArray *)notes extractedTexts:(NSArray *)extractedTexts {
+	[self updateSearchDatabaseForNotes:notes extractedTexts:extractedTexts recordingChanges:NO];
+}
+
+- (void)updateSearchDatabaseForNotes:(NSArray *)notes {
+	[self updateSearchDatabaseForNotes:notes extractedTexts:nil recordingChanges:YES];
+}
+
+
+#pragma mark -
+#pragma mark Vocabulary
+
+- (NSString *)completionsPath {
+	return [self.databasePath stringByAppendingPathComponent:kSearchCompletionsFilename];
+}
+
+- (NSString *)spellingPath {
+	return [self.databasePath stringByAppendingPathComponent:kSearchSpellingFilename];
+}
+
+- (NSString *)noteIndexPath {
+	return [self.databasePath stringByAppendingPathComponent:kSearchNoteIndexFilename];
+}
+
+- (NSString *)noteFingerprintsPath {
+	return [self.databasePath stringByAppendingPathComponent:kNoteFingerprintsFilename];
+}
+
+/**
+ Reads the fingerprints of the notes as they were last indexed, kept beside the search database so they describe the
+ same notes, or returns an empty dictionary if there are none.
+ */
+- (NSMutableDictionary *)newNoteFingerprintsFromFile {
+	NSData *data = [[NSData alloc] initWithContentsOfFile:[self noteFingerprintsPath]];
+	NSDictionary *fingerprints = (data ? [NSPropertyListSerialization propertyListWithData:data options:NSPropertyListImmutable
+																					format:NULL error:NULL] : nil);
+	[data release];
+	
+	NSMutableDictionary *validFingerprints = [[NSMutableDictionary alloc] initWithCapacity:[fingerprints count]];
+	if ([fingerprints isKindOfClass:[NSDictionary class]]) {
+		for (NSString *noteID in fingerprints) {
+			NSData *fingerprint = [fingerprints objectForKey:noteID];
+			if ([fingerprint isKindOfClass:[NSData class]] && [fingerprint length] == sizeof(NoteFingerprint)) {
+				[validFingerprints setObject:fingerprint forKey:noteID];
+			}
+		}
+	}
+	return validFingerprints;
+}
+
+/**
+ Writes the fingerprints out on the vocabulary queue, after any write already queued, waiting for it if asked.  Losing
+ the latest to a crash only costs their notes a reindex.
+ */
+- (void)writeNoteFingerprintsWaiting:(BOOL)wait {
+	NSDictionary *fingerprints = [noteFingerprints copy];
+	NSString *path = [self noteFingerprintsPath];
+	dispatch_block_t write = ^{
+		NSError *error = nil;
+		NSData *data = [NSPropertyListSerialization dataWithPropertyList:fingerprints format:NSPropertyListBinaryFormat_v1_0
+																 options:0 error:&error];
+		if (nil == data || ![data writeToFile:path atomically:YES]) {
+			DLog(@"Couldn't write note fingerprints to %@: %@", path, error);
+		}
+		[fingerprints release];
+	};
+	if (wait) {
+		dispatch_sync(vocabularyQueue, write);
+	}
+	else {
+		dispatch_async(vocabularyQueue, write);
+	}
+}
+
+- (void)writeNoteFingerprints {
+	[self writeNoteFingerprintsWaiting:NO];
+}
+
+- (void)writeNoteFingerprintsNow {
+	[NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(writeNoteFingerprints) object:nil];
+	[self writeNoteFingerprintsWaiting:YES];
+}
+
+- (void)scheduleNoteFingerprintsWrite {
+	[NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(writeNoteFingerprints) object:nil];
+	[self performSelector:@selector(writeNoteFingerprints) withObject:nil afterDelay:kFingerprintsWriteDelay];
+}
+
+- (BOOL)noteIndexIsCurrent {
+	return (noteIndexGeneration == indexGeneration);
+}
+
+/**
+ Returns YES, and treats the note index as current, if it was built from the notes as they are now.  Any change to
+ the notes changes their number or the latest lastUpdated.
+ */
+- (BOOL)checkNoteIndex {
+	SearchNoteIndex *noteIndex = [[SearchNoteIndex alloc] initWithContentsOfFile:[self noteIndexPath]];
+	NSDate *latestUpdate = nil;
+	NSUInteger noteCount = [Note countOfAllNotesWithLatestUpdate:&latestUpdate];
+	BOOL current = (noteIndex && noteIndex.noteCount == noteCount &&
+					(noteCount == 0 || noteIndex.latestUpdate == [latestUpdate timeIntervalSinceReferenceDate]));
+	[noteIndex release];
+	
+	if (current) {
+		noteIndexGeneration = indexGeneration;
+		noteIndexNeedsRebuild = NO;
+	}
+	return current;
+}
+
+/**
+ Adds a note, with its values as returned by searchValuesOfAllNotesInContext:, to a note index builder.
+ */
+static BOOL AddNoteToBuilder(NoteIndexBuilder *builder, NSString *noteID, NSDictionary *values, NoteDocumentStore *documentStore,
+							 const char *contentBytes, size_t contentLength) {
+	NSString *title = [values objectForKey:kNoteSearchValueTitleKey];
+	if (!NoteIndexBuilderAddNote(builder, [noteID UTF8String], [title UTF8String],
+								 [[values objectForKey:kNoteSearchValueLastUpdatedKey] timeIntervalSinceReferenceDate],
+								 contentBytes, contentLength)) {
+		return NO;
+	}
+	
+	// Bundled notes are named after their documents, which give their facets
+	NSDictionary *facetValues = [documentStore facetValuesForDocumentNamed:title];
+	for (NSString *facet in facetValues) {
+		if (!NoteIndexBuilderAddFacetValue(builder, [facet UTF8String], [[facetValues objectForKey:facet] UTF8String])) {
+			return NO;
+		}
+	}
+	return YES;
+}
+
+/**
+ Writes the search bar's completion and spelling dictionaries from the words of the note index just written, each
+ counted in the notes it's in, so the notes' text isn't split again.  The spelling dictionary is only written when
+ the words common enough to be in it have changed, which most edits don't do; its frequencies, used to order
+ candidates equally near a misspelling, catch up when it next is.  Called on the vocabulary queue.
+ */
+- (BOOL)writeVocabularyFromNoteIndex {
+	SearchNoteIndex *noteIndex = [[SearchNoteIndex alloc] initWithContentsOfFile:[self noteIndexPath]];
+	CompletionVocabulary *vocabulary = CompletionVocabularyCreate();
+	BOOL written = NO;
+	if (noteIndex && vocabulary && [noteIndex addTermsToVocabulary:vocabulary]) {
+		written = [SearchCompletions writeCompletionsForVocabulary:vocabulary toFile:[self completionsPath]];
+		uint64_t wordSetHash = [SearchSpellCorrector wordSetHashForVocabulary:vocabulary];
+		if (wordSetHash != spellingWordSetHash &&
+			[SearchSpellCorrector writeSpellingDictionaryForVocabulary:vocabulary toFile:[self spellingPath]]) {
+			spellingWordSetHash = wordSetHash;
+			written = YES;
+		}
+	}
+	CompletionVocabularyFree(vocabulary);
+	[noteIndex release];
+	return written;
+}
+
+/**
+ Rebuilds the note index, and with it the completion and spelling dictionaries, from every note, for when it can't be
+ patched: at launch, and after a bulk import.  The notes are read on the vocabulary queue, in a context of its own.
+ The completion block, if any, is called on the main thread with whether the note index was written.
+ */
+- (void)rebuildVocabularyWithCompletion:(void (^)(BOOL noteIndexWritten))completion {
+	[NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(rebuildVocabulary) object:nil];
+	
+	NSPersistentStoreCoordinator *coordinator = [[AppDelegate_Shared sharedAppDelegate] persistentStoreCoordinator];
+	NSString *noteIndexPath = [self noteIndexPath];
+	NoteDocumentStore *documentStore = self.noteDocumentStore;
+	NSUInteger generation = indexGeneration;
+	
+	// Notes saved from here on are read below, and patched in again afterwards, which leaves them as they were
+	noteIndexNeedsRebuild = NO;
+	[changedNotes removeAllObjects];
+	
+	dispatch_async(vocabularyQueue, ^{
+		BOOL noteIndexWritten = NO;
+		BOOL written = NO;
+		@autoreleasepool {
+			NSManagedObjectContext *context = [[NSManagedObjectContext alloc] init];
+			[context setPersistentStoreCoordinator:coordinator];
+			NSArray *notes = [Note searchValuesOfAllNotesInContext:context];
+			NoteIndexBuilder *noteIndexBuilder = NoteIndexBuilderCreate();
+			
+			BOOL added = (notes && noteIndexBuilder);
+			for (NSUInteger i=0; added && i<[notes count]; i++) {
+				@autoreleasepool {
+					NSDictionary *note = [notes objectAtIndex:i];
+					const char *bytes = [[note objectForKey:kNoteSearchValueContentKey] UTF8String];
+					added = AddNoteToBuilder(noteIndexBuilder, [note objectForKey:kNoteSearchValueIDKey], note, documentStore,
+											 bytes, (bytes ? strlen(bytes) : 0));
+				}
+			}
+			noteIndexWritten = (added && [SearchNoteIndex writeIndexForBuilder:noteIndexBuilder toFile:noteIndexPath]);
+			
+			// A rebuild writes the spelling dictionary whatever its words, as it may be missing
+			spellingWordSetHash = 0;
+			written = (noteIndexWritten && [self writeVocabularyFromNoteIndex]);
+			NoteIndexBuilderFree(noteIndexBuilder);
+			[context release];
+		}
+		
+		dispatch_async(dispatch_get_main_queue(), ^{
+			// Only current if nothing was indexed while it was being built
+			if (noteIndexWritten) {
+				noteIndexGeneration = generation;
+			}
+			else {
+				noteIndexNeedsRebuild = YES;
+			}
+			if (written || noteIndexWritten) {
+				[[NSNotificationCenter defaultCenter] postNotificationName:kSearchVocabularyDidChangeNotification object:nil];
+			}
+			if (completion) {
+				completion(noteIndexWritten);
+			}
+		});
+	});
+}
+
+- (void)rebuildVocabulary {
+	[self rebuildVocabularyWithCompletion:nil];
+}
+
+/**
+ Brings the note index, and the completion and spelling dictionaries, up to date with the notes saved since it was
+ written, without reading the others' text again: they are copied from the index as it is, and the dictionaries take
+ their words from the index.  That still takes time in proportion to the size of the index (0.3s for 30,000 notes from
+ 48MB of text on a desktop, against 0.85s to build it from their text, before reading the text from the store), but
+ nothing in proportion to the text of the notes.
+ */
+- (void)updateNoteIndex {
+	if (noteIndexNeedsRebuild) {
+		return;
+	}
+	NSDictionary *notes = [changedNotes copy];
+	NSString *noteIndexPath = [self noteIndexPath];
+	NoteDocumentStore *documentStore = self.noteDocumentStore;
+	NSUInteger generation = indexGeneration;
+	[changedNotes removeAllObjects];
+	
+	dispatch_async(vocabularyQueue, ^{
+		BOOL changed = ([notes count] > 0);
+		BOOL noteIndexWritten = YES;
+		BOOL written = NO;
+		if (changed) {
+			SearchNoteIndex *noteIndex = [[SearchNoteIndex alloc] initWithContentsOfFile:noteIndexPath];
+			NoteIndexBuilder *noteIndexBuilder = NoteIndexBuilderCreate();
+			BOOL added = (noteIndex && noteIndexBuilder &&
+						  [noteIndex addNotesToBuilder:noteIndexBuilder exceptNotesWithIDs:[NSSet setWithArray:[notes allKeys]]]);
+			for (NSString *noteID in notes) {
+				NSDictionary *values = [notes objectForKey:noteID];
+				if (!added || (id)values == [NSNull null]) {
+					continue;
+				}
+				@autoreleasepool {
+					const char *bytes = [[values objectForKey:kNoteSearchValueContentKey] UTF8String];
+					added = AddNoteToBuilder(noteIndexBuilder, noteID, values, documentStore, bytes, (bytes ? strlen(bytes) : 0));
+				}
+			}
+			noteIndexWritten = (added && [SearchNoteIndex writeIndexForBuilder:noteIndexBuilder toFile:noteIndexPath]);
+			written = (noteIndexWritten && [self writeVocabularyFromNoteIndex]);
+			NoteIndexBuilderFree(noteIndexBuilder);
+			[noteIndex release];
+		}
+		[notes release];
+		
+		dispatch_async(dispatch_get_main_queue(), ^{
+			if (!noteIndexWritten) {
+				[self scheduleVocabularyRebuild];
+				return;
+			}
+			noteIndexGeneration = generation;
+			if (changed) {
+				[[NSNotificationCenter defaultCenter] postNotificationName:kSearchVocabularyDidChangeNotification object:nil];
+			}
+		});
+	});
+}
+
+/**
+ Updates come in bursts (a bulk import commits a batch at a time), so wait for them to settle before rebuilding.
+ */
+- (void)scheduleVocabularyRebuild {
+	// Patching an index that's missing notes wouldn't make it current
+	noteIndexNeedsRebuild = YES;
+	[NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(rebuildVocabulary) object:nil];
+	[self performSelector:@selector(rebuildVocabulary) withObject:nil afterDelay:kVocabularyRebuildDelay];
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
 - (id)initWithDatabasePath:(NSString *)aDatabasePath {
     if ((self = [super init])) {
 		self.databasePath = aDatabasePath;
@@ -93,6 +526,18 @@
 		NSDictionary *searchSchema = [[NSDictionary alloc] initWithContentsOfFile:schemaFile];
 		self.notesSearchSchema = searchSchema;
 		[searchSchema release];
+		
+		NSString *schemaMismatch = nil;
+		if (!NoteSearchSchemaMatchesDictionary(self.notesSearchSchema, &schemaMismatch)) {
+			ALog(@"%@ does not match NoteSearchSchema: %@", SCHEMA_PLIST_FILENAME, schemaMismatch);
+		}
+		
+		noteFingerprints = [self newNoteFingerprintsFromFile];
+		noteIndexGeneration = NSNotFound;
+		noteIndexNeedsRebuild = YES;
+		changedNotes = [[NSMutableDictionary alloc] init];
+		vocabularyQueue = dispatch_queue_create("SearchDatabaseUpdater.vocabulary", DISPATCH_QUEUE_SERIAL);
+		dispatch_set_target_queue(vocabularyQueue, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0));
 	}
 	return self;
 }
@@ -101,6 +546,10 @@
 	[databasePath release];
 	[notesSearchIndexer release];
 	[notesSearchSchema release];
+	[noteDocumentStore release];
+	[noteFingerprints release];
+	[changedNotes release];
+	dispatch_release(vocabularyQueue);
 	
 	[super dealloc];
 }
@@ -111,11 +560,32 @@
 
 - (void)locaytaSearchIndexer:(LSLocaytaSearchIndexer *)searchIndexer didUpdateWithIndexableRecords:(NSArray *)indexableRecords {
 	DLog(@"successfullyIndexedRecords: %@", indexableRecords);
-	[[NSNotificationCenter defaultCenter] postNotificationName:kSearchDatabaseDidUpdateNotification object:nil];
+	
+	// Bump the generation before anyone is told, so cached search results are never reused after an update
+	dispatch_async(dispatch_get_main_queue(), ^{
+		indexGeneration++;
+		[[NSNotificationCenter defaultCenter] postNotificationName:kSearchDatabaseDidUpdateNotification object:nil];
+		[self scheduleNoteFingerprintsWrite];
+		if (noteIndexNeedsRebuild) {
+			[self scheduleVocabularyRebuild];
+			return;
+		}
+		[self updateNoteIndex];
+	});
 }
 
 - (void)locaytaSearchIndexer:(LSLocaytaSearchIndexer *)searchIndexer didFailToUpdateWithIndexableRecords:(NSArray *)indexableRecords error:(NSError *)error {
 	DLog(@"failedToIndexedRecords: %@ : %@", indexableRecords, error);
+	
+	// Forget what failed, so the next update of those notes isn't skipped (fingerprints are main thread only)
+	dispatch_async(dispatch_get_main_queue(), ^{
+		for (LSLocaytaSearchIndexableRecord *indexableRecord in indexableRecords) {
+			for (NSString *noteID in [indexableRecord valuesForField:NoteSearchFieldName(NoteSearchFieldID)]) {
+				[noteFingerprints removeObjectForKey:noteID];
+			}
+		}
+		[self scheduleNoteFingerprintsWrite];
+	});
 }
 
 @end
@@ -0,0 +1,94 @@
+//
+//  SearchNoteIndex.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import <Foundation/Foundation.h>
+
+#include "NoteIndex.h"
+
+#define kSearchNoteIndexFilename	@"notes.index"
+
+@class LocalSearchResult;
+@class LSLocaytaSearchResult;
+
+
+/*
+ * The app's own index of the notes (see NoteIndexCreate()), for answering
+ * title and date sorted searches without the search engine ordering the
+ * whole match set.
+ *
+ * Like the completion and spelling dictionaries it is built from the notes
+ * when the search database changes and kept, memory mapped, in the search
+ * database directory.  The stored fields are columns of fixed width sort
+ * values, so the notes an engine search matched are found by ID and the first
+ * page of them comes from a bounded heap, whatever their number; the engine
+ * only has to match them.  Notes are kept newest first, so the notes updated
+ * since a date are a single range.
+ */
+@interface SearchNoteIndex : NSObject {
+@private
+	NSData	*indexData;
+}
+
+@property (nonatomic, readonly)	NSUInteger		noteCount;
+@property (nonatomic, readonly)	NSTimeInterval	latestUpdate;		// since the reference date, of any note
+
++ (BOOL)writeIndexForBuilder:(const NoteIndexBuilder *)builder toFile:(NSString *)path;
+
+// Copies the notes other than those with the given IDs into a builder, for bringing the index up to date with changed
+// notes (see NoteIndexBuilderAddIndexedNotes())
+- (BOOL)addNotesToBuilder:(NoteIndexBuilder *)builder exceptNotesWithIDs:(NSSet *)noteIDs;
+
+// Counts the index's words into a vocabulary for the completion and spelling dictionaries (see
+// NoteIndexAddTermsToVocabulary())
+- (BOOL)addTermsToVocabulary:(CompletionVocabulary *)vocabulary;
+
+- (id)initWithContentsOfFile:(NSString *)path;
+
+// The first page of the notes an engine search matched (its whole match set) updated since the date, if given, in order,
+// as a result for queryString that loads later pages from the index as they're wanted, so it can stand in for the
+// engine's; or nil if any of the matches isn't in the index
+- (LocalSearchResult *)pagedResultForSearchResult:(LSLocaytaSearchResult *)searchResult queryString:(NSString *)queryString
+											order:(NoteIndexOrder)order updatedSince:(NSDate *)updatedSince pageSize:(NSUInteger)pageSize;
+
+// The notes an engine search matched (its whole match set) updated since the date, if given, in the engine's order; or
+// nil if any of the matches isn't in the index
+- (LocalSearchResult *)resultForSearchResult:(LSLocaytaSearchResult *)searchResult queryString:(NSString *)queryString
+								updatedSince:(NSDate *)updatedSince;
+
+// The results in a range of some notes (note numbers, as uint32_t), in order
+- (NSArray *)resultsForNotes:(NSData *)notes order:(NoteIndexOrder)order inRange:(NSRange)range;
+
+// Whether a note has a word starting with each of the terms, from the postings rather than the note's text
+- (BOOL)noteWithID:(NSString *)noteID matchesTerms:(NSArray *)terms;
+
+// For each facet, the number of the notes (note numbers, as uint32_t) with each of its values, as {facet: {value: count}}
+- (NSDictionary *)facetCountsForNotes:(NSData *)notes;
+
+// Facet counts of the notes an engine search matched (its whole match set), or nil if it isn't the whole match set or
+// any of the matches isn't in the index
+- (NSDictionary *)facetCountsForSearchResult:(LSLocaytaSearchResult *)searchResult;
+
+@end
@@ -0,0 +1,327 @@
+//
+//  SearchNoteIndex.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import "SearchNoteIndex.h"
+#import "LocalSearchResult.h"
+#import "NoteSearchSchema.h"
+
+#include <math.h>
+
+
+@implementation SearchNoteIndex
+
+/**
+ Builds a note index from the builder's notes and writes it to path, replacing any index already there.  Can be
+ called from any thread.
+ */
++ (BOOL)writeIndexForBuilder:(const NoteIndexBuilder *)builder toFile:(NSString *)path {
+	void *index = NULL;
+	size_t indexLength = 0;
+	if (!NoteIndexCreate(builder, &index, &indexLength)) {
+		return NO;
+	}
+	DLog(@"Wrote %u notes (%u bytes) to %@", NoteIndexBuilderNoteCount(builder), indexLength, path);
+	
+	NSData *data = [[NSData alloc] initWithBytesNoCopy:index length:indexLength freeWhenDone:YES];
+	BOOL written = [data writeToFile:path atomically:YES];
+	[data release];
+	return written;
+}
+
+- (BOOL)addNotesToBuilder:(NoteIndexBuilder *)builder exceptNotesWithIDs:(NSSet *)noteIDs {
+	const void *index = [indexData bytes];
+	uint8_t *removedNotes = calloc(MAX(self.noteCount, 1), sizeof(uint8_t));
+	if (removedNotes == NULL) {
+		return NO;
+	}
+	for (NSString *noteID in noteIDs) {
+		const char *noteIDBytes = [noteID UTF8String];
+		uint32_t note = 0;
+		if (noteIDBytes && NoteIndexFindNote(index, noteIDBytes, &note)) {
+			removedNotes[note] = 1;
+		}
+	}
+	BOOL added = NoteIndexBuilderAddIndexedNotes(builder, index, removedNotes);
+	free(removedNotes);
+	return added;
+}
+
+- (BOOL)addTermsToVocabulary:(CompletionVocabulary *)vocabulary {
+	return NoteIndexAddTermsToVocabulary([indexData bytes], vocabulary);
+}
+
+- (NSUInteger)noteCount {
+	return NoteIndexNoteCount([indexData bytes]);
+}
+
+- (NSTimeInterval)latestUpdate {
+	return NoteIndexLatestUpdate([indexData bytes]);
+}
+
+/**
+ Builds a result in the form the search engine returns, from the stored fields of a note.
+ */
+- (NSDictionary *)resultForNote:(uint32_t)note {
+	const void *index = [indexData bytes];
+	NSString *noteID = [NSString stringWithUTF8String:NoteIndexNoteID(index, note)];
+	NSString *title = [NSString stringWithUTF8String:NoteIndexTitle(index, note)];
+	if (nil == noteID || nil == title) {
+		return nil;
+	}
+	NSDictionary *fields = [NSDictionary dictionaryWithObjectsAndKeys:
+							[NSArray arrayWithObject:noteID], NoteSearchFieldName(NoteSearchFieldID),
+							[NSArray arrayWithObject:title], NoteSearchFieldName(NoteSearchFieldTitle),
+							[NSArray arrayWithObject:[NSNumber numberWithDouble:NoteIndexLastUpdated(index, note)]], NoteSearchFieldName(NoteSearchFieldLastUpdated),
+							nil];
+	return [NSDictionary dictionaryWithObject:fields forKey:@"fields"];
+}
+
+/**
+ Copies terms as UTF-8, folded as the note index's words are (see NoteIndexFoldTerm()).  Returns NO if there are none
+ (as for a query that isn't plain terms); otherwise *termBytes and *termLengths are malloc()ed, for the caller to free.
+ */
+static BOOL CopyIndexTerms(NSArray *terms, const char ***termBytes, size_t **termLengths, NSUInteger *termCount) {
+	*termCount = [terms count];
+	if (*termCount == 0) {
+		return NO;
+	}
+	
+	*termBytes = malloc(*termCount * sizeof(const char *));
+	*termLengths = malloc(*termCount * sizeof(size_t));
+	BOOL copied = (*termBytes && *termLengths);
+	for (NSUInteger i=0; copied && i<*termCount; i++) {
+		const char *bytes = [[terms objectAtIndex:i] UTF8String];
+		NSMutableData *folded = (bytes ? [NSMutableData dataWithBytes:bytes length:strlen(bytes) + 1] : nil);
+		if (folded) {
+			NoteIndexFoldTerm([folded mutableBytes], [folded length] - 1);
+		}
+		(*termBytes)[i] = [folded bytes];
+		(*termLengths)[i] = ([folded length] > 0 ? [folded length] - 1 : 0);
+		copied = (folded != nil);
+	}
+	if (!copied) {
+		free(*termBytes);
+		free(*termLengths);
+	}
+	return copied;
+}
+
+// Notes are in lastUpdated order, so the notes updated since a date (or all of them, without one) are a range of them
+- (void)getNotesUpdatedSince:(NSDate *)updatedSince firstNote:(uint32_t *)firstNote endNote:(uint32_t *)endNote {
+	*firstNote = 0;
+	*endNote = (uint32_t)self.noteCount;
+	if (updatedSince) {
+		NoteIndexNotesUpdatedBetween([indexData bytes], [updatedSince timeIntervalSinceReferenceDate], HUGE_VAL, firstNote, endNote);
+	}
+}
+
+/**
+ Finds, in the note index, the notes an engine search matched that were updated since a date (or all of them), in the
+ engine's order.  Returns nil if any match isn't in the index.
+ */
+- (NSData *)notesForSearchResult:(LSLocaytaSearchResult *)searchResult updatedSince:(NSDate *)updatedSince {
+	const void *index = [indexData bytes];
+	uint32_t firstNote, endNote;
+	[self getNotesUpdatedSince:updatedSince firstNote:&firstNote endNote:&endNote];
+	
+	NSArray *results = searchResult.results;
+	NSMutableData *notesData = [NSMutableData dataWithLength:[results count] * sizeof(uint32_t)];
+	uint32_t *notes = [notesData mutableBytes];
+	size_t noteCount = 0;
+	for (NSDictionary *result in results) {
+		NSString *noteID = [[[result valueForKey:@"fields"] valueForKey:NoteSearchFieldName(NoteSearchFieldID)] lastObject];
+		const char *noteIDBytes = [noteID UTF8String];
+		uint32_t note = 0;
+		if (noteIDBytes == NULL || !NoteIndexFindNote(index, noteIDBytes, &note)) {
+			return nil;
+		}
+		if (note >= firstNote && note < endNote) {
+			notes[noteCount++] = note;
+		}
+	}
+	[notesData setLength:noteCount * sizeof(uint32_t)];
+	return notesData;
+}
+
+- (LocalSearchResult *)pagedResultForNotes:(NSData *)notes queryString:(NSString *)queryString queryTerms:(NSSet *)queryTerms
+									 order:(NoteIndexOrder)order pageSize:(NSUInteger)pageSize {
+	NSArray *results = [self resultsForNotes:notes order:order inRange:NSMakeRange(0, pageSize)];
+	if (nil == results) {
+		return nil;
+	}
+	return [LocalSearchResult resultWithQueryString:queryString queryTerms:queryTerms results:results
+										  noteIndex:self notes:notes order:order];
+}
+
+- (LocalSearchResult *)pagedResultForSearchResult:(LSLocaytaSearchResult *)searchResult queryString:(NSString *)queryString
+											order:(NoteIndexOrder)order updatedSince:(NSDate *)updatedSince pageSize:(NSUInteger)pageSize {
+	if (searchResult.itemCount < searchResult.matchCount) {
+		return nil;		// not the whole match set
+	}
+	NSData *notes = [self notesForSearchResult:searchResult updatedSince:updatedSince];
+	if (nil == notes) {
+		return nil;
+	}
+	return [self pagedResultForNotes:notes queryString:queryString queryTerms:searchResult.queryTerms order:order pageSize:pageSize];
+}
+
+- (LocalSearchResult *)resultForSearchResult:(LSLocaytaSearchResult *)searchResult queryString:(NSString *)queryString
+								updatedSince:(NSDate *)updatedSince {
+	if (searchResult.itemCount < searchResult.matchCount) {
+		return nil;		// not the whole match set
+	}
+	const void *index = [indexData bytes];
+	uint32_t firstNote, endNote;
+	[self getNotesUpdatedSince:updatedSince firstNote:&firstNote endNote:&endNote];
+	
+	NSMutableArray *results = [NSMutableArray arrayWithCapacity:MIN(searchResult.itemCount, endNote - firstNote)];
+	for (NSDictionary *result in searchResult.results) {
+		NSString *noteID = [[[result valueForKey:@"fields"] valueForKey:NoteSearchFieldName(NoteSearchFieldID)] lastObject];
+		const char *noteIDBytes = [noteID UTF8String];
+		uint32_t note = 0;
+		if (noteIDBytes == NULL || !NoteIndexFindNote(index, noteIDBytes, &note)) {
+			return nil;
+		}
+		if (note >= firstNote && note < endNote) {
+			[results addObject:result];
+		}
+	}
+	return [LocalSearchResult resultWithQueryString:queryString queryTerms:searchResult.queryTerms results:results
+										 matchCount:[results count] matchCountExact:YES];
+}
+
+/**
+ Orders the notes with a bounded heap over the index's sort values, for the results [range.location, NSMaxRange(range))
+ of them.
+ */
+- (NSArray *)resultsForNotes:(NSData *)notes order:(NoteIndexOrder)order inRange:(NSRange)range {
+	size_t noteCount = [notes length] / sizeof(uint32_t);
+	size_t endIndex = MIN(NSMaxRange(range), noteCount);
+	uint32_t *top = malloc(MAX(endIndex, 1) * sizeof(uint32_t));
+	if (top == NULL) {
+		return nil;
+	}
+	size_t topCount = NoteIndexSelectTop([indexData bytes], [notes bytes], noteCount, order, top, endIndex);
+	
+	NSMutableArray *results = [NSMutableArray arrayWithCapacity:(topCount > range.location ? topCount - range.location : 0)];
+	for (size_t i=range.location; i<topCount; i++) {
+		NSDictionary *result = [self resultForNote:top[i]];
+		if (result) {
+			[results addObject:result];
+		}
+	}
+	free(top);
+	return results;
+}
+
+- (BOOL)noteWithID:(NSString *)noteID matchesTerms:(NSArray *)terms {
+	const void *index = [indexData bytes];
+	uint32_t note = 0;
+	const char *noteIDBytes = [noteID UTF8String];
+	if (noteIDBytes == NULL || !NoteIndexFindNote(index, noteIDBytes, &note)) {
+		return NO;
+	}
+	
+	const char **termBytes = NULL;
+	size_t *termLengths = NULL;
+	NSUInteger termCount = 0;
+	if (!CopyIndexTerms(terms, &termBytes, &termLengths, &termCount)) {
+		return YES;
+	}
+	
+	// Matching just the note's own range only looks up each term's postings for it
+	uint32_t match = 0;
+	size_t matchCount = 0;
+	uint32_t notesScanned = 0;
+	BOOL matched = (NoteIndexMatch(index, termBytes, termLengths, termCount, note, note + 1, 1, &match, &matchCount, &notesScanned) &&
+					matchCount == 1);
+	free(termBytes);
+	free(termLengths);
+	return matched;
+}
+
+- (NSDictionary *)facetCountsForNotes:(NSData *)notes {
+	const void *index = [indexData bytes];
+	uint32_t facetValueCount = NoteIndexFacetValueCount(index);
+	uint32_t *counts = malloc(MAX(facetValueCount, 1) * sizeof(uint32_t));
+	if (counts == NULL || !NoteIndexCountFacetValues(index, [notes bytes], [notes length] / sizeof(uint32_t), counts)) {
+		free(counts);
+		return nil;
+	}
+	
+	NSMutableDictionary *facetCounts = [NSMutableDictionary dictionary];
+	for (uint32_t i=0; i<facetValueCount; i++) {
+		NSString *facet = [NSString stringWithUTF8String:NoteIndexFacetName(index, i)];
+		NSString *value = [NSString stringWithUTF8String:NoteIndexFacetValue(index, i)];
+		if (nil == facet || nil == value) {
+			continue;
+		}
+		NSMutableDictionary *valueCounts = [facetCounts objectForKey:facet];
+		if (nil == valueCounts) {
+			valueCounts = [NSMutableDictionary dictionary];
+			[facetCounts setObject:valueCounts forKey:facet];
+		}
+		[valueCounts setObject:[NSNumber numberWithUnsignedInt:counts[i]] forKey:value];
+	}
+	free(counts);
+	return facetCounts;
+}
+
+- (NSDictionary *)facetCountsForSearchResult:(LSLocaytaSearchResult *)searchResult {
+	if (searchResult.itemCount < searchResult.matchCount) {
+		return nil;		// not the whole match set
+	}
+	NSData *notes = [self notesForSearchResult:searchResult updatedSince:nil];
+	if (nil == notes) {
+		return nil;
+	}
+	return [self facetCountsForNotes:notes];
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithContentsOfFile:(NSString *)path {
+	NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:NULL];
+	if (!NoteIndexIsValid([data bytes], [data length])) {
+		[self release];
+		return nil;
+	}
+	
+	if ((self = [super init])) {
+		indexData = [data retain];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[indexData release];
+	
+	[super dealloc];
+}
+
+@end
@@ -0,0 +1,62 @@
+//
+//  SearchResultCache.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+
+@class LSLocaytaSearchResult;
+
+
+/*
+ * Small LRU cache of search results.
+ *
+ * Results are only valid for the search database generation they were found
+ * in; looking up a different generation empties the cache, so nothing stale is
+ * ever returned after the index has been updated.
+ *
+ * Must only be used from the main thread.
+ */
+@interface SearchResultCache : NSObject {
+	NSUInteger				capacity;
+	
+@private
+	NSMutableDictionary		*resultsByKey;
+	NSMutableArray			*keysByRecentUse;		// least recently used first
+	NSUInteger				generation;
+	NSUInteger				hitCount;
+	NSUInteger				missCount;
+}
+
+@property (nonatomic, assign)	NSUInteger	capacity;
+@property (nonatomic, readonly)	NSUInteger	hitCount;
+@property (nonatomic, readonly)	NSUInteger	missCount;
+
++ (NSString *)keyForQueryString:(NSString *)queryString sortOrder:(NSArray *)sortOrder spellCorrectionMethod:(NSInteger)spellCorrectionMethod topDocIndex:(NSInteger)topDocIndex docsPerPage:(NSInteger)docsPerPage;
+
+- (id)initWithCapacity:(NSUInteger)aCapacity;
+- (LSLocaytaSearchResult *)resultForKey:(NSString *)key generation:(NSUInteger)aGeneration;
+- (void)setResult:(LSLocaytaSearchResult *)result forKey:(NSString *)key generation:(NSUInteger)aGeneration;
+- (void)removeAllResults;
+
+@end
@@ -0,0 +1,119 @@
+//
+//  SearchResultCache.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import "SearchResultCache.h"
+
+
+@implementation SearchResultCache
+
+@synthesize capacity;
+@synthesize hitCount;
+@synthesize missCount;
+
+/**
+ Queries that differ only in whitespace get the same key.  Case is kept, since it is significant for
+ query operators such as "OR".
+ */
++ (NSString *)keyForQueryString:(NSString *)queryString sortOrder:(NSArray *)sortOrder spellCorrectionMethod:(NSInteger)spellCorrectionMethod topDocIndex:(NSInteger)topDocIndex docsPerPage:(NSInteger)docsPerPage {
+	NSArray *words = [queryString componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+	NSMutableArray *normalizedWords = [NSMutableArray arrayWithCapacity:[words count]];
+	for (NSString *word in words) {
+		if ([word length] > 0) {
+			[normalizedWords addObject:word];
+		}
+	}
+	
+	return [NSString stringWithFormat:@"%@|%d|%d|%d|%@", (sortOrder ? [sortOrder componentsJoinedByString:@","] : @""),
+			spellCorrectionMethod, topDocIndex, docsPerPage, [normalizedWords componentsJoinedByString:@" "]];
+}
+
+- (void)moveToGeneration:(NSUInteger)aGeneration {
+	if (aGeneration != generation) {
+		[self removeAllResults];
+		generation = aGeneration;
+	}
+}
+
+- (LSLocaytaSearchResult *)resultForKey:(NSString *)key generation:(NSUInteger)aGeneration {
+	[self moveToGeneration:aGeneration];
+	
+	LSLocaytaSearchResult *result = [resultsByKey objectForKey:key];
+	if (result) {
+		hitCount++;
+		[keysByRecentUse removeObject:key];
+		[keysByRecentUse addObject:key];
+	}
+	else {
+		missCount++;
+	}
+	return result;
+}
+
+- (void)setResult:(LSLocaytaSearchResult *)result forKey:(NSString *)key generation:(NSUInteger)aGeneration {
+	// Don't let a search that was started before an index update replace current results
+	if (aGeneration < generation || nil == result) {
+		return;
+	}
+	[self moveToGeneration:aGeneration];
+	
+	if ([resultsByKey objectForKey:key]) {
+		[keysByRecentUse removeObject:key];
+	}
+	[resultsByKey setObject:result forKey:key];
+	[keysByRecentUse addObject:key];
+	
+	while ([keysByRecentUse count] > self.capacity) {
+		[resultsByKey removeObjectForKey:[keysByRecentUse objectAtIndex:0]];
+		[keysByRecentUse removeObjectAtIndex:0];
+	}
+}
+
+- (void)removeAllResults {
+	[resultsByKey removeAllObjects];
+	[keysByRecentUse removeAllObjects];
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithCapacity:(NSUInteger)aCapacity {
+	if ((self = [super init])) {
+		self.capacity = aCapacity;
+		
+		resultsByKey = [[NSMutableDictionary alloc] initWithCapacity:aCapacity];
+		keysByRecentUse = [[NSMutableArray alloc] initWithCapacity:aCapacity];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[resultsByKey release];
+	[keysByRecentUse release];
+	
+	[super dealloc];
+}
+
+@end
@@ -0,0 +1,83 @@
+//
+//  SearchResultCursor.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import <LocaytaSearch/LSLocaytaSearch.h>
+
+@class SearchSession;
+@protocol SearchResultCursorDelegate;
+
+
+/*
+ * Gives indexed access to every result of a search, not just the first page.
+ *
+ * The cursor starts with the first page of results, from the search itself
+ * (which may hold more than a page).
+ * Asking for a result on a page that isn't loaded yet returns nil and fetches
+ * that page in the background; the delegate is told when it arrives.  Pages a
+ * little ahead of the last result asked for are prefetched, and pages far
+ * from it are dropped, so only a window of stored fields is kept in memory
+ * however long the result list is.  Pages are loaded through a search
+ * session shared with later cursors, so paging doesn't reopen the database;
+ * the session is the latest cursor's while it loads a page.  A paged result
+ * from the note index (see LocalSearchResult) loads its pages there instead,
+ * as soon as they're asked for.
+ *
+ * Must only be used from the main thread.
+ */
+@interface SearchResultCursor : NSObject <LSLocaytaSearchRequestDelegate> {
+	id<SearchResultCursorDelegate>	delegate;
+	LSLocaytaSearchResult			*searchResult;
+	NSInteger						count;
+	
+@private
+	SearchSession					*pageSession;
+	NSUInteger						indexGeneration;
+	NSArray							*sortOrder;
+	NSInteger						pageSize;
+	NSMutableDictionary				*pages;				// page index => array of results
+	NSMutableIndexSet				*wantedPages;
+	LSLocaytaSearchRequest			*pageRequest;
+	NSInteger						pageRequestIndex;
+	NSInteger						lastPageIndexUsed;
+}
+
+@property (nonatomic, assign)			id<SearchResultCursorDelegate>	delegate;
+@property (nonatomic, retain, readonly)	LSLocaytaSearchResult			*searchResult;		// the first page, as returned by the search
+@property (nonatomic, readonly)			NSInteger						count;				// starts as the match count (which may be an estimate)
+
+- (id)initWithSearchSession:(SearchSession *)aSearchSession indexGeneration:(NSUInteger)anIndexGeneration
+			  searchResult:(LSLocaytaSearchResult *)aSearchResult sortOrder:(NSArray *)aSortOrder pageSize:(NSInteger)aPageSize;
+- (NSDictionary *)resultAtIndex:(NSInteger)index;
+- (NSString *)stringValueForField:(NSString *)fieldName atIndex:(NSInteger)index;
+- (void)cancel;
+
+@end
+
+
+@protocol SearchResultCursorDelegate
+- (void)searchResultCursor:(SearchResultCursor *)cursor didLoadResultsInRange:(NSRange)range;
+- (void)searchResultCursorDidChangeCount:(SearchResultCursor *)cursor;
+@end
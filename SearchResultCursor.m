@@ -0,0 +1,237 @@
+//
+//  SearchResultCursor.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import "SearchResultCursor.h"
+
+#import "LocalSearchResult.h"
+#import "RewrittenSearchResult.h"
+#import "SearchSession.h"
+
+#define kPrefetchDistance	10		// results
+#define kMaxCachedPages		6
+
+
+@interface SearchResultCursor ()
+@property (nonatomic, retain)	LSLocaytaSearchRequest	*pageRequest;
+- (void)loadNextWantedPage;
+@end
+
+
+@implementation SearchResultCursor
+
+@synthesize delegate;
+@synthesize searchResult;
+@synthesize count;
+@synthesize pageRequest;
+
+- (NSString *)pageQueryString {
+	// Later pages must match the first, so search for whatever the first page was rewritten or corrected to
+	if ([searchResult isKindOfClass:[RewrittenSearchResult class]]) {
+		return ((RewrittenSearchResult *)searchResult).rewrittenQueryString;
+	}
+	return (searchResult.wasAutoSpellCorrected ? searchResult.correctedQueryString : searchResult.requestedQueryString);
+}
+
+- (void)evictDistantPages {
+	while ([pages count] > kMaxCachedPages) {
+		NSNumber *farthestPage = nil;
+		for (NSNumber *page in [pages allKeys]) {
+			if ([page integerValue] == 0) {
+				continue;		// the first page is the search result itself
+			}
+			if (nil == farthestPage || labs([page integerValue] - lastPageIndexUsed) > labs([farthestPage integerValue] - lastPageIndexUsed)) {
+				farthestPage = page;
+			}
+		}
+		if (nil == farthestPage) {
+			break;
+		}
+		[pages removeObjectForKey:farthestPage];
+	}
+}
+
+- (void)wantPage:(NSInteger)pageIndex {
+	if (pageIndex < 0 || pageIndex * pageSize >= count || [pages objectForKey:[NSNumber numberWithInteger:pageIndex]]) {
+		return;
+	}
+	if (MIN((pageIndex + 1) * pageSize, count) <= (NSInteger)[searchResult.results count]) {
+		return;		// in the search result already
+	}
+	
+	// A paged result from the note index has its later pages to hand, so they're ready as soon as they're asked for
+	if ([searchResult isKindOfClass:[LocalSearchResult class]] && ((LocalSearchResult *)searchResult).isPaged) {
+		NSArray *results = [(LocalSearchResult *)searchResult resultsInRange:NSMakeRange(pageIndex * pageSize, pageSize)];
+		[pages setObject:(results ? results : [NSArray array]) forKey:[NSNumber numberWithInteger:pageIndex]];
+		[self evictDistantPages];
+		return;
+	}
+	
+	[wantedPages addIndex:pageIndex];
+	[self loadNextWantedPage];
+}
+
+- (void)loadNextWantedPage {
+	if (self.pageRequest || [wantedPages count] == 0) {
+		return;
+	}
+	
+	// Nearest the scroll position first
+	NSUInteger nextPage = [wantedPages indexGreaterThanOrEqualToIndex:lastPageIndexUsed];
+	if (nextPage == NSNotFound) {
+		nextPage = [wantedPages lastIndex];
+	}
+	[wantedPages removeIndex:nextPage];
+	pageRequestIndex = nextPage;
+	
+	pageSession.delegate = self;
+	[pageSession searchWithQueryString:[self pageQueryString]
+							 sortOrder:sortOrder
+				 spellCorrectionMethod:LSLocaytaSearchRequestSpellCorrectionMethodNone
+						   topDocIndex:(pageRequestIndex * pageSize)
+						   docsPerPage:pageSize
+					   indexGeneration:indexGeneration];
+	self.pageRequest = pageSession.searchRequest;
+}
+
+- (NSDictionary *)resultAtIndex:(NSInteger)index {
+	if (index < 0 || index >= count) {
+		return nil;
+	}
+	
+	NSInteger pageIndex = index / pageSize;
+	lastPageIndexUsed = pageIndex;
+	
+	// Keep the next few results ready before they scroll into view
+	[self wantPage:(index + kPrefetchDistance) / pageSize];
+	
+	// A search result can hold more than the first page (one from the note index may hold every match)
+	if (index < (NSInteger)[searchResult.results count]) {
+		return [searchResult.results objectAtIndex:index];
+	}
+	
+	NSArray *page = [pages objectForKey:[NSNumber numberWithInteger:pageIndex]];
+	if (nil == page) {
+		[self wantPage:pageIndex];
+		return nil;
+	}
+	NSInteger indexInPage = index - pageIndex * pageSize;
+	return (indexInPage < (NSInteger)[page count] ? [page objectAtIndex:indexInPage] : nil);
+}
+
+- (NSString *)stringValueForField:(NSString *)fieldName atIndex:(NSInteger)index {
+	NSDictionary *result = [self resultAtIndex:index];
+	NSArray *values = [[result valueForKey:@"fields"] valueForKey:fieldName];
+	return ([values count] > 0 ? [values objectAtIndex:0] : nil);
+}
+
+- (void)cancel {
+	if (self.pageRequest && pageSession.delegate == self) {
+		[pageSession cancel];
+	}
+	self.pageRequest = nil;
+	[wantedPages removeAllIndexes];
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithSearchSession:(SearchSession *)aSearchSession indexGeneration:(NSUInteger)anIndexGeneration
+			  searchResult:(LSLocaytaSearchResult *)aSearchResult sortOrder:(NSArray *)aSortOrder pageSize:(NSInteger)aPageSize {
+	if ((self = [super init])) {
+		pageSession = [aSearchSession retain];
+		indexGeneration = anIndexGeneration;
+		searchResult = [aSearchResult retain];
+		sortOrder = [aSortOrder copy];
+		pageSize = MAX(aPageSize, 1);
+		
+		// A complete result never needs another page
+		count = (aSearchResult.itemCount < pageSize ? aSearchResult.itemCount : MAX(aSearchResult.matchCount, aSearchResult.itemCount));
+		
+		pages = [[NSMutableDictionary alloc] initWithCapacity:kMaxCachedPages];
+		[pages setObject:(aSearchResult.results ? aSearchResult.results : [NSArray array]) forKey:[NSNumber numberWithInteger:0]];
+		wantedPages = [[NSMutableIndexSet alloc] init];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	if (pageSession.delegate == self) {
+		if (pageRequest) {
+			[pageSession cancel];
+		}
+		pageSession.delegate = nil;
+	}
+	[pageSession release];
+	[pageRequest release];
+	[searchResult release];
+	[sortOrder release];
+	[pages release];
+	[wantedPages release];
+	
+	[super dealloc];
+}
+
+
+#pragma mark -
+#pragma mark LSLocaytaSearchRequestDelegate methods
+
+- (void)locaytaSearchRequest:(LSLocaytaSearchRequest *)searchRequest didCompleteWithResult:(LSLocaytaSearchResult *)pageResult {
+	if (searchRequest != self.pageRequest) {
+		return;
+	}
+	self.pageRequest = nil;
+	
+	NSArray *results = (pageResult.results ? pageResult.results : [NSArray array]);
+	[pages setObject:results forKey:[NSNumber numberWithInteger:pageRequestIndex]];
+	[self evictDistantPages];
+	
+	// The match count can be an estimate - a short page means we have reached the real end
+	NSInteger pageStart = pageRequestIndex * pageSize;
+	if ((NSInteger)[results count] < pageSize && pageStart + (NSInteger)[results count] != count) {
+		count = pageStart + [results count];
+		[delegate searchResultCursorDidChangeCount:self];
+	}
+	else {
+		[delegate searchResultCursor:self didLoadResultsInRange:NSMakeRange(pageStart, [results count])];
+	}
+	
+	[self loadNextWantedPage];
+}
+
+- (void)locaytaSearchRequest:(LSLocaytaSearchRequest *)searchRequest didFailWithError:(NSError *)error {
+	DLog(@"error: %@", error);
+	if (searchRequest != self.pageRequest) {
+		return;
+	}
+	self.pageRequest = nil;
+	
+	// Stop at what we have rather than retrying forever
+	count = MIN(count, pageRequestIndex * pageSize);
+	[wantedPages removeAllIndexes];
+	[delegate searchResultCursorDidChangeCount:self];
+}
+
+@end
@@ -0,0 +1,78 @@
+//
+//  SearchSession.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import <Foundation/Foundation.h>
+#import <LocaytaSearch/LSLocaytaSearch.h>
+
+
+/*
+ * A long-lived search session on one search database.
+ *
+ * Rather than a new LSLocaytaSearchRequest and LSLocaytaSearchQuery for every
+ * search, the session keeps a warm request and query and reuses them for each
+ * search.  They are only replaced ("reopened") when the search database
+ * generation changes, or when a search is cancelled part way through.
+ *
+ * The session is the delegate of its requests: it times each search and then
+ * passes the callback on to its own delegate.
+ */
+@interface SearchSession : NSObject <LSLocaytaSearchRequestDelegate> {
+	NSString							*databasePath;
+	id<LSLocaytaSearchRequestDelegate>	delegate;
+	
+@private
+	LSLocaytaSearchRequest				*searchRequest;
+	LSLocaytaSearchQuery				*searchQuery;
+	NSUInteger							indexGeneration;
+	BOOL								needsReopen;
+	NSUInteger							openCount;
+	NSUInteger							reuseCount;
+	NSTimeInterval						lastOpenDuration;
+	NSTimeInterval						totalOpenDuration;
+	NSTimeInterval						searchStartTime;
+	NSTimeInterval						lastSearchDuration;
+}
+
+@property (nonatomic, copy, readonly)	NSString							*databasePath;
+@property (nonatomic, assign)			id<LSLocaytaSearchRequestDelegate>	delegate;
+@property (nonatomic, retain, readonly)	LSLocaytaSearchRequest				*searchRequest;
+@property (nonatomic, retain, readonly)	LSLocaytaSearchQuery				*searchQuery;
+
+@property (nonatomic, readonly)			NSUInteger							openCount;
+@property (nonatomic, readonly)			NSUInteger							reuseCount;
+@property (nonatomic, readonly)			NSTimeInterval						lastOpenDuration;
+@property (nonatomic, readonly)			NSTimeInterval						totalOpenDuration;
+@property (nonatomic, readonly)			NSTimeInterval						lastSearchDuration;
+
+- (id)initWithDatabasePath:(NSString *)aDatabasePath;
+- (void)searchWithQueryString:(NSString *)queryString
+					sortOrder:(NSArray *)sortOrder
+		spellCorrectionMethod:(LSLocaytaSearchRequestSpellCorrectionMethod)spellCorrectionMethod
+				  topDocIndex:(NSInteger)topDocIndex
+				  docsPerPage:(NSInteger)docsPerPage
+			  indexGeneration:(NSUInteger)anIndexGeneration;
+- (void)cancel;
+
+@end
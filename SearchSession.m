@@ -0,0 +1,136 @@
+//
+//  SearchSession.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import "SearchSession.h"
+
+
+@interface SearchSession ()
+@property (nonatomic, retain, readwrite)	LSLocaytaSearchRequest	*searchRequest;
+@property (nonatomic, retain, readwrite)	LSLocaytaSearchQuery	*searchQuery;
+@end
+
+
+@implementation SearchSession
+
+@synthesize databasePath;
+@synthesize delegate;
+@synthesize searchRequest;
+@synthesize searchQuery;
+@synthesize openCount;
+@synthesize reuseCount;
+@synthesize lastOpenDuration;
+@synthesize totalOpenDuration;
+@synthesize lastSearchDuration;
+
+- (void)openWithQueryString:(NSString *)queryString {
+	NSTimeInterval startTime = [NSDate timeIntervalSinceReferenceDate];
+	
+	[self.searchRequest cancel];
+	LSLocaytaSearchRequest *newSearchRequest = [[LSLocaytaSearchRequest alloc] initWithDatabasePath:self.databasePath delegate:self];
+	self.searchRequest = newSearchRequest;
+	[newSearchRequest release];
+	
+	LSLocaytaSearchQuery *newSearchQuery = [[LSLocaytaSearchQuery alloc] initWithQueryString:queryString];
+	newSearchQuery.defaultOperator = LSLocaytaSearchQueryOperatorAnd;
+	self.searchQuery = newSearchQuery;
+	[newSearchQuery release];
+	
+	needsReopen = NO;
+	openCount++;
+	lastOpenDuration = [NSDate timeIntervalSinceReferenceDate] - startTime;
+	totalOpenDuration += lastOpenDuration;
+	DLog(@"Opened search session on \"%@\" in %.3fms (%u opens, %u reuses)", self.databasePath, lastOpenDuration * 1000.0, openCount, reuseCount);
+}
+
+- (void)searchWithQueryString:(NSString *)queryString
+					sortOrder:(NSArray *)sortOrder
+		spellCorrectionMethod:(LSLocaytaSearchRequestSpellCorrectionMethod)spellCorrectionMethod
+				  topDocIndex:(NSInteger)topDocIndex
+				  docsPerPage:(NSInteger)docsPerPage
+			  indexGeneration:(NSUInteger)anIndexGeneration {
+	if (nil == self.searchRequest || needsReopen || self.searchRequest.searchRequestInProgress || anIndexGeneration != indexGeneration) {
+		indexGeneration = anIndexGeneration;
+		[self openWithQueryString:queryString];
+	}
+	else {
+		reuseCount++;
+		self.searchQuery.queryString = queryString;
+	}
+	
+	self.searchRequest.sortOrder = sortOrder;
+	self.searchRequest.spellCorrectionMethod = spellCorrectionMethod;
+	
+	searchStartTime = [NSDate timeIntervalSinceReferenceDate];
+	[self.searchRequest searchWithQuery:self.searchQuery topDocIndex:topDocIndex docsPerPage:docsPerPage];
+}
+
+- (void)cancel {
+	if (self.searchRequest.searchRequestInProgress) {
+		// Don't rely on a cancelled request being reusable
+		[self.searchRequest cancel];
+		needsReopen = YES;
+	}
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithDatabasePath:(NSString *)aDatabasePath {
+	if ((self = [super init])) {
+		databasePath = [aDatabasePath copy];
+		needsReopen = YES;
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[searchRequest cancel];
+	[searchRequest release];
+	[searchQuery release];
+	[databasePath release];
+	
+	[super dealloc];
+}
+
+
+#pragma mark -
+#pragma mark LSLocaytaSearchRequestDelegate methods
+
+- (void)locaytaSearchRequest:(LSLocaytaSearchRequest *)aSearchRequest didCompleteWithResult:(LSLocaytaSearchResult *)searchResult {
+	lastSearchDuration = [NSDate timeIntervalSinceReferenceDate] - searchStartTime;
+	DLog(@"Search for \"%@\" took %.3fms", searchResult.requestedQueryString, lastSearchDuration * 1000.0);
+	
+	[delegate locaytaSearchRequest:aSearchRequest didCompleteWithResult:searchResult];
+}
+
+- (void)locaytaSearchRequest:(LSLocaytaSearchRequest *)aSearchRequest didFailWithError:(NSError *)error {
+	lastSearchDuration = [NSDate timeIntervalSinceReferenceDate] - searchStartTime;
+	needsReopen = YES;
+	
+	[delegate locaytaSearchRequest:aSearchRequest didFailWithError:error];
+}
+
+@end
@@ -0,0 +1,131 @@
+//
+//  SearchSnippet.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import "SearchSnippet.h"
+
+#include "SnippetSelection.h"
+
+#define kSnippetLength			120		// characters
+#define kSnippetScanLimit		8192	// characters - keeps each snippet well under 50us
+#define kSnippetMaxTerms		8
+#define kSnippetEllipsis		@"..."
+
+
+@interface SearchSnippet ()
+- (id)initWithText:(NSString *)aText highlightRanges:(NSArray *)someHighlightRanges;
+@end
+
+
+@implementation SearchSnippet
+
+@synthesize text;
+@synthesize highlightRanges;
+
+/**
+ Query terms can carry the index's upper case term prefixes (e.g. "Z" for stemmed terms) - strip those and
+ lower case the rest.
+ */
++ (NSArray *)normalizedTermsFromQueryTerms:(NSSet *)queryTerms {
+	NSMutableSet *normalizedTerms = [NSMutableSet setWithCapacity:[queryTerms count]];
+	NSCharacterSet *uppercaseLetters = [NSCharacterSet uppercaseLetterCharacterSet];
+	for (NSString *term in queryTerms) {
+		NSUInteger prefixLength = 0;
+		while (prefixLength < [term length] && [uppercaseLetters characterIsMember:[term characterAtIndex:prefixLength]]) {
+			prefixLength++;
+		}
+		NSString *normalizedTerm = [[term substringFromIndex:prefixLength] lowercaseString];
+		if ([normalizedTerm length] >= 2) {
+			[normalizedTerms addObject:normalizedTerm];
+		}
+	}
+	return [normalizedTerms allObjects];
+}
+
++ (SearchSnippet *)snippetForText:(NSString *)noteText queryTerms:(NSSet *)queryTerms {
+	NSUInteger textLength = [noteText length];
+	if (textLength == 0) {
+		return nil;
+	}
+	
+	NSArray *terms = [self normalizedTermsFromQueryTerms:queryTerms];
+	NSUInteger termCount = MIN([terms count], kSnippetMaxTerms);
+	unichar *termCharacters[kSnippetMaxTerms];
+	size_t termLengths[kSnippetMaxTerms];
+	for (NSUInteger i=0; i<termCount; i++) {
+		NSString *term = [terms objectAtIndex:i];
+		termLengths[i] = [term length];
+		termCharacters[i] = malloc(termLengths[i] * sizeof(unichar));
+		[term getCharacters:termCharacters[i] range:NSMakeRange(0, termLengths[i])];
+	}
+	
+	// Only the part of the text that will be scanned is copied out
+	NSUInteger scanLength = MIN(textLength, kSnippetScanLimit);
+	unichar *characters = malloc(scanLength * sizeof(unichar));
+	[noteText getCharacters:characters range:NSMakeRange(0, scanLength)];
+	
+	SnippetSelection selection;
+	SnippetSelect(characters, scanLength, (const uint16_t *const *)termCharacters, termLengths, termCount,
+				  kSnippetLength, kSnippetScanLimit, &selection);
+	
+	NSString *prefix = (selection.window.location > 0 ? kSnippetEllipsis : @"");
+	NSString *suffix = (selection.window.location + selection.window.length < textLength ? kSnippetEllipsis : @"");
+	NSString *windowText = [[NSString alloc] initWithCharacters:characters + selection.window.location length:selection.window.length];
+	NSString *snippetText = [NSString stringWithFormat:@"%@%@%@", prefix, windowText, suffix];
+	[windowText release];
+	
+	NSMutableArray *ranges = [NSMutableArray arrayWithCapacity:selection.highlightCount];
+	for (size_t i=0; i<selection.highlightCount; i++) {
+		NSRange range = NSMakeRange(selection.highlights[i].location - selection.window.location + [prefix length], selection.highlights[i].length);
+		[ranges addObject:[NSValue valueWithRange:range]];
+	}
+	
+	free(characters);
+	for (NSUInteger i=0; i<termCount; i++) {
+		free(termCharacters[i]);
+	}
+	
+	return [[[SearchSnippet alloc] initWithText:snippetText highlightRanges:ranges] autorelease];
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithText:(NSString *)aText highlightRanges:(NSArray *)someHighlightRanges {
+	if ((self = [super init])) {
+		text = [aText copy];
+		highlightRanges = [someHighlightRanges copy];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[text release];
+	[highlightRanges release];
+	
+	[super dealloc];
+}
+
+@end
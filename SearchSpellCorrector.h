@@ -0,0 +1,65 @@
+//
+//  SearchSpellCorrector.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import <Foundation/Foundation.h>
+
+#include "CompletionDictionary.h"
+
+#define kSearchSpellingFilename			@"spelling.dict"
+
+#define kSpellCandidateWordKey			@"word"
+#define kSpellCandidateEditDistanceKey	@"editDistance"
+#define kSpellCandidateFrequencyKey		@"frequency"
+
+
+/*
+ * Corrects misspelt query words against the words of the notes, using a
+ * memory mapped symmetric delete dictionary (see SpellDictionaryCreate()).
+ *
+ * Only words found in at least two notes are kept, up to a fixed size budget,
+ * so the dictionary stops growing once the common vocabulary is covered, and
+ * a lookup takes much the same time whatever the size of the notes.
+ */
+@interface SearchSpellCorrector : NSObject {
+@private
+	NSData	*dictionaryData;
+}
+
++ (BOOL)writeSpellingDictionaryForVocabulary:(const CompletionVocabulary *)vocabulary toFile:(NSString *)path;
+
+// Identifies the words of the vocabulary common enough to be in a spelling dictionary, which only needs rebuilding
+// when they change
++ (uint64_t)wordSetHashForVocabulary:(const CompletionVocabulary *)vocabulary;
+
+- (id)initWithContentsOfFile:(NSString *)path;
+
+// Dictionaries of word, edit distance and frequency (document count), best first
+- (NSArray *)candidatesForWord:(NSString *)word maxCandidates:(NSUInteger)maxCandidates;
+
+- (NSString *)correctionForWord:(NSString *)word;
+- (NSString *)correctedQueryString:(NSString *)queryString correctingLastWord:(BOOL)correctLastWord;
+
+@end
@@ -0,0 +1,180 @@
+//
+//  SearchSpellCorrector.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import "SearchSpellCorrector.h"
+
+#include "SpellDictionary.h"
+
+#define kMinDocumentFrequency		2
+#define kMaxDictionaryBytes			(512 * 1024)
+#define kPrefixLength				7
+#define kMinCorrectableLength		3
+#define kMaxCandidates				8
+
+
+@implementation SearchSpellCorrector
+
+/**
+ Builds a spelling dictionary from the vocabulary and writes it to path, replacing any dictionary already there.
+ Can be called from any thread.
+ */
++ (BOOL)writeSpellingDictionaryForVocabulary:(const CompletionVocabulary *)vocabulary toFile:(NSString *)path {
+	SpellDictionaryBudget budget;
+	budget.minDocumentFrequency = kMinDocumentFrequency;
+	budget.maxBytes = kMaxDictionaryBytes;
+	budget.maxEditDistance = kSpellMaxEditDistance;
+	budget.prefixLength = kPrefixLength;
+	
+	void *dictionary = NULL;
+	size_t dictionaryLength = 0;
+	if (!SpellDictionaryCreate(vocabulary, &budget, &dictionary, &dictionaryLength)) {
+		return NO;
+	}
+	DLog(@"Wrote %u of %u words (%u bytes) to %@", SpellDictionaryWordCount(dictionary), CompletionVocabularyTermCount(vocabulary),
+		 dictionaryLength, path);
+	
+	NSData *data = [[NSData alloc] initWithBytesNoCopy:dictionary length:dictionaryLength freeWhenDone:YES];
+	BOOL written = [data writeToFile:path atomically:YES];
+	[data release];
+	return written;
+}
+
++ (uint64_t)wordSetHashForVocabulary:(const CompletionVocabulary *)vocabulary {
+	return CompletionVocabularyTermSetHash(vocabulary, kMinDocumentFrequency);
+}
+
+- (NSArray *)candidatesForWord:(NSString *)word maxCandidates:(NSUInteger)maxCandidates {
+	const char *wordBytes = [[word lowercaseString] UTF8String];
+	if (wordBytes == NULL) {
+		return [NSArray array];
+	}
+	
+	// Short words have too many neighbours two edits away to correct usefully
+	size_t wordLength = strlen(wordBytes);
+	unsigned maxEditDistance = (wordLength <= 4 ? 1 : kSpellMaxEditDistance);
+	
+	SpellCandidate candidates[kMaxCandidates];
+	size_t count = SpellDictionaryLookup([dictionaryData bytes], [dictionaryData length], wordBytes, wordLength, maxEditDistance,
+										 candidates, MIN(maxCandidates, kMaxCandidates));
+	
+	NSMutableArray *results = [NSMutableArray arrayWithCapacity:count];
+	for (size_t i=0; i<count; i++) {
+		NSString *candidateWord = [NSString stringWithUTF8String:candidates[i].word];
+		if (candidateWord) {
+			[results addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+								candidateWord, kSpellCandidateWordKey,
+								[NSNumber numberWithUnsignedInt:candidates[i].editDistance], kSpellCandidateEditDistanceKey,
+								[NSNumber numberWithUnsignedInt:candidates[i].documentFrequency], kSpellCandidateFrequencyKey,
+								nil]];
+		}
+	}
+	return results;
+}
+
+/**
+ Returns the best correction for a plain word, or nil if it is spelt correctly, can't be corrected or isn't a word.
+ */
+- (NSString *)correctionForWord:(NSString *)word {
+	if ([word length] < kMinCorrectableLength || [word rangeOfCharacterFromSet:[[NSCharacterSet letterCharacterSet] invertedSet]].location != NSNotFound) {
+		return nil;
+	}
+	NSArray *candidates = [self candidatesForWord:word maxCandidates:1];
+	if ([candidates count] == 0) {
+		return nil;
+	}
+	NSDictionary *best = [candidates objectAtIndex:0];
+	if ([[best objectForKey:kSpellCandidateEditDistanceKey] unsignedIntValue] == 0) {
+		return nil;
+	}
+	return [best objectForKey:kSpellCandidateWordKey];
+}
+
+/**
+ Returns the query with its misspelt words corrected, or nil if there was nothing to correct.  Queries using any
+ syntax beyond plain words are left alone, as is the last word unless correctLastWord is set (it may still be
+ being typed).
+ */
+- (NSString *)correctedQueryString:(NSString *)queryString correctingLastWord:(BOOL)correctLastWord {
+	NSCharacterSet *syntaxCharacters = [NSCharacterSet characterSetWithCharactersInString:@"\"()*:+-"];
+	if ([queryString rangeOfCharacterFromSet:syntaxCharacters].location != NSNotFound) {
+		return nil;
+	}
+	
+	NSArray *words = [queryString componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+	NSMutableArray *correctedWords = [NSMutableArray arrayWithCapacity:[words count]];
+	BOOL corrected = NO;
+	NSUInteger lastWordIndex = NSNotFound;
+	for (NSUInteger i=0; i<[words count]; i++) {
+		if ([[words objectAtIndex:i] length] > 0) {
+			lastWordIndex = i;
+		}
+	}
+	
+	for (NSUInteger i=0; i<[words count]; i++) {
+		NSString *word = [words objectAtIndex:i];
+		if ([word length] == 0) {
+			continue;
+		}
+		if ([word isEqualToString:@"AND"] || [word isEqualToString:@"OR"] || [word isEqualToString:@"NOT"]) {
+			return nil;
+		}
+		NSString *correction = ((i != lastWordIndex || correctLastWord) ? [self correctionForWord:word] : nil);
+		if (correction) {
+			[correctedWords addObject:correction];
+			corrected = YES;
+		}
+		else {
+			[correctedWords addObject:word];
+		}
+	}
+	
+	return (corrected ? [correctedWords componentsJoinedByString:@" "] : nil);
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithContentsOfFile:(NSString *)path {
+	NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:NULL];
+	if (!SpellDictionaryIsValid([data bytes], [data length])) {
+		[self release];
+		return nil;
+	}
+	
+	if ((self = [super init])) {
+		dictionaryData = [data retain];
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[dictionaryData release];
+	
+	[super dealloc];
+}
+
+@end
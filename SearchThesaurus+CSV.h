@@ -0,0 +1,49 @@
+//
+//  SearchThesaurus+CSV.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import <Foundation/Foundation.h>
+#import "SearchThesaurus.h"
+
+typedef void (^SearchThesaurusImportProgress)(unsigned long long bytesRead, unsigned long long totalBytes, NSUInteger rowCount);
+typedef void (^SearchThesaurusImportCompletion)(NSUInteger rowCount, NSUInteger skippedRowCount, NSError *error);
+
+
+/*
+ * Bulk import and export of synonyms as comma separated values, one row of
+ * term,synonym,... per line - the format the locthesaurus tool reads.
+ *
+ * Files are streamed in fixed size chunks, so hundreds of thousands of rows
+ * can be loaded without holding the file, or more than one batch of parsed
+ * rows, in memory.
+ */
+@interface SearchThesaurus ( CSV )
+
+- (void)importSynonymsFromCSVFileAtPath:(NSString *)csvPath
+							   progress:(SearchThesaurusImportProgress)progress
+							 completion:(SearchThesaurusImportCompletion)completion;
+- (BOOL)exportSynonymsToCSVFileAtPath:(NSString *)csvPath error:(NSError **)error;
+
+@end
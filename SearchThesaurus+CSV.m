@@ -0,0 +1,225 @@
+//
+//  SearchThesaurus+CSV.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import "SearchThesaurus+CSV.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include "CSVReader.h"
+
+#define kCSVChunkSize			(64 * 1024)
+#define kCSVMaxRowLength		(16 * 1024)
+#define kCSVMaxFieldCount		256
+#define kImportBatchSize		1000	// rows added to the thesaurus at a time
+
+
+typedef struct {
+	SearchThesaurus					*thesaurus;
+	NSMutableArray					*batch;
+	NSUInteger						rowCount;
+	unsigned long long				bytesRead;
+	unsigned long long				totalBytes;
+	SearchThesaurusImportProgress	progress;
+} CSVImportContext;
+
+
+/**
+ Adds the batch of parsed rows to the thesaurus, on the main thread which owns it, and reports progress.  The reader
+ waits meanwhile, so no more than one batch is ever held.
+ */
+static void CSVImportFlushBatch(CSVImportContext *import) {
+	if ([import->batch count] == 0) {
+		return;
+	}
+	import->rowCount += [import->batch count];
+	dispatch_sync(dispatch_get_main_queue(), ^{
+		[import->thesaurus addRows:import->batch];
+		if (import->progress) {
+			import->progress(import->bytesRead, import->totalBytes, import->rowCount);
+		}
+	});
+	[import->batch removeAllObjects];
+}
+
+static int CSVImportRow(const char *const *fields, const size_t *fieldLengths, size_t fieldCount, void *context) {
+	CSVImportContext *import = context;
+	
+	NSMutableArray *row = [[NSMutableArray alloc] initWithCapacity:fieldCount];
+	for (size_t i = 0; i < fieldCount; i++) {
+		NSString *field = [[NSString alloc] initWithBytes:fields[i] length:fieldLengths[i] encoding:NSUTF8StringEncoding];
+		if (field) {
+			[row addObject:field];
+			[field release];
+		}
+	}
+	[import->batch addObject:row];
+	[row release];
+	
+	if ([import->batch count] >= kImportBatchSize) {
+		@autoreleasepool {
+			CSVImportFlushBatch(import);
+		}
+	}
+	return 1;
+}
+
+/**
+ Quotes a field if it needs to be, doubling any quotes in it.
+ */
+static NSString *CSVField(NSString *string) {
+	if ([string rangeOfCharacterFromSet:[NSCharacterSet characterSetWithCharactersInString:@",\"\r\n"]].location == NSNotFound) {
+		return string;
+	}
+	return [NSString stringWithFormat:@"\"%@\"", [string stringByReplacingOccurrencesOfString:@"\"" withString:@"\"\""]];
+}
+
+
+@implementation SearchThesaurus ( CSV )
+
+/**
+ Reads rows from the file in the background and adds them to the thesaurus in batches, replacing the synonyms of terms
+ already there, then saves it once at the end.  Must be called on the main thread; progress and completion are called
+ on it too.  Rows that are too long, or have no synonyms, are skipped.
+ */
+- (void)importSynonymsFromCSVFileAtPath:(NSString *)csvPath
+							   progress:(SearchThesaurusImportProgress)progress
+							 completion:(SearchThesaurusImportCompletion)completion {
+	progress = [[progress copy] autorelease];
+	completion = [[completion copy] autorelease];
+	NSUInteger originalGeneration = self.generation;
+	
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+		NSTimeInterval startTime = [NSDate timeIntervalSinceReferenceDate];
+		NSError *error = nil;
+		
+		CSVImportContext import;
+		import.thesaurus = self;
+		import.batch = [[NSMutableArray alloc] initWithCapacity:kImportBatchSize];
+		import.rowCount = 0;
+		import.bytesRead = 0;
+		import.totalBytes = [[[NSFileManager defaultManager] attributesOfItemAtPath:csvPath error:NULL] fileSize];
+		import.progress = progress;
+		
+		CSVReader *reader = CSVReaderCreate(kCSVMaxRowLength, kCSVMaxFieldCount);
+		FILE *file = fopen([csvPath fileSystemRepresentation], "rb");
+		char *chunk = malloc(kCSVChunkSize);
+		if (reader && file && chunk) {
+			size_t chunkLength;
+			while ((chunkLength = fread(chunk, 1, kCSVChunkSize, file)) > 0) {
+				import.bytesRead += chunkLength;
+				CSVReaderFeed(reader, chunk, chunkLength, CSVImportRow, &import);
+			}
+			if (ferror(file)) {
+				error = [NSError errorWithDomain:NSPOSIXErrorDomain code:EIO userInfo:nil];
+			}
+			CSVReaderFinish(reader, CSVImportRow, &import);
+			CSVImportFlushBatch(&import);
+		}
+		else {
+			error = [NSError errorWithDomain:NSPOSIXErrorDomain code:(file ? ENOMEM : errno) userInfo:nil];
+		}
+		
+		NSUInteger rowCount = import.rowCount;
+		NSUInteger skippedRowCount = (reader ? CSVReaderSkippedRowCount(reader) : 0);
+		[import.batch release];
+		free(chunk);
+		if (file) {
+			fclose(file);
+		}
+		CSVReaderFree(reader);
+		
+		dispatch_async(dispatch_get_main_queue(), ^{
+			DLog(@"Imported %u synonym rows (%u skipped) from %@ in %.3fs", rowCount, skippedRowCount, csvPath,
+				 [NSDate timeIntervalSinceReferenceDate] - startTime);
+			
+			// Written once, atomically, rather than after every batch
+			if (self.generation != originalGeneration) {
+				[self save];
+				[[NSNotificationCenter defaultCenter] postNotificationName:kSearchThesaurusDidChangeNotification object:self];
+			}
+			if (completion) {
+				completion(rowCount, skippedRowCount, error);
+			}
+		});
+	});
+}
+
+/**
+ Writes the thesaurus to the file sorted by term, a chunk at a time, replacing the file only once it has all been
+ written.
+ */
+- (BOOL)exportSynonymsToCSVFileAtPath:(NSString *)csvPath error:(NSError **)error {
+	NSString *temporaryPath = [csvPath stringByAppendingPathExtension:@"tmp"];
+	FILE *file = fopen([temporaryPath fileSystemRepresentation], "wb");
+	if (NULL == file) {
+		if (error) {
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:nil];
+		}
+		return NO;
+	}
+	
+	BOOL written = YES;
+	NSMutableData *chunk = [[NSMutableData alloc] initWithCapacity:kCSVChunkSize];
+	for (NSArray *row in [self rows]) {
+		@autoreleasepool {
+			NSMutableArray *fields = [[NSMutableArray alloc] initWithCapacity:[row count]];
+			for (NSString *string in row) {
+				[fields addObject:CSVField(string)];
+			}
+			[chunk appendData:[[[fields componentsJoinedByString:@","] stringByAppendingString:@"\n"] dataUsingEncoding:NSUTF8StringEncoding]];
+			[fields release];
+		}
+		if ([chunk length] >= kCSVChunkSize) {
+			written = (fwrite([chunk bytes], 1, [chunk length], file) == [chunk length]);
+			[chunk setLength:0];
+			if (!written) {
+				break;
+			}
+		}
+	}
+	if (written && [chunk length] > 0) {
+		written = (fwrite([chunk bytes], 1, [chunk length], file) == [chunk length]);
+	}
+	[chunk release];
+	
+	int savedErrno = errno;
+	written = (fclose(file) == 0) && written;
+	if (written && rename([temporaryPath fileSystemRepresentation], [csvPath fileSystemRepresentation]) != 0) {
+		savedErrno = errno;
+		written = NO;
+	}
+	if (!written) {
+		unlink([temporaryPath fileSystemRepresentation]);
+		if (error) {
+			*error = [NSError errorWithDomain:NSPOSIXErrorDomain code:savedErrno userInfo:nil];
+		}
+	}
+	return written;
+}
+
+@end
@@ -0,0 +1,78 @@
+//
+//  SearchThesaurus.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import <Foundation/Foundation.h>
+
+#define kSearchThesaurusFilename				@"synonyms.plist"
+#define kSearchThesaurusDidChangeNotification	@"kSearchThesaurusDidChangeNotification"
+
+
+/*
+ * The synonyms search queries are expanded with.
+ *
+ * Rows of the form (term, synonym, ...) are kept sorted by term, changed one
+ * at a time or added in batches, and saved as a property list in the search
+ * database directory.  Terms are unique ignoring case.
+ *
+ * Rather than leaving the search engine to look up synonyms for every query
+ * (its thesaurus can only be rewritten whole, not edited), queries are
+ * expanded here from a compiled map of term to query clause.  The map is only
+ * rebuilt when the thesaurus generation changes, and each term expands to at
+ * most kMaxSynonymExpansion synonyms.
+ *
+ * Must only be used from the main thread.
+ */
+@interface SearchThesaurus : NSObject {
+	NSString				*path;
+	
+@private
+	NSMutableDictionary		*rowsByTerm;			// keyed by lowercased term
+	NSMutableArray			*sortedRows;			// built when needed
+	NSUInteger				generation;
+	NSDictionary			*expansionMap;
+	NSUInteger				expansionMapGeneration;
+}
+
+@property (nonatomic, copy, readonly)	NSString	*path;
+
+// Incremented every time the synonyms change
+@property (nonatomic, readonly)			NSUInteger	generation;
+
+- (id)initWithPath:(NSString *)aPath;
+- (BOOL)importSynonymsFromSearchDatabaseAtPath:(NSString *)databasePath;
+- (BOOL)save;
+
+- (NSUInteger)count;
+- (NSArray *)rows;
+- (NSArray *)synonymsForTerm:(NSString *)term;
+- (void)setSynonyms:(NSArray *)synonyms forTerm:(NSString *)term;
+- (void)removeSynonymsForTerm:(NSString *)term;
+- (NSUInteger)addRows:(NSArray *)rows;
+- (NSUInteger)applyEditedRows:(NSArray *)editedRows;
+
+- (NSString *)expandedQueryString:(NSString *)queryString;
+
+@end
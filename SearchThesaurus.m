@@ -0,0 +1,363 @@
+//
+//  SearchThesaurus.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#import "SearchThesaurus.h"
+#import <LocaytaSearch/LSLocaytaSearchThesaurus.h>
+
+#define kMaxSynonymExpansion	8		// synonyms a query term expands to, at most
+
+
+@interface SearchThesaurus ()
+- (NSMutableArray *)sortedRows;
+- (NSUInteger)indexOfRowForTerm:(NSString *)term insertionIndex:(BOOL)insertionIndex;
+@end
+
+
+@implementation SearchThesaurus
+
+@synthesize path;
+@synthesize generation;
+
+/**
+ Rows are considered equal ignoring the case of their terms, as terms are unique ignoring case.
+ */
+static NSComparisonResult compareRowTerms(NSArray *row1, NSArray *row2) {
+	return [[row1 objectAtIndex:0] localizedCaseInsensitiveCompare:[row2 objectAtIndex:0]];
+}
+
+/**
+ Returns the row's synonyms with blanks and duplicates removed, or nil if the row isn't a term and at least one synonym.
+ */
+static NSArray *cleanedRow(NSArray *row) {
+	if (![row isKindOfClass:[NSArray class]] || [row count] < 2) {
+		return nil;
+	}
+	NSMutableArray *cleaned = [NSMutableArray arrayWithCapacity:[row count]];
+	for (NSString *string in row) {
+		if (![string isKindOfClass:[NSString class]]) {
+			return nil;
+		}
+		NSString *trimmed = [string stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+		if ([trimmed length] == 0) {
+			if ([cleaned count] == 0) {
+				return nil;		// no term
+			}
+			continue;
+		}
+		if ([cleaned count] == 0 || ![cleaned containsObject:trimmed]) {
+			[cleaned addObject:trimmed];
+		}
+	}
+	return ([cleaned count] >= 2 ? cleaned : nil);
+}
+
+/**
+ The rows sorted by term.  Rows added in batches are sorted together when next needed, rather than inserted one by one.
+ */
+- (NSMutableArray *)sortedRows {
+	if (nil == sortedRows) {
+		sortedRows = [[NSMutableArray alloc] initWithArray:[rowsByTerm allValues]];
+		[sortedRows sortUsingComparator:^(id row1, id row2) {
+			return compareRowTerms(row1, row2);
+		}];
+	}
+	return sortedRows;
+}
+
+- (NSUInteger)indexOfRowForTerm:(NSString *)term insertionIndex:(BOOL)insertionIndex {
+	NSMutableArray *rows = [self sortedRows];
+	return [rows indexOfObject:[NSArray arrayWithObject:term]
+				 inSortedRange:NSMakeRange(0, [rows count])
+					   options:(insertionIndex ? NSBinarySearchingInsertionIndex : NSBinarySearchingFirstEqual)
+			   usingComparator:^(id row1, id row2) {
+				   return compareRowTerms(row1, row2);
+			   }];
+}
+
+
+#pragma mark -
+#pragma mark Loading and saving
+
+/**
+ Moves the synonyms out of the search engine's own thesaurus, so that the engine no longer expands queries itself.
+ Only needed once, for search databases made before queries were expanded here.
+ */
+- (BOOL)importSynonymsFromSearchDatabaseAtPath:(NSString *)databasePath {
+	LSLocaytaSearchThesaurus *databaseThesaurus = [[LSLocaytaSearchThesaurus alloc] initWithDatabasePath:databasePath];
+	NSDictionary *synonyms = [databaseThesaurus getSynonyms];
+	NSMutableArray *rows = [NSMutableArray arrayWithCapacity:[synonyms count]];
+	for (NSString *term in synonyms) {
+		[rows addObject:[[NSArray arrayWithObject:term] arrayByAddingObjectsFromArray:[synonyms objectForKey:term]]];
+	}
+	[self addRows:rows];
+	
+	BOOL saved = [self save];
+	if (saved) {
+		[databaseThesaurus clearSynonyms];
+	}
+	[databaseThesaurus release];
+	
+	DLog(@"Imported %u synonyms from %@", [synonyms count], databasePath);
+	return saved;
+}
+
+- (BOOL)save {
+	return [[self sortedRows] writeToFile:self.path atomically:YES];
+}
+
+
+#pragma mark -
+#pragma mark Rows
+
+- (NSUInteger)count {
+	return [rowsByTerm count];
+}
+
+/**
+ All the rows, sorted by term.
+ */
+- (NSArray *)rows {
+	return [[[self sortedRows] copy] autorelease];
+}
+
+- (NSArray *)synonymsForTerm:(NSString *)term {
+	NSArray *row = [rowsByTerm objectForKey:[term lowercaseString]];
+	return (row ? [row subarrayWithRange:NSMakeRange(1, [row count] - 1)] : nil);
+}
+
+/**
+ Adds the term, or replaces its synonyms if it's already there.  Setting no synonyms removes the term.
+ */
+- (void)setSynonyms:(NSArray *)synonyms forTerm:(NSString *)term {
+	NSArray *row = cleanedRow([[NSArray arrayWithObject:(term ? term : @"")] arrayByAddingObjectsFromArray:synonyms]);
+	if (nil == row) {
+		[self removeSynonymsForTerm:term];
+		return;
+	}
+	
+	NSString *key = [[row objectAtIndex:0] lowercaseString];
+	NSArray *existingRow = [rowsByTerm objectForKey:key];
+	if ([existingRow isEqualToArray:row]) {
+		return;
+	}
+	
+	NSUInteger index = (existingRow ? [self indexOfRowForTerm:[row objectAtIndex:0] insertionIndex:NO] : NSNotFound);
+	if (index != NSNotFound) {
+		[[self sortedRows] replaceObjectAtIndex:index withObject:row];
+	}
+	else {
+		[[self sortedRows] insertObject:row atIndex:[self indexOfRowForTerm:[row objectAtIndex:0] insertionIndex:YES]];
+	}
+	[rowsByTerm setObject:row forKey:key];
+	generation++;
+}
+
+- (void)removeSynonymsForTerm:(NSString *)term {
+	NSString *key = [term lowercaseString];
+	if (nil == key || nil == [rowsByTerm objectForKey:key]) {
+		return;
+	}
+	
+	NSUInteger index = [self indexOfRowForTerm:term insertionIndex:NO];
+	if (index != NSNotFound) {
+		[[self sortedRows] removeObjectAtIndex:index];
+	}
+	[rowsByTerm removeObjectForKey:key];
+	generation++;
+}
+
+/**
+ Adds a batch of rows of the form (term, synonym, ...), replacing the synonyms of terms already there.  Returns the
+ number of rows changed.
+ */
+- (NSUInteger)addRows:(NSArray *)rows {
+	NSUInteger changeCount = 0;
+	for (NSArray *addedRow in rows) {
+		NSArray *row = cleanedRow(addedRow);
+		if (nil == row) {
+			continue;
+		}
+		NSString *key = [[row objectAtIndex:0] lowercaseString];
+		if (![[rowsByTerm objectForKey:key] isEqualToArray:row]) {
+			[rowsByTerm setObject:row forKey:key];
+			changeCount++;
+		}
+	}
+	
+	if (changeCount > 0) {
+		[sortedRows release];
+		sortedRows = nil;
+		generation++;
+	}
+	return changeCount;
+}
+
+/**
+ Brings the thesaurus in line with a whole edited set of rows, by adding, replacing and removing only the rows that
+ differ.  Returns the number of rows changed.
+ */
+- (NSUInteger)applyEditedRows:(NSArray *)editedRows {
+	NSUInteger originalGeneration = generation;
+	
+	NSMutableDictionary *editedRowsByTerm = [NSMutableDictionary dictionaryWithCapacity:[editedRows count]];
+	for (NSArray *editedRow in editedRows) {
+		NSArray *row = cleanedRow(editedRow);
+		if (row) {
+			[editedRowsByTerm setObject:row forKey:[[row objectAtIndex:0] lowercaseString]];
+		}
+	}
+	
+	for (NSString *key in [rowsByTerm allKeys]) {
+		if (nil == [editedRowsByTerm objectForKey:key]) {
+			[self removeSynonymsForTerm:[[rowsByTerm objectForKey:key] objectAtIndex:0]];
+		}
+	}
+	for (NSString *key in editedRowsByTerm) {
+		NSArray *row = [editedRowsByTerm objectForKey:key];
+		[self setSynonyms:[row subarrayWithRange:NSMakeRange(1, [row count] - 1)] forTerm:[row objectAtIndex:0]];
+	}
+	
+	return generation - originalGeneration;
+}
+
+
+#pragma mark -
+#pragma mark Query expansion
+
+/**
+ Returns the word as it should appear in a query clause, quoting phrases, or nil if it can't be used.
+ */
+static NSString *queryClauseTerm(NSString *word) {
+	if ([word rangeOfCharacterFromSet:[NSCharacterSet characterSetWithCharactersInString:@"\"()"]].location != NSNotFound) {
+		return nil;
+	}
+	NSString *lowercaseWord = [word lowercaseString];
+	if ([lowercaseWord rangeOfCharacterFromSet:[NSCharacterSet whitespaceCharacterSet]].location != NSNotFound) {
+		return [NSString stringWithFormat:@"\"%@\"", lowercaseWord];
+	}
+	return lowercaseWord;
+}
+
+/**
+ The compiled map of lowercased term to the query clause it expands to, e.g. "ospf" to
+ (ospf OR "open shortest path first").
+ */
+- (NSDictionary *)expansionMap {
+	if (expansionMap && expansionMapGeneration == generation) {
+		return expansionMap;
+	}
+	
+	NSMutableDictionary *newExpansionMap = [NSMutableDictionary dictionaryWithCapacity:[rowsByTerm count]];
+	for (NSString *key in rowsByTerm) {
+		NSString *term = queryClauseTerm(key);
+		if (nil == term) {
+			continue;
+		}
+		NSMutableArray *clauseTerms = [NSMutableArray arrayWithObject:term];
+		NSArray *row = [rowsByTerm objectForKey:key];
+		for (NSUInteger i=1; i<[row count] && [clauseTerms count] <= kMaxSynonymExpansion; i++) {
+			NSString *synonym = queryClauseTerm([row objectAtIndex:i]);
+			if (synonym && ![clauseTerms containsObject:synonym]) {
+				[clauseTerms addObject:synonym];
+			}
+		}
+		if ([clauseTerms count] > 1) {
+			[newExpansionMap setObject:[NSString stringWithFormat:@"(%@)", [clauseTerms componentsJoinedByString:@" OR "]] forKey:key];
+		}
+	}
+	
+	[expansionMap release];
+	expansionMap = [newExpansionMap copy];
+	expansionMapGeneration = generation;
+	DLog(@"Compiled %u synonym expansions (generation %u)", [expansionMap count], generation);
+	return expansionMap;
+}
+
+/**
+ Returns the query with each plain word that has synonyms replaced by a clause matching it or any of them, or nil if
+ no word has synonyms.  Words in phrases, and operators, are left alone.
+ */
+- (NSString *)expandedQueryString:(NSString *)queryString {
+	if ([rowsByTerm count] == 0) {
+		return nil;
+	}
+	NSDictionary *map = [self expansionMap];
+	
+	NSArray *words = [queryString componentsSeparatedByCharactersInSet:[NSCharacterSet whitespaceCharacterSet]];
+	NSMutableArray *expandedWords = [NSMutableArray arrayWithCapacity:[words count]];
+	NSCharacterSet *wordCharacters = [NSCharacterSet alphanumericCharacterSet];
+	BOOL inPhrase = NO;
+	BOOL expanded = NO;
+	for (NSString *word in words) {
+		if ([word length] == 0) {
+			continue;
+		}
+		NSString *expansion = nil;
+		if (!inPhrase && [[word stringByTrimmingCharactersInSet:wordCharacters] length] == 0 &&
+			![word isEqualToString:@"AND"] && ![word isEqualToString:@"OR"] && ![word isEqualToString:@"NOT"]) {
+			expansion = [map objectForKey:[word lowercaseString]];
+		}
+		if (expansion) {
+			[expandedWords addObject:expansion];
+			expanded = YES;
+		}
+		else {
+			[expandedWords addObject:word];
+		}
+		
+		// An odd number of quotes opens or closes a phrase
+		if ([[word componentsSeparatedByString:@"\""] count] % 2 == 0) {
+			inPhrase = !inPhrase;
+		}
+	}
+	
+	return (expanded ? [expandedWords componentsJoinedByString:@" "] : nil);
+}
+
+
+#pragma mark -
+#pragma mark Object lifecycle
+
+- (id)initWithPath:(NSString *)aPath {
+	if ((self = [super init])) {
+		path = [aPath copy];
+		rowsByTerm = [[NSMutableDictionary alloc] init];
+		[self addRows:[NSArray arrayWithContentsOfFile:aPath]];
+		generation = 0;
+	}
+	return self;
+}
+
+- (void)dealloc {
+	[path release];
+	[rowsByTerm release];
+	[sortedRows release];
+	[expansionMap release];
+	
+	[super dealloc];
+}
+
+@end
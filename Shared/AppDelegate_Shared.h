@@ -28,12 +28,21 @@
 #import <UIKit/UIKit.h>
 #import <CoreData/CoreData.h>
 
+#import "BulkNoteImporter.h"
+
+@class NoteDocumentStore;
+@class NoteSaveQueue;
 @class SearchDatabaseRequester;
 @class SearchDatabaseUpdater;
+@class SearchThesaurus;
 
-@interface AppDelegate_Shared : NSObject <UIApplicationDelegate> {
+@interface AppDelegate_Shared : NSObject <UIApplicationDelegate, BulkNoteImporterDelegate> {
+	BulkNoteImporter				*bulkNoteImporter;
+	NoteDocumentStore				*noteDocumentStore;
+	NoteSaveQueue					*noteSaveQueue;
 	SearchDatabaseRequester			*searchDatabaseRequester;
 	SearchDatabaseUpdater			*searchDatabaseUpdater;
+	SearchThesaurus					*searchThesaurus;
     
     NSManagedObjectModel *managedObjectModel;
     NSManagedObjectContext *managedObjectContext;	    
@@ -42,9 +51,13 @@
     UIWindow *window;
 }
 
+@property (nonatomic, retain)	BulkNoteImporter				*bulkNoteImporter;
 @property (nonatomic, assign)	BOOL							enableAutoSpellCorrection;
+@property (nonatomic, retain, readonly)	NoteDocumentStore		*noteDocumentStore;
+@property (nonatomic, retain)	NoteSaveQueue					*noteSaveQueue;
 @property (nonatomic, retain)	SearchDatabaseRequester			*searchDatabaseRequester;
 @property (nonatomic, retain)	SearchDatabaseUpdater			*searchDatabaseUpdater;
+@property (nonatomic, retain)	SearchThesaurus					*searchThesaurus;
 
 @property (nonatomic, retain, readonly) NSManagedObjectModel *managedObjectModel;
 @property (nonatomic, retain, readonly) NSManagedObjectContext *managedObjectContext;
@@ -54,6 +67,9 @@
 
 + (AppDelegate_Shared *)sharedAppDelegate;
 - (NSString *)searchDatabasePath;
+- (NSString *)notesStorePath;
+- (BOOL)installPrebuiltDatabases;
+- (void)packPrebuiltDatabases;
 - (void)setUpSearchDatabase;
 - (NSString *)applicationDocumentsDirectory;
 - (void) readAndIndex;
@@ -28,38 +28,43 @@
 #import <LocaytaSearch/LSLocaytaSearchIndexer.h>
 
 #import "AppDelegate_Shared.h"
+#import "NoteDocumentStore.h"
+#import "NoteSaveQueue.h"
 #import "SearchDatabaseRequester.h"
 #import "SearchDatabaseUpdater.h"
+#import "SearchThesaurus.h"
 #import "Note.h"
 #import "Note+Management.h"
 
+#define kNotesStoreFilename					@"LocNotes.sqlite"
+#define kSearchDatabaseDirectoryName		@"search_db"
+#define kPrebuiltDatabasesDirectoryName		@"prebuilt"
+#define kPackPrebuiltDatabasesDefaultsKey	@"PackPrebuiltDatabases"
+#define kOffsetMapsDirectoryName			@"offset_maps"
+
 
 @implementation AppDelegate_Shared
 
+@synthesize bulkNoteImporter;
 @synthesize enableAutoSpellCorrection;
+@synthesize noteSaveQueue;
 @synthesize searchDatabaseRequester;
 @synthesize searchDatabaseUpdater;
+@synthesize searchThesaurus;
 
 @synthesize window;
 
-NSMutableArray *_files;
-
 - (void) readAndIndex {
-    NSString *resourcePath = [[[NSBundle mainBundle] resourcePath] stringByAppendingString:@"/html"];
-    NSLog(@"ResPath %@", resourcePath);
-    _files = [NSMutableArray new];
-    NSString *path = [[NSString stringWithFormat:@"file://%@", resourcePath] stringByAddingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
-    NSDirectoryEnumerator *enumerator = [[NSFileManager defaultManager] enumeratorAtURL:[NSURL URLWithString:path] includingPropertiesForKeys:nil options:NSDirectoryEnumerationSkipsHiddenFiles errorHandler: nil];
-    NSError *error;
-    for (NSURL *url in enumerator) {
-        if ([[url pathExtension] isEqualToString:@"xhtml"]){
-            Note *note = [[Note alloc] initWithEntity:[NSEntityDescription entityForName:@"Note" inManagedObjectContext:self.managedObjectContext] insertIntoManagedObjectContext:managedObjectContext];
-            note.title = url.lastPathComponent;
-            note.content = [NSString stringWithContentsOfURL:url encoding:NSUTF8StringEncoding error: &error];
-            [note saveNote];
-            [_files addObject:url];
-        }
-    }
+    DLog(@"Importing notes from \"%@\"", self.noteDocumentStore.directoryPath);
+	
+	// Import runs in the background and commits in batches, so launch isn't blocked
+	BulkNoteImporter *importer = [[BulkNoteImporter alloc] initWithManagedObjectContext:self.managedObjectContext
+																searchDatabaseUpdater:self.searchDatabaseUpdater];
+	importer.delegate = self;
+	self.bulkNoteImporter = importer;
+	[importer release];
+	
+	[self.bulkNoteImporter importDocumentsFromStore:self.noteDocumentStore];
 }
 
 + (AppDelegate_Shared *)sharedAppDelegate {
@@ -70,11 +75,106 @@ NSMutableArray *_files;
 - (NSString *)searchDatabasePath {
 	NSArray *documentPaths = NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES);
 	NSString *documentsDir = [documentPaths objectAtIndex:0];
-	NSString *searchDatabasePath = [documentsDir stringByAppendingPathComponent:@"search_db"];
+	NSString *searchDatabasePath = [documentsDir stringByAppendingPathComponent:kSearchDatabaseDirectoryName];
 	return searchDatabasePath;
 }
 
+- (NSString *)notesStorePath {
+	return [[self applicationDocumentsDirectory] stringByAppendingPathComponent:kNotesStoreFilename];
+}
+
+
+#pragma mark -
+#pragma mark Prebuilt databases
+
+/**
+ Installs the notes store and search database bundled under Resources/prebuilt, if the app has neither yet.
+ 
+ The two are built together (see packPrebuiltDatabases) so the note IDs in the search database match the
+ object IDs in the store.  Installing them is a file copy, so the first launch does no importing or indexing.
+ Returns YES if the prebuilt databases were installed.
+ */
+- (BOOL)installPrebuiltDatabases {
+	NSFileManager *fileManager = [NSFileManager defaultManager];
+	NSString *prebuiltPath = [[[NSBundle mainBundle] resourcePath] stringByAppendingPathComponent:kPrebuiltDatabasesDirectoryName];
+	NSString *prebuiltStorePath = [prebuiltPath stringByAppendingPathComponent:kNotesStoreFilename];
+	NSString *prebuiltSearchDatabasePath = [prebuiltPath stringByAppendingPathComponent:kSearchDatabaseDirectoryName];
+	
+	if ([fileManager fileExistsAtPath:[self notesStorePath]] || [fileManager fileExistsAtPath:[self searchDatabasePath]]) {
+		return NO;
+	}
+	if (![fileManager fileExistsAtPath:prebuiltStorePath] || ![LSLocaytaSearchIndexer databaseExistsAtPath:prebuiltSearchDatabasePath]) {
+		return NO;
+	}
+	
+	NSError *error = nil;
+	if (![fileManager copyItemAtPath:prebuiltStorePath toPath:[self notesStorePath] error:&error] ||
+		![fileManager copyItemAtPath:prebuiltSearchDatabasePath toPath:[self searchDatabasePath] error:&error]) {
+		DLog(@"Failed to install prebuilt databases: %@", [error localizedDescription]);
+		
+		// Don't leave one without the other - fall back to importing
+		[fileManager removeItemAtPath:[self notesStorePath] error:NULL];
+		[fileManager removeItemAtPath:[self searchDatabasePath] error:NULL];
+		return NO;
+	}
+	
+	DLog(@"Installed prebuilt databases from \"%@\"", prebuiltPath);
+	return YES;
+}
+
+/**
+ Writes the current notes store and search database to Documents/prebuilt, ready to be added to the
+ project as Resources/prebuilt.
+ 
+ Run the app in the simulator with an empty Documents directory and the launch argument
+ "-PackPrebuiltDatabases YES"; the databases are packed once the bundled notes have been imported, and the
+ note index and the completion and spelling dictionaries in the search database directory built from them.
+ The store is left in rollback journal mode, with its managed objects invalidated, so quit the app afterwards.
+ */
+- (void)packPrebuiltDatabases {
+	NSFileManager *fileManager = [NSFileManager defaultManager];
+	NSString *packPath = [[self applicationDocumentsDirectory] stringByAppendingPathComponent:kPrebuiltDatabasesDirectoryName];
+	
+	// Indexing is asynchronous, so make sure the last batch has been written
+	[self.searchDatabaseUpdater.notesSearchIndexer waitUntilIndexingIsFinished];
+	
+	// Saved changes can still be in the store's write-ahead log, beside it; opening it again in rollback journal mode
+	// checkpoints them into the store file and removes the log, so copying that one file takes every note
+	NSError *error = nil;
+	NSPersistentStoreCoordinator *coordinator = self.persistentStoreCoordinator;
+	NSURL *storeURL = [NSURL fileURLWithPath:[self notesStorePath]];
+	NSPersistentStore *store = [coordinator persistentStoreForURL:storeURL];
+	NSDictionary *options = [NSDictionary dictionaryWithObject:[NSDictionary dictionaryWithObject:@"DELETE" forKey:@"journal_mode"]
+														forKey:NSSQLitePragmasOption];
+	if (![self.managedObjectContext save:&error] ||
+		(store && ![coordinator removePersistentStore:store error:&error]) ||
+		![coordinator addPersistentStoreWithType:NSSQLiteStoreType configuration:nil URL:storeURL options:options error:&error]) {
+		ALog(@"Failed to checkpoint the notes store: %@", [error localizedDescription]);
+		return;
+	}
+	
+	// The fingerprints of the indexed notes go with the search database, so the first launch doesn't reindex them
+	[self.searchDatabaseUpdater writeNoteFingerprintsNow];
+	
+	[fileManager removeItemAtPath:packPath error:NULL];
+	if (![fileManager createDirectoryAtPath:packPath withIntermediateDirectories:YES attributes:nil error:&error] ||
+		![fileManager copyItemAtPath:[self notesStorePath] toPath:[packPath stringByAppendingPathComponent:kNotesStoreFilename] error:&error] ||
+		![fileManager copyItemAtPath:[self searchDatabasePath] toPath:[packPath stringByAppendingPathComponent:kSearchDatabaseDirectoryName] error:&error]) {
+		ALog(@"Failed to pack prebuilt databases: %@", [error localizedDescription]);
+		return;
+	}
+	
+	DLog(@"Packed prebuilt databases to \"%@\"", packPath);
+}
+
+
+#pragma mark -
+#pragma mark Search database
+
 - (void)setUpSearchDatabase {
+	// On first launch, start from the prebuilt databases if the app bundles them
+	[self installPrebuiltDatabases];
+	
 	NSString *searchDatabasePath = [self searchDatabasePath];
 	
 	// Create a new search database if one doesn't already exist
@@ -90,14 +190,67 @@ NSMutableArray *_files;
     }
 	
 	SearchDatabaseUpdater *newSearchDatabaseUpdater = [[SearchDatabaseUpdater alloc] initWithDatabasePath:searchDatabasePath];
+	newSearchDatabaseUpdater.noteDocumentStore = self.noteDocumentStore;
 	self.searchDatabaseUpdater = newSearchDatabaseUpdater;
 	[searchDatabaseUpdater release];
 	
+	// Databases created before search completions, spelling correction or the note index existed get them built now,
+	// as does a note index left behind by notes changed since
+	NSFileManager *fileManager = [NSFileManager defaultManager];
+	if (![fileManager fileExistsAtPath:[self.searchDatabaseUpdater completionsPath]] ||
+		![fileManager fileExistsAtPath:[self.searchDatabaseUpdater spellingPath]] ||
+		![self.searchDatabaseUpdater checkNoteIndex]) {
+		[self.searchDatabaseUpdater scheduleVocabularyRebuild];
+	}
+	
+	NoteSaveQueue *newNoteSaveQueue = [[NoteSaveQueue alloc] initWithManagedObjectContext:self.managedObjectContext
+																	searchDatabaseUpdater:self.searchDatabaseUpdater];
+	self.noteSaveQueue = newNoteSaveQueue;
+	[newNoteSaveQueue release];
+	
+	// Synonyms are kept beside the search database, moved out of the engine's own thesaurus the first time
+	NSString *thesaurusPath = [searchDatabasePath stringByAppendingPathComponent:kSearchThesaurusFilename];
+	BOOL thesaurusExists = [fileManager fileExistsAtPath:thesaurusPath];
+	SearchThesaurus *newSearchThesaurus = [[SearchThesaurus alloc] initWithPath:thesaurusPath];
+	if (!thesaurusExists) {
+		[newSearchThesaurus importSynonymsFromSearchDatabaseAtPath:searchDatabasePath];
+	}
+	self.searchThesaurus = newSearchThesaurus;
+	[newSearchThesaurus release];
+	
 	SearchDatabaseRequester *newSearchDatabaseRequester = [[SearchDatabaseRequester alloc] initWithDatabasePath:searchDatabasePath];
+	newSearchDatabaseRequester.searchDatabaseUpdater = self.searchDatabaseUpdater;
+	newSearchDatabaseRequester.searchThesaurus = self.searchThesaurus;
 	self.searchDatabaseRequester = newSearchDatabaseRequester;
 	[searchDatabaseRequester release];
 }
 
+/**
+ applicationDidEnterBackground: saves any notes waiting in the save queue, and keeps the app running until
+ they have been indexed.
+ */
+- (void)applicationDidEnterBackground:(UIApplication *)application {
+	
+	if (![self.noteSaveQueue hasPendingSaves]) {
+		return;
+	}
+	[self.noteSaveQueue flush];
+	
+	__block UIBackgroundTaskIdentifier backgroundTask = [application beginBackgroundTaskWithExpirationHandler:^{
+		[application endBackgroundTask:backgroundTask];
+		backgroundTask = UIBackgroundTaskInvalid;
+	}];
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+		[self.searchDatabaseUpdater.notesSearchIndexer waitUntilIndexingIsFinished];
+		dispatch_async(dispatch_get_main_queue(), ^{
+			if (backgroundTask != UIBackgroundTaskInvalid) {
+				[application endBackgroundTask:backgroundTask];
+				backgroundTask = UIBackgroundTaskInvalid;
+			}
+		});
+	});
+}
+
 /**
  applicationWillTerminate: saves changes in the application's managed object context before the application terminates.
  
@@ -105,6 +258,10 @@ NSMutableArray *_files;
  */
 - (void)applicationWillTerminate:(UIApplication *)application {
 	
+	// Save and index any notes still waiting in the save queue
+	[self.noteSaveQueue flush];
+	[self.searchDatabaseUpdater.notesSearchIndexer waitUntilIndexingIsFinished];
+	
     NSError *error = nil;
     if (managedObjectContext != nil) {
         if ([managedObjectContext hasChanges] && ![managedObjectContext save:&error]) {
@@ -120,6 +277,53 @@ NSMutableArray *_files;
 }
 
 
+#pragma mark -
+#pragma mark BulkNoteImporterDelegate methods
+
+- (void)bulkNoteImporter:(BulkNoteImporter *)importer didImportNotes:(NSArray *)notes {
+	DLog(@"Imported %u notes (%u total)", [notes count], importer.importedCount);
+}
+
+- (void)bulkNoteImporterDidFinish:(BulkNoteImporter *)importer {
+	DLog(@"Import finished: %.1f docs/sec, %.2f MB/sec", [importer documentsPerSecond], [importer megabytesPerSecond]);
+	self.bulkNoteImporter = nil;
+	
+	if ([[NSUserDefaults standardUserDefaults] boolForKey:kPackPrebuiltDatabasesDefaultsKey]) {
+		// The note index and dictionaries are rebuilt after an import, and packed with the search database once they are
+		[self.searchDatabaseUpdater.notesSearchIndexer waitUntilIndexingIsFinished];
+		[self.searchDatabaseUpdater rebuildVocabularyWithCompletion:^(BOOL noteIndexWritten) {
+			if (noteIndexWritten) {
+				[self packPrebuiltDatabases];
+			}
+			else {
+				ALog(@"Not packing prebuilt databases without a note index");
+			}
+		}];
+	}
+}
+
+
+#pragma mark -
+#pragma mark Note documents
+
+/**
+ Returns the store of note documents bundled with the application.
+ */
+- (NoteDocumentStore *)noteDocumentStore {
+	
+	if (noteDocumentStore != nil) {
+		return noteDocumentStore;
+	}
+	NSString *documentsPath = [[[NSBundle mainBundle] resourcePath] stringByAppendingPathComponent:@"html"];
+	// Offset maps can always be rebuilt from the documents, so they live in Caches
+	NSString *cachesPath = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) lastObject];
+	noteDocumentStore = [[NoteDocumentStore alloc] initWithDirectoryPath:documentsPath
+														   pathExtension:@"xhtml"
+												  offsetMapDirectoryPath:[cachesPath stringByAppendingPathComponent:kOffsetMapsDirectoryName]];
+	return noteDocumentStore;
+}
+
+
 #pragma mark -
 #pragma mark Core Data stack
 
@@ -168,7 +372,7 @@ NSMutableArray *_files;
         return persistentStoreCoordinator;
     }
 	
-    NSURL *storeUrl = [NSURL fileURLWithPath: [[self applicationDocumentsDirectory] stringByAppendingPathComponent: @"LocNotes.sqlite"]];
+    NSURL *storeUrl = [NSURL fileURLWithPath: [self notesStorePath]];
 	DLog(@"Core Data storeURL = \"%@\"", [storeUrl absoluteString]);
 	
 	NSError *error = nil;
@@ -207,8 +411,12 @@ NSMutableArray *_files;
 #pragma mark Memory management
 
 - (void)dealloc {
+	[bulkNoteImporter release];
+	[noteDocumentStore release];
+	[noteSaveQueue release];
 	[searchDatabaseRequester release];
 	[searchDatabaseUpdater release];
+	[searchThesaurus release];
 	
     [managedObjectContext release];
     [managedObjectModel release];
@@ -0,0 +1,168 @@
+//
+//  SnippetSelection.c
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "SnippetSelection.h"
+
+#define kMaxMatches		256
+#define kMaxTerms		32		// distinct terms are tracked in a bit mask
+
+typedef struct {
+	size_t		location;
+	size_t		length;
+	unsigned	term;
+} SnippetMatch;
+
+
+static int IsWordCharacter(uint16_t c) {
+	return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80);
+}
+
+static uint16_t LowerASCII(uint16_t c) {
+	return ((c >= 'A' && c <= 'Z') ? (uint16_t)(c + ('a' - 'A')) : c);
+}
+
+static int WordMatchesTerm(const uint16_t *word, size_t wordLength, const uint16_t *term, size_t termLength) {
+	if (termLength == 0 || termLength > wordLength) {
+		return 0;
+	}
+	for (size_t i = 0; i < termLength; i++) {
+		if (LowerASCII(word[i]) != term[i]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static unsigned PopCount(uint32_t mask) {
+	unsigned count = 0;
+	while (mask) {
+		mask &= mask - 1;
+		count++;
+	}
+	return count;
+}
+
+int SnippetSelect(const uint16_t *text, size_t textLength,
+				  const uint16_t *const *terms, const size_t *termLengths, size_t termCount,
+				  size_t windowLength, size_t scanLimit, SnippetSelection *selection) {
+	SnippetMatch matches[kMaxMatches];
+	size_t matchCount = 0;
+	size_t scanLength = (textLength < scanLimit ? textLength : scanLimit);
+	
+	if (termCount > kMaxTerms) {
+		termCount = kMaxTerms;
+	}
+	
+	// Find the words that start with a term
+	size_t i = 0;
+	while (i < scanLength && matchCount < kMaxMatches) {
+		while (i < scanLength && !IsWordCharacter(text[i])) {
+			i++;
+		}
+		size_t wordStart = i;
+		while (i < scanLength && IsWordCharacter(text[i])) {
+			i++;
+		}
+		size_t wordLength = i - wordStart;
+		if (wordLength == 0) {
+			break;
+		}
+		for (unsigned t = 0; t < termCount; t++) {
+			if (WordMatchesTerm(text + wordStart, wordLength, terms[t], termLengths[t])) {
+				matches[matchCount].location = wordStart;
+				matches[matchCount].length = wordLength;
+				matches[matchCount].term = t;
+				matchCount++;
+				break;
+			}
+		}
+	}
+	
+	selection->highlightCount = 0;
+	selection->window.location = 0;
+	selection->window.length = (textLength < windowLength ? textLength : windowLength);
+	if (matchCount == 0) {
+		return 0;
+	}
+	
+	// Slide a window over the matches, keeping per-term counts for the distinct term score
+	unsigned termCounts[kMaxTerms] = { 0 };
+	uint32_t termMask = 0;
+	size_t bestFirst = 0, bestLast = 0;
+	unsigned bestDistinct = 0;
+	size_t bestMatches = 0;
+	size_t first = 0;
+	for (size_t last = 0; last < matchCount; last++) {
+		if (termCounts[matches[last].term]++ == 0) {
+			termMask |= (1u << matches[last].term);
+		}
+		while (matches[last].location + matches[last].length - matches[first].location > windowLength) {
+			if (--termCounts[matches[first].term] == 0) {
+				termMask &= ~(1u << matches[first].term);
+			}
+			first++;
+		}
+		unsigned distinct = PopCount(termMask);
+		size_t windowMatches = last - first + 1;
+		if (distinct > bestDistinct || (distinct == bestDistinct && windowMatches > bestMatches)) {
+			bestDistinct = distinct;
+			bestMatches = windowMatches;
+			bestFirst = first;
+			bestLast = last;
+		}
+	}
+	
+	// Centre the matches in the window, then move its edges off partial words
+	size_t matchStart = matches[bestFirst].location;
+	size_t matchEnd = matches[bestLast].location + matches[bestLast].length;
+	size_t slack = (matchEnd - matchStart < windowLength ? windowLength - (matchEnd - matchStart) : 0);
+	size_t start = (matchStart > slack / 2 ? matchStart - slack / 2 : 0);
+	size_t end = start + windowLength;
+	if (end > textLength) {
+		end = textLength;
+		start = (end > windowLength ? end - windowLength : 0);
+	}
+	if (end < matchEnd) {
+		end = matchEnd;		// a single word longer than the window
+	}
+	while (start > 0 && start < matchStart && IsWordCharacter(text[start - 1])) {
+		start++;
+	}
+	while (end < textLength && end > matchEnd && IsWordCharacter(text[end])) {
+		end--;
+	}
+	while (start < matchStart && !IsWordCharacter(text[start])) {
+		start++;
+	}
+	
+	selection->window.location = start;
+	selection->window.length = end - start;
+	for (size_t m = bestFirst; m <= bestLast && selection->highlightCount < kSnippetMaxHighlights; m++) {
+		selection->highlights[selection->highlightCount].location = matches[m].location;
+		selection->highlights[selection->highlightCount].length = matches[m].length;
+		selection->highlightCount++;
+	}
+	return 1;
+}
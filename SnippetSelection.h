@@ -0,0 +1,70 @@
+//
+//  SnippetSelection.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef SNIPPETSELECTION_H
+#define SNIPPETSELECTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define kSnippetMaxHighlights	16
+
+typedef struct {
+	size_t	location;
+	size_t	length;
+} SnippetRange;
+
+typedef struct {
+	SnippetRange	window;								// the snippet, within the text
+	size_t			highlightCount;
+	SnippetRange	highlights[kSnippetMaxHighlights];	// matched words, within the text
+} SnippetSelection;
+
+/*
+ * Picks the window of at most windowLength characters of UTF-16 text that best
+ * covers the query terms, and the words in it to highlight.
+ *
+ * A word matches a term if it starts with the term, ignoring ASCII case, so
+ * stemmed terms ("rout") match their word forms ("routing", "routers").  Terms
+ * must already be lower case.  Windows are scored by the number of distinct
+ * terms they contain first and the number of matches second.
+ *
+ * At most scanLimit characters of the text are looked at, so the time taken is
+ * bounded whatever the length of the document.  Returns 0 (and a window at the
+ * start of the text) if no term was found.
+ */
+int SnippetSelect(const uint16_t *text, size_t textLength,
+				  const uint16_t *const *terms, const size_t *termLengths, size_t termCount,
+				  size_t windowLength, size_t scanLimit, SnippetSelection *selection);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,383 @@
+//
+//  SpellDictionary.c
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#include "SpellDictionary.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define kDictionaryMagic		0x44534E4C		// "LNSD"
+#define kDictionaryVersion		1
+#define kMaxPrefixLength		16
+#define kMaxDeletes				256				// of one prefix: 1 + 16 + 120 at distance 2
+#define kMaxCheckedWords		512				// distinct candidates compared per lookup
+
+
+/*
+ * The header is followed by:
+ *	uint32_t		wordOffsets[wordCount + 1]	into strings
+ *	uint32_t		frequencies[wordCount]
+ *	SpellDelete		deletes[deleteCount]		sorted by hash
+ *	char			strings[stringsLength]
+ */
+typedef struct {
+	uint32_t	magic;
+	uint32_t	version;
+	uint32_t	wordCount;
+	uint32_t	deleteCount;
+	uint32_t	maxEditDistance;
+	uint32_t	prefixLength;
+	uint32_t	stringsLength;
+} DictionaryHeader;
+
+typedef struct {
+	uint32_t	hash;
+	uint32_t	word;
+} SpellDelete;
+
+typedef struct {
+	const DictionaryHeader	*header;
+	const uint32_t			*wordOffsets;
+	const uint32_t			*frequencies;
+	const SpellDelete		*deletes;
+	const char				*strings;
+} Dictionary;
+
+static size_t DictionaryLength(uint32_t wordCount, uint32_t deleteCount, uint32_t stringsLength) {
+	return sizeof(DictionaryHeader) + sizeof(uint32_t) * (2 * (size_t)wordCount + 1) + sizeof(SpellDelete) * (size_t)deleteCount + stringsLength;
+}
+
+static void DictionaryOpen(Dictionary *dictionary, const void *bytes) {
+	dictionary->header = bytes;
+	dictionary->wordOffsets = (const uint32_t *)(dictionary->header + 1);
+	dictionary->frequencies = dictionary->wordOffsets + dictionary->header->wordCount + 1;
+	dictionary->deletes = (const SpellDelete *)(dictionary->frequencies + dictionary->header->wordCount);
+	dictionary->strings = (const char *)(dictionary->deletes + dictionary->header->deleteCount);
+}
+
+int SpellDictionaryIsValid(const void *bytes, size_t length) {
+	if (bytes == NULL || length < sizeof(DictionaryHeader)) {
+		return 0;
+	}
+	const DictionaryHeader *header = bytes;
+	return (header->magic == kDictionaryMagic && header->version == kDictionaryVersion
+			&& header->maxEditDistance <= kSpellMaxEditDistance && header->prefixLength <= kMaxPrefixLength
+			&& length == DictionaryLength(header->wordCount, header->deleteCount, header->stringsLength));
+}
+
+size_t SpellDictionaryWordCount(const void *bytes) {
+	return ((const DictionaryHeader *)bytes)->wordCount;
+}
+
+static uint32_t HashBytes(const char *bytes, size_t length) {
+	uint32_t hash = 2166136261u;		// FNV-1a
+	for (size_t i = 0; i < length; i++) {
+		hash = (hash ^ (unsigned char)bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+
+#pragma mark -
+#pragma mark Deletes
+
+typedef struct {
+	char		bytes[kMaxPrefixLength];
+	uint8_t		length;
+} DeleteString;
+
+/*
+ * Fills deletes with the distinct strings made by deleting up to maxDistance
+ * bytes from string (including string itself), returning how many there are.
+ */
+static size_t GenerateDeletes(const char *string, size_t length, unsigned maxDistance, DeleteString *deletes) {
+	size_t count = 1;
+	memcpy(deletes[0].bytes, string, length);
+	deletes[0].length = (uint8_t)length;
+	
+	size_t levelStart = 0;
+	for (unsigned distance = 1; distance <= maxDistance; distance++) {
+		size_t levelEnd = count;
+		for (size_t d = levelStart; d < levelEnd; d++) {
+			for (size_t i = 0; i < deletes[d].length && deletes[d].length > 1; i++) {
+				DeleteString candidate;
+				candidate.length = deletes[d].length - 1;
+				memcpy(candidate.bytes, deletes[d].bytes, i);
+				memcpy(candidate.bytes + i, deletes[d].bytes + i + 1, candidate.length - i);
+				
+				int seen = 0;
+				for (size_t e = levelEnd; e < count && !seen; e++) {
+					seen = (deletes[e].length == candidate.length && memcmp(deletes[e].bytes, candidate.bytes, candidate.length) == 0);
+				}
+				if (!seen && count < kMaxDeletes) {
+					deletes[count++] = candidate;
+				}
+			}
+		}
+		levelStart = levelEnd;
+	}
+	return count;
+}
+
+
+#pragma mark -
+#pragma mark Building
+
+static int CompareByFrequency(const void *a, const void *b) {
+	const CompletionVocabularyTerm *termA = a, *termB = b;
+	if (termA->documentFrequency != termB->documentFrequency) {
+		return (termA->documentFrequency < termB->documentFrequency ? 1 : -1);
+	}
+	uint32_t length = (termA->length < termB->length ? termA->length : termB->length);
+	int order = memcmp(termA->term, termB->term, length);
+	return (order != 0 ? order : (int)termA->length - (int)termB->length);
+}
+
+static int CompareDeletes(const void *a, const void *b) {
+	const SpellDelete *deleteA = a, *deleteB = b;
+	if (deleteA->hash != deleteB->hash) {
+		return (deleteA->hash < deleteB->hash ? -1 : 1);
+	}
+	return (deleteA->word > deleteB->word) - (deleteA->word < deleteB->word);
+}
+
+int SpellDictionaryCreate(const CompletionVocabulary *vocabulary, const SpellDictionaryBudget *budget,
+						  void **dictionary, size_t *dictionaryLength) {
+	unsigned maxDistance = (budget->maxEditDistance < kSpellMaxEditDistance ? budget->maxEditDistance : kSpellMaxEditDistance);
+	unsigned prefixLength = (budget->prefixLength < kMaxPrefixLength ? budget->prefixLength : kMaxPrefixLength);
+	if (prefixLength <= maxDistance) {
+		prefixLength = maxDistance + 1;
+	}
+	
+	CompletionVocabularyTerm *terms = malloc((CompletionVocabularyTermCount(vocabulary) + 1) * sizeof(CompletionVocabularyTerm));
+	if (terms == NULL) {
+		return 0;
+	}
+	size_t termCount = CompletionVocabularyCopyTerms(vocabulary, budget->minDocumentFrequency, terms);
+	qsort(terms, termCount, sizeof(CompletionVocabularyTerm), CompareByFrequency);
+	
+	// Keep the most frequent words that fit in the budget
+	DeleteString *deleteStrings = malloc(kMaxDeletes * sizeof(DeleteString));
+	size_t deleteCapacity = termCount * 8 + 1;
+	SpellDelete *deletes = malloc(deleteCapacity * sizeof(SpellDelete));
+	if (deleteStrings == NULL || deletes == NULL) {
+		free(terms);
+		free(deleteStrings);
+		free(deletes);
+		return 0;
+	}
+	size_t deleteCount = 0;
+	size_t wordCount = 0;
+	size_t stringsLength = 0;
+	for (; wordCount < termCount; wordCount++) {
+		const CompletionVocabularyTerm *term = &terms[wordCount];
+		size_t length = (term->length < prefixLength ? term->length : prefixLength);
+		size_t count = GenerateDeletes(term->term, length, maxDistance, deleteStrings);
+		
+		size_t size = DictionaryLength((uint32_t)wordCount + 1, (uint32_t)(deleteCount + count), (uint32_t)(stringsLength + term->length));
+		if (size > budget->maxBytes) {
+			break;
+		}
+		if (deleteCount + count > deleteCapacity) {
+			deleteCapacity = (deleteCount + count) * 2;
+			SpellDelete *grown = realloc(deletes, deleteCapacity * sizeof(SpellDelete));
+			if (grown == NULL) {
+				break;
+			}
+			deletes = grown;
+		}
+		for (size_t d = 0; d < count; d++) {
+			deletes[deleteCount].hash = HashBytes(deleteStrings[d].bytes, deleteStrings[d].length);
+			deletes[deleteCount].word = (uint32_t)wordCount;
+			deleteCount++;
+		}
+		stringsLength += term->length;
+	}
+	free(deleteStrings);
+	qsort(deletes, deleteCount, sizeof(SpellDelete), CompareDeletes);
+	
+	size_t length = DictionaryLength((uint32_t)wordCount, (uint32_t)deleteCount, (uint32_t)stringsLength);
+	unsigned char *bytes = calloc(1, length);
+	if (bytes == NULL) {
+		free(terms);
+		free(deletes);
+		return 0;
+	}
+	DictionaryHeader *header = (DictionaryHeader *)bytes;
+	header->magic = kDictionaryMagic;
+	header->version = kDictionaryVersion;
+	header->wordCount = (uint32_t)wordCount;
+	header->deleteCount = (uint32_t)deleteCount;
+	header->maxEditDistance = maxDistance;
+	header->prefixLength = prefixLength;
+	header->stringsLength = (uint32_t)stringsLength;
+	
+	Dictionary layout;
+	DictionaryOpen(&layout, bytes);
+	uint32_t *wordOffsets = (uint32_t *)layout.wordOffsets;
+	uint32_t *frequencies = (uint32_t *)layout.frequencies;
+	char *strings = (char *)layout.strings;
+	uint32_t offset = 0;
+	for (size_t i = 0; i < wordCount; i++) {
+		wordOffsets[i] = offset;
+		frequencies[i] = terms[i].documentFrequency;
+		memcpy(strings + offset, terms[i].term, terms[i].length);
+		offset += terms[i].length;
+	}
+	wordOffsets[wordCount] = offset;
+	memcpy((void *)layout.deletes, deletes, deleteCount * sizeof(SpellDelete));
+	
+	free(terms);
+	free(deletes);
+	*dictionary = bytes;
+	*dictionaryLength = length;
+	return 1;
+}
+
+
+#pragma mark -
+#pragma mark Lookup
+
+// Optimal string alignment distance, or maxDistance + 1 if it is more than maxDistance
+static unsigned EditDistance(const char *a, size_t aLength, const char *b, size_t bLength, unsigned maxDistance) {
+	if ((aLength > bLength ? aLength - bLength : bLength - aLength) > maxDistance) {
+		return maxDistance + 1;
+	}
+	unsigned rows[3][kCompletionMaxTermLength + 1];
+	unsigned *previous2 = rows[0], *previous = rows[1], *current = rows[2];
+	for (size_t j = 0; j <= bLength; j++) {
+		previous[j] = (unsigned)j;
+	}
+	for (size_t i = 1; i <= aLength; i++) {
+		current[0] = (unsigned)i;
+		unsigned rowMinimum = current[0];
+		for (size_t j = 1; j <= bLength; j++) {
+			unsigned cost = (a[i - 1] == b[j - 1] ? 0 : 1);
+			unsigned distance = previous[j - 1] + cost;
+			if (previous[j] + 1 < distance) {
+				distance = previous[j] + 1;
+			}
+			if (current[j - 1] + 1 < distance) {
+				distance = current[j - 1] + 1;
+			}
+			if (i > 1 && j > 1 && a[i - 1] == b[j - 2] && a[i - 2] == b[j - 1] && previous2[j - 2] + 1 < distance) {
+				distance = previous2[j - 2] + 1;		// transposition
+			}
+			current[j] = distance;
+			if (distance < rowMinimum) {
+				rowMinimum = distance;
+			}
+		}
+		if (rowMinimum > maxDistance) {
+			return maxDistance + 1;
+		}
+		unsigned *recycled = previous2;
+		previous2 = previous;
+		previous = current;
+		current = recycled;
+	}
+	return (previous[bLength] <= maxDistance ? previous[bLength] : maxDistance + 1);
+}
+
+static int CandidateIsBetter(const SpellCandidate *a, const SpellCandidate *b) {
+	return (a->editDistance < b->editDistance || (a->editDistance == b->editDistance && a->documentFrequency > b->documentFrequency));
+}
+
+size_t SpellDictionaryLookup(const void *bytes, size_t length,
+							 const char *word, size_t wordLength, unsigned maxEditDistance,
+							 SpellCandidate *candidates, size_t maxCandidates) {
+	if (!SpellDictionaryIsValid(bytes, length) || wordLength == 0 || wordLength > kCompletionMaxTermLength || maxCandidates == 0) {
+		return 0;
+	}
+	Dictionary dictionary;
+	DictionaryOpen(&dictionary, bytes);
+	if (maxEditDistance > dictionary.header->maxEditDistance) {
+		maxEditDistance = dictionary.header->maxEditDistance;
+	}
+	
+	DeleteString deleteStrings[kMaxDeletes];
+	size_t prefixLength = (wordLength < dictionary.header->prefixLength ? wordLength : dictionary.header->prefixLength);
+	size_t deleteCount = GenerateDeletes(word, prefixLength, maxEditDistance, deleteStrings);
+	
+	uint32_t checked[kMaxCheckedWords];
+	size_t checkedCount = 0;
+	size_t candidateCount = 0;
+	
+	for (size_t d = 0; d < deleteCount && checkedCount < kMaxCheckedWords; d++) {
+		uint32_t hash = HashBytes(deleteStrings[d].bytes, deleteStrings[d].length);
+		
+		// The first delete with this hash
+		size_t low = 0, high = dictionary.header->deleteCount;
+		while (low < high) {
+			size_t middle = low + (high - low) / 2;
+			if (dictionary.deletes[middle].hash < hash) {
+				low = middle + 1;
+			}
+			else {
+				high = middle;
+			}
+		}
+		
+		for (size_t i = low; i < dictionary.header->deleteCount && dictionary.deletes[i].hash == hash && checkedCount < kMaxCheckedWords; i++) {
+			uint32_t index = dictionary.deletes[i].word;
+			int seen = 0;
+			for (size_t c = 0; c < checkedCount && !seen; c++) {
+				seen = (checked[c] == index);
+			}
+			if (seen) {
+				continue;
+			}
+			checked[checkedCount++] = index;
+			
+			const char *candidateWord = dictionary.strings + dictionary.wordOffsets[index];
+			size_t candidateLength = dictionary.wordOffsets[index + 1] - dictionary.wordOffsets[index];
+			unsigned distance = EditDistance(word, wordLength, candidateWord, candidateLength, maxEditDistance);
+			if (distance > maxEditDistance) {
+				continue;
+			}
+			
+			// Insert in order, dropping the worst if full
+			SpellCandidate candidate;
+			memcpy(candidate.word, candidateWord, candidateLength);
+			candidate.word[candidateLength] = '\0';
+			candidate.editDistance = distance;
+			candidate.documentFrequency = dictionary.frequencies[index];
+			size_t position = candidateCount;
+			while (position > 0 && CandidateIsBetter(&candidate, &candidates[position - 1])) {
+				position--;
+			}
+			if (position < maxCandidates) {
+				size_t last = (candidateCount < maxCandidates ? candidateCount : maxCandidates - 1);
+				memmove(&candidates[position + 1], &candidates[position], (last - position) * sizeof(SpellCandidate));
+				candidates[position] = candidate;
+				if (candidateCount < maxCandidates) {
+					candidateCount++;
+				}
+			}
+		}
+	}
+	return candidateCount;
+}
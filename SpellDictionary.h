@@ -0,0 +1,83 @@
+//
+//  SpellDictionary.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+
+#ifndef SPELLDICTIONARY_H
+#define SPELLDICTIONARY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "CompletionDictionary.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define kSpellMaxEditDistance	2
+
+typedef struct {
+	uint32_t	minDocumentFrequency;	// rarer words are left out (and so get corrected)
+	size_t		maxBytes;				// the most frequent words that fit are kept
+	unsigned	maxEditDistance;		// at most kSpellMaxEditDistance
+	unsigned	prefixLength;			// only this much of each word is used to find candidates
+} SpellDictionaryBudget;
+
+/*
+ * Serialises the vocabulary's words into a symmetric delete spelling
+ * dictionary: every string that can be made by deleting up to maxEditDistance
+ * characters from the start of a word maps back to that word.  A misspelling
+ * is then looked up by generating its own deletes, so the work done doesn't
+ * depend on the size of the vocabulary, and no other words are compared.
+ *
+ * The dictionary is a single flat buffer allocated with malloc(), to be
+ * written out and memory mapped.  Returns 0 on failure.
+ */
+int SpellDictionaryCreate(const CompletionVocabulary *vocabulary, const SpellDictionaryBudget *budget,
+						  void **dictionary, size_t *dictionaryLength);
+
+int SpellDictionaryIsValid(const void *dictionary, size_t dictionaryLength);
+size_t SpellDictionaryWordCount(const void *dictionary);
+
+typedef struct {
+	char		word[kCompletionMaxTermLength + 1];		// nul terminated
+	unsigned	editDistance;							// optimal string alignment distance
+	uint32_t	documentFrequency;
+} SpellCandidate;
+
+/*
+ * Finds the dictionary words within maxEditDistance of word (which must be
+ * lower case), nearest first and then most frequent first.  A word that is
+ * itself in the dictionary comes back first, with an edit distance of 0.
+ */
+size_t SpellDictionaryLookup(const void *dictionary, size_t dictionaryLength,
+							 const char *word, size_t wordLength, unsigned maxEditDistance,
+							 SpellCandidate *candidates, size_t maxCandidates);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,104 @@
+//
+//  XHTMLExtractedText.m
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#import "XHTMLExtractedText.h"
+
+#import "XHTMLTextExtraction.h"
+
+
+@implementation XHTMLExtractedText
+
+@synthesize text;
+@synthesize title;
+@synthesize offsetMap;
+
++ (BOOL)stringLooksLikeMarkup:(NSString *)string {
+	NSString *trimmed = [string stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+	return [trimmed hasPrefix:@"<"];
+}
+
++ (XHTMLExtractedText *)extractedTextFromBytes:(const char *)bytes length:(NSUInteger)length withOffsetMap:(BOOL)withOffsetMap {
+	// Single allocation: the text buffer is handed over to the NSString without copying
+	char *textBuffer = malloc(MAX(length, 1));
+	if (textBuffer == NULL) {
+		return nil;
+	}
+	
+	XHTMLTextExtractionResult result;
+	NSMutableData *mapData = nil;
+	if (withOffsetMap) {
+		mapData = [NSMutableData dataWithLength:XHTMLOffsetMapCapacity(length) * sizeof(XHTMLOffsetMapEntry)];
+		size_t mapCount = 0;
+		XHTMLExtractTextWithOffsetMap(bytes, length, textBuffer, &result, [mapData mutableBytes], &mapCount);
+		[mapData setLength:mapCount * sizeof(XHTMLOffsetMapEntry)];
+	}
+	else {
+		XHTMLExtractText(bytes, length, textBuffer, &result);
+	}
+	
+	XHTMLExtractedText *extractedText = [[[XHTMLExtractedText alloc] init] autorelease];
+	extractedText->offsetMap = [mapData retain];
+	if (result.titleLength > 0) {
+		extractedText->title = [[NSString alloc] initWithBytes:textBuffer + result.titleLocation
+														length:result.titleLength
+													  encoding:NSUTF8StringEncoding];
+	}
+	extractedText->text = [[NSString alloc] initWithBytesNoCopy:textBuffer
+														 length:result.textLength
+													   encoding:NSUTF8StringEncoding
+												   freeWhenDone:YES];
+	if (nil == extractedText->text) {
+		free(textBuffer);
+		extractedText = nil;
+	}
+	
+	return extractedText;
+}
+
++ (XHTMLExtractedText *)extractedTextFromData:(NSData *)data {
+	return [self extractedTextFromBytes:[data bytes] length:[data length] withOffsetMap:NO];
+}
+
++ (XHTMLExtractedText *)extractedTextWithOffsetMapFromData:(NSData *)data {
+	return [self extractedTextFromBytes:[data bytes] length:[data length] withOffsetMap:YES];
+}
+
++ (XHTMLExtractedText *)extractedTextFromString:(NSString *)string {
+	const char *bytes = [string UTF8String];
+	if (bytes == NULL) {
+		return nil;
+	}
+	return [self extractedTextFromBytes:bytes length:strlen(bytes) withOffsetMap:NO];
+}
+
+- (void)dealloc {
+	[text release];
+	[title release];
+	[offsetMap release];
+	
+	[super dealloc];
+}
+
+@end
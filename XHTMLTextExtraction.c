@@ -0,0 +1,500 @@
+//
+//  XHTMLTextExtraction.c
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#include "XHTMLTextExtraction.h"
+
+#include <string.h>
+
+#define kTitleNotStarted	((size_t)-1)
+
+typedef enum {
+	XHTMLTitleRankNone = 0,
+	XHTMLTitleRankProcedure,
+	XHTMLTitleRankTopic
+} XHTMLTitleRank;
+
+typedef struct {
+	char			*text;
+	size_t			length;
+	int				pendingSpace;
+	
+	XHTMLTitleRank	titleRank;
+	int				titleDivDepth;		// > 0 while capturing the title
+	size_t			titleLocation;
+	size_t			titleLength;
+	
+	const char			*source;
+	XHTMLOffsetMapEntry	*map;				// NULL unless an offset map was asked for
+	size_t				mapCount;
+	size_t				mapCapacity;
+} XHTMLWriter;
+
+
+#pragma mark -
+#pragma mark Writer
+
+static void XHTMLWriterAppendSpace(XHTMLWriter *writer) {
+	// Collapsed: only written out before the next non-space character
+	if (writer->length > 0) {
+		writer->pendingSpace = 1;
+	}
+}
+
+static void XHTMLWriterMapOffset(XHTMLWriter *writer, size_t textOffset, size_t sourceOffset) {
+	if (writer->mapCount > 0) {
+		XHTMLOffsetMapEntry *last = &writer->map[writer->mapCount - 1];
+		if (last->textOffset == textOffset) {
+			last->sourceOffset = (uint32_t)sourceOffset;
+			return;
+		}
+		if (sourceOffset - last->sourceOffset == textOffset - last->textOffset) {
+			return;		// continues the last run
+		}
+	}
+	if (writer->mapCount < writer->mapCapacity) {
+		writer->map[writer->mapCount].textOffset = (uint32_t)textOffset;
+		writer->map[writer->mapCount].sourceOffset = (uint32_t)sourceOffset;
+		writer->mapCount++;
+	}
+}
+
+static void XHTMLWriterAppendBytes(XHTMLWriter *writer, const char *bytes, size_t length) {
+	if (writer->pendingSpace) {
+		writer->text[writer->length++] = ' ';
+		writer->pendingSpace = 0;
+	}
+	if (writer->map) {
+		XHTMLWriterMapOffset(writer, writer->length, (size_t)(bytes - writer->source));
+	}
+	if (writer->titleDivDepth > 0 && writer->titleLocation == kTitleNotStarted) {
+		writer->titleLocation = writer->length;
+	}
+	memcpy(writer->text + writer->length, bytes, length);
+	writer->length += length;
+}
+
+// Decoded entities don't map byte for byte, so the map marks where they start and end in the source
+static void XHTMLWriterAppendDecodedBytes(XHTMLWriter *writer, const char *bytes, size_t length, size_t sourceStart, size_t sourceEnd) {
+	if (writer->pendingSpace) {
+		writer->text[writer->length++] = ' ';
+		writer->pendingSpace = 0;
+	}
+	if (writer->titleDivDepth > 0 && writer->titleLocation == kTitleNotStarted) {
+		writer->titleLocation = writer->length;
+	}
+	if (writer->map) {
+		XHTMLWriterMapOffset(writer, writer->length, sourceStart);
+	}
+	memcpy(writer->text + writer->length, bytes, length);
+	writer->length += length;
+	if (writer->map) {
+		XHTMLWriterMapOffset(writer, writer->length, sourceEnd);
+	}
+}
+
+static void XHTMLWriterBeginTitle(XHTMLWriter *writer, XHTMLTitleRank rank) {
+	writer->titleRank = rank;
+	writer->titleDivDepth = 1;
+	writer->titleLocation = kTitleNotStarted;
+	writer->titleLength = 0;
+}
+
+static void XHTMLWriterEndTitle(XHTMLWriter *writer) {
+	writer->titleDivDepth = 0;
+	if (writer->titleLocation == kTitleNotStarted) {
+		// Empty title element; allow a later one to be used instead
+		writer->titleRank = XHTMLTitleRankNone;
+		writer->titleLocation = 0;
+	}
+	else {
+		writer->titleLength = writer->length - writer->titleLocation;
+	}
+}
+
+
+#pragma mark -
+#pragma mark Scanning helpers
+
+static int XHTMLIsSpace(char c) {
+	return (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f');
+}
+
+static char XHTMLLowercase(char c) {
+	return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+static int XHTMLIsNameChar(char c) {
+	return ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == ':' || c == '_' || c == '-' || c == '.');
+}
+
+static int XHTMLHasPrefix(const char *p, const char *end, const char *prefix) {
+	size_t length = strlen(prefix);
+	if ((size_t)(end - p) < length) {
+		return 0;
+	}
+	for (size_t i=0; i<length; i++) {
+		if (XHTMLLowercase(p[i]) != prefix[i]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static int XHTMLNameEquals(const char *name, size_t nameLength, const char *lowercaseName) {
+	return (nameLength == strlen(lowercaseName) && XHTMLHasPrefix(name, name + nameLength, lowercaseName));
+}
+
+// Returns a pointer just past the first occurrence of needle (case-insensitive), or end
+static const char *XHTMLSkipPast(const char *p, const char *end, const char *needle) {
+	size_t length = strlen(needle);
+	while (p < end) {
+		const char *candidate = memchr(p, needle[0], (size_t)(end - p));
+		if (candidate == NULL) {
+			return end;
+		}
+		if (XHTMLHasPrefix(candidate, end, needle)) {
+			return candidate + length;
+		}
+		p = candidate + 1;
+	}
+	return end;
+}
+
+// Returns a pointer just past the '>' closing the tag starting at p, skipping quoted attribute values
+static const char *XHTMLSkipTag(const char *p, const char *end) {
+	char quote = 0;
+	for (; p < end; p++) {
+		if (quote) {
+			if (*p == quote) {
+				quote = 0;
+			}
+		}
+		else if (*p == '"' || *p == '\'') {
+			quote = *p;
+		}
+		else if (*p == '>') {
+			return p + 1;
+		}
+	}
+	return end;
+}
+
+// Whether the attributes between p and end include a class attribute containing className as a token
+static int XHTMLAttributesHaveClass(const char *p, const char *end, const char *className) {
+	size_t classNameLength = strlen(className);
+	
+	while (p < end) {
+		p = XHTMLSkipPast(p, end, "class");
+		while (p < end && XHTMLIsSpace(*p)) p++;
+		if (p >= end || *p != '=') {
+			continue;
+		}
+		p++;
+		while (p < end && XHTMLIsSpace(*p)) p++;
+		if (p >= end || (*p != '"' && *p != '\'')) {
+			continue;
+		}
+		char quote = *p++;
+		while (p < end && *p != quote) {
+			while (p < end && XHTMLIsSpace(*p)) p++;
+			const char *token = p;
+			while (p < end && *p != quote && !XHTMLIsSpace(*p)) p++;
+			if ((size_t)(p - token) == classNameLength && memcmp(token, className, classNameLength) == 0) {
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+static size_t XHTMLEncodeUTF8(unsigned long codePoint, char *bytes) {
+	if (codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF) || codePoint == 0) {
+		codePoint = 0xFFFD;		// replacement character
+	}
+	if (codePoint < 0x80) {
+		bytes[0] = (char)codePoint;
+		return 1;
+	}
+	if (codePoint < 0x800) {
+		bytes[0] = (char)(0xC0 | (codePoint >> 6));
+		bytes[1] = (char)(0x80 | (codePoint & 0x3F));
+		return 2;
+	}
+	if (codePoint < 0x10000) {
+		bytes[0] = (char)(0xE0 | (codePoint >> 12));
+		bytes[1] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+		bytes[2] = (char)(0x80 | (codePoint & 0x3F));
+		return 3;
+	}
+	bytes[0] = (char)(0xF0 | (codePoint >> 18));
+	bytes[1] = (char)(0x80 | ((codePoint >> 12) & 0x3F));
+	bytes[2] = (char)(0x80 | ((codePoint >> 6) & 0x3F));
+	bytes[3] = (char)(0x80 | (codePoint & 0x3F));
+	return 4;
+}
+
+/*
+ * Decodes the character entity starting at p (which points at '&').
+ * Returns a pointer past the entity and the decoded UTF-8 bytes in decoded,
+ * or p itself if it isn't a recognised entity.
+ */
+static const char *XHTMLDecodeEntity(const char *p, const char *end, char *decoded, size_t *decodedLength) {
+	const char *semicolon = NULL;
+	for (const char *q = p + 1; q < end && q < p + 12; q++) {
+		if (*q == ';') {
+			semicolon = q;
+			break;
+		}
+	}
+	if (semicolon == NULL) {
+		return p;
+	}
+	
+	const char *name = p + 1;
+	size_t nameLength = (size_t)(semicolon - name);
+	if (nameLength >= 2 && name[0] == '#') {
+		unsigned long codePoint = 0;
+		int hex = (name[1] == 'x' || name[1] == 'X');
+		const char *digit = name + (hex ? 2 : 1);
+		if (digit == semicolon) {
+			return p;
+		}
+		for (; digit < semicolon; digit++) {
+			char c = XHTMLLowercase(*digit);
+			if (c >= '0' && c <= '9') {
+				codePoint = codePoint * (hex ? 16 : 10) + (unsigned long)(c - '0');
+			}
+			else if (hex && c >= 'a' && c <= 'f') {
+				codePoint = codePoint * 16 + (unsigned long)(c - 'a' + 10);
+			}
+			else {
+				return p;
+			}
+			if (codePoint > 0x10FFFF) {
+				codePoint = 0x110000;	// clamp; encoded as a replacement character
+			}
+		}
+		*decodedLength = XHTMLEncodeUTF8(codePoint, decoded);
+	}
+	else if (XHTMLNameEquals(name, nameLength, "amp")) {
+		decoded[0] = '&';
+		*decodedLength = 1;
+	}
+	else if (XHTMLNameEquals(name, nameLength, "lt")) {
+		decoded[0] = '<';
+		*decodedLength = 1;
+	}
+	else if (XHTMLNameEquals(name, nameLength, "gt")) {
+		decoded[0] = '>';
+		*decodedLength = 1;
+	}
+	else if (XHTMLNameEquals(name, nameLength, "quot")) {
+		decoded[0] = '"';
+		*decodedLength = 1;
+	}
+	else if (XHTMLNameEquals(name, nameLength, "apos")) {
+		decoded[0] = '\'';
+		*decodedLength = 1;
+	}
+	else if (XHTMLNameEquals(name, nameLength, "nbsp")) {
+		decoded[0] = ' ';
+		*decodedLength = 1;
+	}
+	else {
+		return p;
+	}
+	
+	return semicolon + 1;
+}
+
+
+#pragma mark -
+#pragma mark Tags
+
+static const char *XHTMLHandleTag(XHTMLWriter *writer, const char *p, const char *end) {
+	// Comments, CDATA sections, processing instructions and DOCTYPE
+	if (XHTMLHasPrefix(p, end, "<!--")) {
+		return XHTMLSkipPast(p + 4, end, "-->");
+	}
+	if (XHTMLHasPrefix(p, end, "<![cdata[")) {
+		const char *cdata = p + 9;
+		const char *cdataEnd = XHTMLSkipPast(cdata, end, "]]>");
+		size_t length = (size_t)(cdataEnd - cdata);
+		if (cdataEnd - cdata >= 3 && cdataEnd[-1] == '>') {
+			length -= 3;
+		}
+		XHTMLWriterAppendSpace(writer);
+		XHTMLWriterAppendBytes(writer, cdata, length);
+		XHTMLWriterAppendSpace(writer);
+		return cdataEnd;
+	}
+	if (p + 1 < end && (p[1] == '!' || p[1] == '?')) {
+		return XHTMLSkipTag(p + 1, end);
+	}
+	
+	int closing = (p + 1 < end && p[1] == '/');
+	const char *name = p + (closing ? 2 : 1);
+	const char *nameEnd = name;
+	while (nameEnd < end && XHTMLIsNameChar(*nameEnd)) nameEnd++;
+	size_t nameLength = (size_t)(nameEnd - name);
+	
+	if (nameLength == 0) {
+		// A stray '<' rather than a tag
+		XHTMLWriterAppendBytes(writer, p, 1);
+		return p + 1;
+	}
+	
+	const char *tagEnd = XHTMLSkipTag(nameEnd, end);
+	int selfClosing = (tagEnd - nameEnd >= 2 && tagEnd[-1] == '>' && tagEnd[-2] == '/');
+	
+	// Tags separate words, whether block level or not
+	XHTMLWriterAppendSpace(writer);
+	
+	if (!closing && !selfClosing) {
+		if (XHTMLNameEquals(name, nameLength, "head")) {
+			return XHTMLSkipTag(XHTMLSkipPast(tagEnd, end, "</head"), end);
+		}
+		if (XHTMLNameEquals(name, nameLength, "style")) {
+			return XHTMLSkipTag(XHTMLSkipPast(tagEnd, end, "</style"), end);
+		}
+		if (XHTMLNameEquals(name, nameLength, "script")) {
+			return XHTMLSkipTag(XHTMLSkipPast(tagEnd, end, "</script"), end);
+		}
+	}
+	
+	if (XHTMLNameEquals(name, nameLength, "div")) {
+		if (writer->titleDivDepth > 0) {
+			if (closing) {
+				if (--writer->titleDivDepth == 0) {
+					XHTMLWriterEndTitle(writer);
+				}
+			}
+			else if (!selfClosing) {
+				writer->titleDivDepth++;
+			}
+		}
+		else if (!closing && !selfClosing && writer->titleRank < XHTMLTitleRankTopic) {
+			if (XHTMLAttributesHaveClass(nameEnd, tagEnd, "Topic_Title")) {
+				XHTMLWriterBeginTitle(writer, XHTMLTitleRankTopic);
+			}
+			else if (writer->titleRank < XHTMLTitleRankProcedure && XHTMLAttributesHaveClass(nameEnd, tagEnd, "Title_Procedure")) {
+				XHTMLWriterBeginTitle(writer, XHTMLTitleRankProcedure);
+			}
+		}
+	}
+	
+	return tagEnd;
+}
+
+
+#pragma mark -
+#pragma mark Extraction
+
+void XHTMLExtractText(const char *source, size_t sourceLength, char *text, XHTMLTextExtractionResult *result) {
+	XHTMLExtractTextWithOffsetMap(source, sourceLength, text, result, NULL, NULL);
+}
+
+void XHTMLExtractTextWithOffsetMap(const char *source, size_t sourceLength, char *text, XHTMLTextExtractionResult *result,
+								   XHTMLOffsetMapEntry *map, size_t *mapCount) {
+	XHTMLWriter writer;
+	memset(&writer, 0, sizeof(writer));
+	writer.text = text;
+	writer.source = source;
+	writer.map = map;
+	writer.mapCapacity = (map ? XHTMLOffsetMapCapacity(sourceLength) : 0);
+	
+	const char *p = source;
+	const char *end = source + sourceLength;
+	
+	while (p < end) {
+		char c = *p;
+		
+		if (c == '<') {
+			p = XHTMLHandleTag(&writer, p, end);
+		}
+		else if (c == '&') {
+			char decoded[4];
+			size_t decodedLength = 0;
+			const char *next = XHTMLDecodeEntity(p, end, decoded, &decodedLength);
+			if (next == p) {
+				XHTMLWriterAppendBytes(&writer, p, 1);
+				p++;
+			}
+			else {
+				if (decodedLength == 1 && XHTMLIsSpace(decoded[0])) {
+					XHTMLWriterAppendSpace(&writer);
+				}
+				else {
+					XHTMLWriterAppendDecodedBytes(&writer, decoded, decodedLength, (size_t)(p - source), (size_t)(next - source));
+				}
+				p = next;
+			}
+		}
+		else if (XHTMLIsSpace(c)) {
+			XHTMLWriterAppendSpace(&writer);
+			p++;
+		}
+		else {
+			// Copy a run of plain text (including any multi-byte UTF-8 sequences) in one go
+			const char *run = p;
+			while (p < end && *p != '<' && *p != '&' && !XHTMLIsSpace(*p)) p++;
+			XHTMLWriterAppendBytes(&writer, run, (size_t)(p - run));
+		}
+	}
+	
+	if (writer.titleDivDepth > 0) {
+		// Unterminated title element
+		XHTMLWriterEndTitle(&writer);
+	}
+	
+	result->textLength = writer.length;
+	result->titleLocation = (writer.titleRank != XHTMLTitleRankNone ? writer.titleLocation : 0);
+	result->titleLength = (writer.titleRank != XHTMLTitleRankNone ? writer.titleLength : 0);
+	if (mapCount) {
+		*mapCount = writer.mapCount;
+	}
+}
+
+size_t XHTMLSourceOffsetForTextOffset(const XHTMLOffsetMapEntry *map, size_t mapCount, size_t textOffset) {
+	if (mapCount == 0) {
+		return textOffset;
+	}
+	
+	// The last entry at or before textOffset; text between entries maps byte for byte
+	size_t low = 0, high = mapCount;
+	while (high - low > 1) {
+		size_t middle = low + (high - low) / 2;
+		if (map[middle].textOffset <= textOffset) {
+			low = middle;
+		}
+		else {
+			high = middle;
+		}
+	}
+	if (map[low].textOffset > textOffset) {
+		return map[low].sourceOffset;
+	}
+	return map[low].sourceOffset + (textOffset - map[low].textOffset);
+}
@@ -0,0 +1,88 @@
+//
+//  XHTMLTextExtraction.h
+//  LocNotes
+//
+//  Copyright (c) Locayta Limited 2010-2011.
+//
+//  Permission is hereby granted, free of charge, to any person obtaining a copy
+//  of this software and associated documentation files (the "Software"), to deal
+//  in the Software without restriction, including without limitation the rights
+//  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//  copies of the Software, and to permit persons to whom the Software is
+//  furnished to do so, subject to the following conditions:
+//  
+//  The above copyright notice and this permission notice shall be included in
+//  all copies or substantial portions of the Software.
+//  
+//  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+//  THE SOFTWARE.
+//
+
+#ifndef XHTMLTEXTEXTRACTION_H
+#define XHTMLTEXTEXTRACTION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+	size_t	textLength;
+	size_t	titleLocation;		// offset of the title within the extracted text
+	size_t	titleLength;		// 0 if the document has no title element
+} XHTMLTextExtractionResult;
+
+/*
+ * Extracts the readable text from UTF-8 encoded XHTML in a single pass.
+ *
+ * Tags are stripped, character entities decoded, runs of white space collapsed
+ * to a single space and the contents of <head>, <style> and <script> elements
+ * dropped.  The text of the first "Topic_Title" div (or failing that the first
+ * "Title_Procedure" div) is reported as the document title.
+ *
+ * The extracted text is never longer than the source, so text must have room
+ * for sourceLength bytes.  No other memory is allocated.
+ */
+void XHTMLExtractText(const char *source, size_t sourceLength, char *text, XHTMLTextExtractionResult *result);
+
+/*
+ * Where a run of extracted text starts in the source.  Text up to the next
+ * entry maps byte for byte onto the source, so only the places where markup or
+ * collapsed white space was dropped need an entry.
+ */
+typedef struct {
+	uint32_t	textOffset;
+	uint32_t	sourceOffset;
+} XHTMLOffsetMapEntry;
+
+// Each entry after the first accounts for at least two bytes of source
+#define XHTMLOffsetMapCapacity(sourceLength)	((sourceLength) / 2 + 2)
+
+/*
+ * As XHTMLExtractText(), also recording a map from offsets in the extracted
+ * text back to offsets in the source, sorted by text offset.  map must have
+ * room for XHTMLOffsetMapCapacity(sourceLength) entries.
+ */
+void XHTMLExtractTextWithOffsetMap(const char *source, size_t sourceLength, char *text, XHTMLTextExtractionResult *result,
+								   XHTMLOffsetMapEntry *map, size_t *mapCount);
+
+/*
+ * Translates an offset in the extracted text to the matching offset in the
+ * source.  Offsets at the start or end of a word always land outside markup
+ * and character entities, so source ranges built from them can be wrapped in
+ * new elements.
+ */
+size_t XHTMLSourceOffsetForTextOffset(const XHTMLOffsetMapEntry *map, size_t mapCount, size_t textOffset);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
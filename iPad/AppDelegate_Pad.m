@@ -38,6 +38,17 @@
 @synthesize mainSplitViewController;
 @synthesize notesBrowserTableViewController;
 
+- (Note *)firstNote {
+	Note *note = nil;
+    NSFetchedResultsController *noteFetchedResultsController = [self.notesBrowserTableViewController fetchedResultsControllerForNoteWithDelegate:nil];
+	id <NSFetchedResultsSectionInfo> sectionInfo = [[noteFetchedResultsController sections] objectAtIndex:0];
+    if ([sectionInfo numberOfObjects] > 0) {
+		NSIndexPath *firstNoteIndexPath = [NSIndexPath indexPathForRow:0 inSection:0];
+		note = [noteFetchedResultsController objectAtIndexPath:firstNoteIndexPath];
+	}
+	return note;
+}
+
 #pragma mark -
 #pragma mark Application delegate
 - (BOOL)application:(UIApplication *)application didFinishLaunchingWithOptions:(NSDictionary *)launchOptions {
@@ -55,14 +66,9 @@
     }
 
     // Select the first available note by default. Or create a new note if none exist.
-    NSFetchedResultsController *noteFetchedResultsController = [self.notesBrowserTableViewController fetchedResultsControllerForNoteWithDelegate:nil];
-	id <NSFetchedResultsSectionInfo> sectionInfo = [[noteFetchedResultsController sections] objectAtIndex:0];
-    if ([sectionInfo numberOfObjects] > 0) {
-		NSIndexPath *firstNoteIndexPath = [NSIndexPath indexPathForRow:0 inSection:0];
-		Note *note = [noteFetchedResultsController objectAtIndexPath:firstNoteIndexPath];
-		if (note) {
-			self.editNoteViewController.note = note;
-		}
+	Note *note = [self firstNote];
+	if (note) {
+		self.editNoteViewController.note = note;
 	}
 	
 	[window addSubview:self.mainSplitViewController.view];
@@ -73,6 +79,21 @@
 }
 
 
+/**
+ Notes are imported in the background on first launch, so select one once they are available.
+ */
+- (void)bulkNoteImporterDidFinish:(BulkNoteImporter *)importer {
+	[super bulkNoteImporterDidFinish:importer];
+	
+	if (nil == self.editNoteViewController.note) {
+		Note *note = [self firstNote];
+		if (note) {
+			[self.editNoteViewController changeNoteBeingEdited:note];
+		}
+	}
+}
+
+
 /**
  Superclass implementation saves changes in the application's managed object context before the application terminates.
  */